@@ -1,6 +1,8 @@
 #!/usr/bin/env bash
 #
 # benchmark.sh — run the v1-vs-v2 SET/GET benchmark matrix and dump the results.
+# v2 runs twice: as the single-executor design (v2), and with --io-execute
+# (v2-striped), where the IO threads execute on a lock-striped store.
 #
 # For every (server x command x concurrency x pipeline) cell it runs a discarded
 # warm-up followed by a measured run of valkey-benchmark, records throughput and
@@ -14,11 +16,11 @@
 #
 # Output goes to notes/results/ as both CSV and JSON (plus latest.{csv,json}
 # symlinks) and a run-metadata file. Servers run one at a time; v1 listens on
-# 6379 (hard-coded), v2 on 6380.
+# 6379 (hard-coded), both v2 modes on 6380.
 #
 # Usage:
 #   ./notes/benchmark.sh [--quick] [--format csv|json|both]
-#                        [--only v1|v2] [--timeout SECONDS]
+#                        [--only v1|v2|v2-striped] [--timeout SECONDS]
 #
 set -uo pipefail
 
@@ -43,7 +45,7 @@ WARMUP_DIV=4                 # warm-up ops = measured / WARMUP_DIV
 CELL_TIMEOUT=60              # seconds before a run is called a hang
 
 FORMAT=both                  # csv | json | both
-ONLY=""                      # "", v1, or v2
+ONLY=""                      # "", v1, v2, or v2-striped
 
 # ---- CLI --------------------------------------------------------------------
 while [[ $# -gt 0 ]]; do
@@ -52,7 +54,7 @@ while [[ $# -gt 0 ]]; do
     --format)  FORMAT="$2"; shift 2 ;;
     --only)    ONLY="$2"; shift 2 ;;
     --timeout) CELL_TIMEOUT="$2"; shift 2 ;;
-    -h|--help) sed -n '2,32p' "$0"; exit 0 ;;
+    -h|--help) sed -n '2,34p' "$0"; exit 0 ;;
     *) echo "Unknown option: $1" >&2; exit 2 ;;
   esac
 done
@@ -78,11 +80,13 @@ server_alive() { [[ -n "$SERVER_PID" ]] && kill -0 "$SERVER_PID" 2>/dev/null; }
 
 start_server() { # name
   local name="$1"
-  if [[ "$name" == v1 ]]; then
-    "$V1_BIN" >"$OUT_DIR/$name-server.log" 2>&1 &
-  else
-    "$V2_BIN" -p "$V2_PORT" -s 0 >"$OUT_DIR/$name-server.log" 2>&1 &
-  fi
+  case "$name" in
+    v1) "$V1_BIN" >"$OUT_DIR/$name-server.log" 2>&1 & ;;
+    v2) "$V2_BIN" -p "$V2_PORT" -s 0 >"$OUT_DIR/$name-server.log" 2>&1 & ;;
+    v2-striped)
+      "$V2_BIN" -p "$V2_PORT" -s 0 --io-execute \
+        >"$OUT_DIR/$name-server.log" 2>&1 & ;;
+  esac
   SERVER_PID=$!
 }
 
@@ -171,11 +175,16 @@ bench_server() { # name port
 }
 
 # ---- Run --------------------------------------------------------------------
-[[ -x "$V1_BIN" ]] || { [[ "$ONLY" == v2 ]] || echo "warn: $V1_BIN missing; skipping v1" >&2; }
+wanted() { [[ -z "$ONLY" || "$ONLY" == "$1" ]]; }
+
+[[ -x "$V1_BIN" ]] || { wanted v1 && echo "warn: $V1_BIN missing; skipping v1" >&2; }
 [[ -x "$V2_BIN" ]] || { [[ "$ONLY" == v1 ]] || echo "warn: $V2_BIN missing; skipping v2" >&2; }
 
-if [[ "$ONLY" != v2 && -x "$V1_BIN" ]]; then bench_server v1 "$V1_PORT"; fi
-if [[ "$ONLY" != v1 && -x "$V2_BIN" ]]; then bench_server v2 "$V2_PORT"; fi
+if wanted v1 && [[ -x "$V1_BIN" ]]; then bench_server v1 "$V1_PORT"; fi
+if wanted v2 && [[ -x "$V2_BIN" ]]; then bench_server v2 "$V2_PORT"; fi
+if wanted v2-striped && [[ -x "$V2_BIN" ]]; then
+  bench_server v2-striped "$V2_PORT"
+fi
 
 # ---- Metadata ---------------------------------------------------------------
 {
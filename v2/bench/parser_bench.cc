@@ -0,0 +1,306 @@
+// Parsing cost per command of a pipelined batch of P `SET key value`
+// requests, delivered in reads of up to kReadBytes as a socket would hand
+// them over, for:
+//
+//  - the original RespValueQueue: RespValue::FromString from the start of the
+//    buffer on every attempt, std::out_of_range for incomplete input, and
+//    `buffer_ = buffer_.substr(pos)` after every value;
+//  - RespValueQueue on RespParser, fed through PushString/PopValue;
+//  - RespValueQueue::Parse in place over the read;
+//  - RespFrameParser over a RecvBuffer, as the IO threads use it, recycling
+//    the RespFrames and receive blocks as the main thread hands them back.
+//
+// Each is also given in heap allocations per command, counted by replacing
+// the global operator new.
+//
+// Then the same for a multi-argument command (an 8-field HSET), and the cost
+// of finding each line's CRLF with every scanner FindCrlf can pick from, for
+// the short lines of a request and the longer ones of simple-string replies.
+//
+//   parser_bench [commands per P, default 200000]
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "network/recv_buffer.h"
+#include "resp_value/resp_frame.h"
+#include "resp_value/resp_frame_parser.h"
+#include "resp_value/resp_scan.h"
+#include "resp_value/resp_value.h"
+#include "resp_value/resp_value_queue.h"
+
+namespace {
+
+std::size_t allocations = 0;
+
+}  // namespace
+
+void* operator new(const std::size_t size) {
+  ++allocations;
+  if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t /*size*/) noexcept { std::free(p); }
+
+namespace {
+
+using myredis::CrlfScanner;
+using myredis::RecvBlock;
+using myredis::RecvBuffer;
+using myredis::RecvBufferPool;
+using myredis::RespFrameParser;
+using myredis::RespFrames;
+using myredis::RespValue;
+using myredis::RespValueQueue;
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t kReadBytes = 16 * 1024;
+
+// RespValueQueue as it was before RespParser.
+class LegacyQueue {
+ public:
+  void PushString(const std::string_view str) { buffer_.append(str); }
+
+  std::optional<RespValue> PopValue() {
+    try {
+      while (true) {
+        auto [val, pos] = RespValue::FromString(buffer_);
+        values_.push(std::move(val));
+        if (pos < buffer_.size()) {
+          buffer_ = buffer_.substr(pos);
+        } else {
+          buffer_.clear();
+        }
+      }
+    } catch (const std::out_of_range&) {  // NOLINT(*-empty-catch)
+    }
+    if (values_.empty()) return std::nullopt;
+    RespValue value = std::move(values_.front());
+    values_.pop();
+    return value;
+  }
+
+ private:
+  std::string buffer_;
+  std::queue<RespValue> values_;
+};
+
+std::string BulkString(const std::string_view s) {
+  return "$" + std::to_string(s.size()) + "\r\n" + std::string(s) + "\r\n";
+}
+
+// `commands` pipelined `SET key:<i> <32 bytes>`, or with `fields` > 0,
+// `HSET key:<i> f0 <32 bytes> ... f<fields-1> <32 bytes>`.
+std::string Pipeline(const std::size_t commands, const std::size_t fields = 0) {
+  const std::string value(32, 'v');
+  std::string batch;
+  for (std::size_t i = 0; i < commands; ++i) {
+    const std::string key = "key:" + std::to_string(i);
+    if (fields == 0) {
+      batch += "*3\r\n" + BulkString("SET") + BulkString(key) +
+               BulkString(value);
+      continue;
+    }
+    batch += "*" + std::to_string(2 + 2 * fields) + "\r\n" +
+             BulkString("HSET") + BulkString(key);
+    for (std::size_t f = 0; f < fields; ++f) {
+      batch += BulkString("f" + std::to_string(f)) + BulkString(value);
+    }
+  }
+  return batch;
+}
+
+// Feeds `batch` in reads of kReadBytes through PushString, popping every
+// value after each read.
+template <typename Queue>
+std::size_t FeedBuffered(Queue& queue, const std::string_view batch) {
+  std::size_t parsed = 0;
+  for (std::size_t off = 0; off < batch.size(); off += kReadBytes) {
+    queue.PushString(batch.substr(off, kReadBytes));
+    while (queue.PopValue()) ++parsed;
+  }
+  return parsed;
+}
+
+// Feeds `batch` through Parse, keeping the unparsed tail as a receive buffer
+// would.
+std::size_t FeedInPlace(RespValueQueue& queue, const std::string_view batch) {
+  std::size_t parsed = 0;
+  std::string tail;
+  for (std::size_t off = 0; off < batch.size(); off += kReadBytes) {
+    std::string_view read = batch.substr(off, kReadBytes);
+    if (!tail.empty()) {
+      tail.append(read);
+      read = tail;
+    }
+    const std::size_t taken = queue.Parse(read).value();
+    std::string rest(read.substr(taken));
+    tail = std::move(rest);
+    while (queue.PopValue()) ++parsed;
+  }
+  return parsed;
+}
+
+// Feeds `batch` through a RespFrameParser, one RespFrames per read.
+std::size_t FeedFrames(RespFrameParser& parser, RecvBuffer& buffer,
+                       RecvBufferPool& pool, RespFrames& frames,
+                       const std::string_view batch) {
+  std::size_t parsed = 0;
+  for (std::size_t off = 0; off < batch.size(); off += kReadBytes) {
+    buffer.Append(batch.substr(off, kReadBytes), pool);
+    if (!parser.Parse(buffer, pool, frames)) std::abort();
+    parsed += frames.Size();
+    for (RecvBlock& block : frames.blocks) pool.Release(std::move(block));
+    frames.blocks.clear();
+    frames.frames.clear();
+    frames.args.clear();
+  }
+  return parsed;
+}
+
+struct Cost {
+  double nanos = 0;
+  double allocations = 0;
+};
+
+std::ostream& operator<<(std::ostream& out, const Cost& cost) {
+  return out << cost.nanos << " ns, " << cost.allocations << " allocations";
+}
+
+template <typename Feed>
+Cost PerCommand(const std::size_t commands, const std::size_t rounds,
+                       Feed&& feed, const std::size_t fields = 0) {
+  const std::string batch = Pipeline(commands, fields);
+  feed(batch);  // warm up pools and buffers
+  std::size_t parsed = 0;
+  const std::size_t allocations_before = allocations;
+  const Clock::time_point start = Clock::now();
+  for (std::size_t r = 0; r < rounds; ++r) parsed += feed(batch);
+  const Clock::duration elapsed = Clock::now() - start;
+  if (parsed != commands * rounds) std::abort();
+  return {.nanos = std::chrono::duration<double, std::nano>(elapsed).count() /
+                   static_cast<double>(parsed),
+          .allocations = static_cast<double>(allocations - allocations_before) /
+                         static_cast<double>(parsed)};
+}
+
+// Finds every line end in `text` (lines of `line_bytes` before their CRLF)
+// `rounds` times with `scanner`.
+double ScanNanosPerLine(const CrlfScanner& scanner,
+                        const std::size_t line_bytes,
+                        const std::size_t rounds) {
+  std::string text;
+  for (int i = 0; i < 256; ++i) text += std::string(line_bytes, 'x') + "\r\n";
+  std::size_t lines = 0;
+  const Clock::time_point start = Clock::now();
+  for (std::size_t r = 0; r < rounds; ++r) {
+    for (std::size_t pos = scanner.find(text, 0); pos != std::string::npos;
+         pos = scanner.find(text, pos + 2)) {
+      ++lines;
+    }
+  }
+  const Clock::duration elapsed = Clock::now() - start;
+  if (lines != 256 * rounds) std::abort();
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         static_cast<double>(lines);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::size_t commands_total =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+  std::cout << "cost per command, pipelined SET batches read "
+            << kReadBytes / 1024 << " KiB at a time\n";
+  for (const std::size_t p : {16, 256}) {
+    const std::size_t rounds = std::max<std::size_t>(commands_total / p, 1);
+    LegacyQueue legacy;
+    RespValueQueue buffered;
+    RespValueQueue in_place;
+    RespFrameParser parser;
+    RecvBuffer buffer;
+    RecvBufferPool pool;
+    RespFrames frames;
+    std::cout << "  P=" << p << "\n"
+              << "    FromString + substr:   "
+              << PerCommand(p, rounds,
+                            [&](const std::string_view batch) {
+                              return FeedBuffered(legacy, batch);
+                            })
+              << "\n"
+              << "    RespParser, buffered:  "
+              << PerCommand(p, rounds,
+                            [&](const std::string_view batch) {
+                              return FeedBuffered(buffered, batch);
+                            })
+              << "\n"
+              << "    RespParser, in place:  "
+              << PerCommand(p, rounds,
+                            [&](const std::string_view batch) {
+                              return FeedInPlace(in_place, batch);
+                            })
+              << "\n"
+              << "    RespFrameParser:       "
+              << PerCommand(p, rounds,
+                            [&](const std::string_view batch) {
+                              return FeedFrames(parser, buffer, pool, frames,
+                                                batch);
+                            })
+              << "\n";
+  }
+
+  const std::size_t hset_rounds =
+      std::max<std::size_t>(commands_total / 256, 1);
+  RespValueQueue multi_arg;
+  RespFrameParser parser;
+  RecvBuffer buffer;
+  RecvBufferPool pool;
+  RespFrames frames;
+  std::cout << "  P=256, HSET with 8 fields\n"
+            << "    RespParser, in place:  "
+            << PerCommand(
+                   256, hset_rounds,
+                   [&](const std::string_view batch) {
+                     return FeedInPlace(multi_arg, batch);
+                   },
+                   /*fields=*/8)
+            << "\n"
+            << "    RespFrameParser:       "
+            << PerCommand(
+                   256, hset_rounds,
+                   [&](const std::string_view batch) {
+                     return FeedFrames(parser, buffer, pool, frames, batch);
+                   },
+                   /*fields=*/8)
+            << "\n\n";
+
+  std::cout << "ns per line to find its CRLF (FindCrlf uses "
+            << myredis::ActiveCrlfScanner().name << ")\n";
+  for (const std::size_t line_bytes : {4, 60, 500}) {
+    std::cout << "  " << line_bytes << "-byte lines\n";
+    std::vector<CrlfScanner> scanners = myredis::SupportedCrlfScanners();
+    scanners.insert(scanners.begin(), CrlfScanner{
+        "string_view::find",
+        [](const std::string_view input, const std::size_t from) {
+          return input.find("\r\n", from);
+        }});
+    for (const CrlfScanner& scanner : scanners) {
+      std::cout << "    " << scanner.name << ": "
+                << ScanNanosPerLine(scanner, line_bytes, 20000) << "\n";
+    }
+  }
+  return EXIT_SUCCESS;
+}
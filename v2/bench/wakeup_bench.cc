@@ -0,0 +1,132 @@
+// Wakeup latency of the two ways one thread can wake another blocked in
+// poll/epoll: a bare EventFd written on every message, and a Waker that only
+// writes it when the consumer has parked.
+//
+// Two threads ping-pong a counter. Each round, one side publishes the next
+// value and wakes the other, then waits for the reply; the reported figure is
+// the round trip divided by two. A second run measures what a producer pays
+// per message while the consumer is busy and never parks.
+//
+//   wakeup_bench [rounds]
+
+#include <poll.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include "concurrent/event_fd.h"
+#include "concurrent/waker.h"
+
+namespace {
+
+using myredis::EventFd;
+using myredis::Waker;
+using Clock = std::chrono::steady_clock;
+
+void WaitReadable(const int fd) {
+  pollfd pfd{.fd = fd, .events = POLLIN, .revents = 0};
+  while (poll(&pfd, 1, -1) < 0) {
+  }
+}
+
+// One direction of the ping-pong: the value last published to this side.
+struct EventFdChannel {
+  std::atomic<std::uint64_t> value{0};
+  EventFd event;
+
+  void Send(const std::uint64_t v) {
+    value.store(v, std::memory_order_release);
+    event.Notify();
+  }
+  void AwaitValue(const std::uint64_t v) {
+    while (value.load(std::memory_order_acquire) != v) {
+      WaitReadable(event.Fd());
+      event.Drain();
+    }
+  }
+};
+
+struct WakerChannel {
+  std::atomic<std::uint64_t> value{0};
+  Waker waker;
+
+  void Send(const std::uint64_t v) {
+    value.store(v, std::memory_order_release);
+    waker.Notify();
+  }
+  void AwaitValue(const std::uint64_t v) {
+    const auto arrived = [this, v] {
+      return value.load(std::memory_order_acquire) == v;
+    };
+    while (!arrived()) {
+      if (waker.PrepareToPark(arrived)) {
+        WaitReadable(waker.Fd());
+        waker.Unpark();
+        waker.Drain();
+      }
+    }
+  }
+};
+
+template <typename Channel>
+double PingPongNanos(const std::uint64_t rounds) {
+  Channel to_ponger;
+  Channel to_pinger;
+  std::thread ponger([&] {
+    for (std::uint64_t i = 1; i <= rounds; ++i) {
+      to_ponger.AwaitValue(i);
+      to_pinger.Send(i);
+    }
+  });
+  const Clock::time_point start = Clock::now();
+  for (std::uint64_t i = 1; i <= rounds; ++i) {
+    to_ponger.Send(i);
+    to_pinger.AwaitValue(i);
+  }
+  const Clock::duration elapsed = Clock::now() - start;
+  ponger.join();
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         static_cast<double>(rounds * 2);
+}
+
+// The producer sends `rounds` messages to a consumer that never parks, so
+// every Waker::Notify finds it awake.
+template <typename Channel>
+double BusyConsumerNotifyNanos(const std::uint64_t rounds) {
+  Channel channel;
+  std::atomic<bool> done{false};
+  std::thread consumer([&] {
+    while (!done.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  });
+  const Clock::time_point start = Clock::now();
+  for (std::uint64_t i = 1; i <= rounds; ++i) channel.Send(i);
+  const Clock::duration elapsed = Clock::now() - start;
+  done.store(true, std::memory_order_release);
+  consumer.join();
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         static_cast<double>(rounds);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::uint64_t rounds =
+      argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+  std::cout << "rounds: " << rounds
+            << ", cpus: " << std::thread::hardware_concurrency() << "\n\n";
+  std::cout << "one-way wakeup latency (ns)\n"
+            << "  EventFd: " << PingPongNanos<EventFdChannel>(rounds) << "\n"
+            << "  Waker:   " << PingPongNanos<WakerChannel>(rounds) << "\n\n";
+  std::cout << "notify cost with the consumer awake (ns/message)\n"
+            << "  EventFd: " << BusyConsumerNotifyNanos<EventFdChannel>(rounds)
+            << "\n"
+            << "  Waker:   " << BusyConsumerNotifyNanos<WakerChannel>(rounds)
+            << "\n";
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+#ifndef MYREDIS_CONCURRENT_EPOCH_DOMAIN_H_
+#define MYREDIS_CONCURRENT_EPOCH_DOMAIN_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace myredis {
+
+// Epoch-based reclamation for one writer and a fixed set of readers, so that
+// the writer can unlink an object from a shared structure while readers may
+// still be looking at it, and free it only once none can be.
+//
+// A reader Pins its slot for the length of each read: the pin records the
+// global epoch it started in. The writer Retires what it unlinks, tagged with
+// the current epoch, and now and then Reclaims: it moves the epoch on once
+// every pinned reader has caught up with it, and frees what was retired two
+// epochs ago, which no pinned reader can have seen. Readers never wait, and
+// the writer never waits for them either: a slow reader only holds back the
+// freeing of what was retired since it pinned.
+class EpochDomain {
+ public:
+  // Reader slots are numbered 0 to `readers` - 1; each is used by one thread.
+  explicit EpochDomain(const std::size_t readers) : slots_(readers) {}
+  // Frees whatever is still retired. No reader may be pinned.
+  ~EpochDomain() {
+    for (const Retired& retired : retired_) retired.free(retired.object);
+  }
+
+  EpochDomain(const EpochDomain&) = delete;
+  EpochDomain& operator=(const EpochDomain&) = delete;
+
+  // Keeps what the reader saw while pinned from being freed, until it goes.
+  class Guard {
+   public:
+    ~Guard() { slot_.store(kIdle, std::memory_order_release); }
+
+    Guard(const Guard&) = delete;
+    Guard& operator=(const Guard&) = delete;
+
+   private:
+    friend class EpochDomain;
+    explicit Guard(std::atomic<std::uint64_t>& slot) : slot_(slot) {}
+
+    std::atomic<std::uint64_t>& slot_;
+  };
+
+  // Reader `reader` only, and not while already pinned.
+  [[nodiscard]] Guard Pin(const std::size_t reader) {
+    std::atomic<std::uint64_t>& slot = slots_[reader].epoch;
+    std::uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+    while (true) {
+      slot.store(epoch, std::memory_order_relaxed);
+      // Pairs with the fence in Reclaim: either the writer sees this pin, or
+      // we see everything it unlinked before looking.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const std::uint64_t now = epoch_.load(std::memory_order_relaxed);
+      if (now == epoch) break;
+      epoch = now;  // moved on under us: pin the newer one
+    }
+    return Guard(slot);
+  }
+
+  // Writer only: frees `object` (with delete) once no reader can be using it.
+  // It must already be unreachable for readers that pin from now on.
+  template <typename T>
+  void Retire(T* object) {
+    retired_.push_back(
+        {.epoch = epoch_.load(std::memory_order_relaxed),
+         .object = object,
+         .free = [](void* retired) { delete static_cast<T*>(retired); }});
+    if (retired_.size() >= reclaim_at_) Reclaim();
+  }
+
+  // Writer only: moves the epoch on if it can, and frees what that makes
+  // safe to.
+  void Reclaim() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const std::uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+    bool caught_up = true;
+    for (const Slot& slot : slots_) {
+      const std::uint64_t pinned = slot.epoch.load(std::memory_order_acquire);
+      caught_up &= pinned == kIdle || pinned == epoch;
+    }
+    if (caught_up) epoch_.store(epoch + 1, std::memory_order_seq_cst);
+    const std::uint64_t safe = epoch_.load(std::memory_order_relaxed);
+    while (!retired_.empty() && retired_.front().epoch + 2 <= safe) {
+      retired_.front().free(retired_.front().object);
+      retired_.pop_front();
+    }
+    // Backs off while a reader holds things up, rather than trying on every
+    // Retire.
+    reclaim_at_ = retired_.size() + kReclaimBatch;
+  }
+
+ private:
+  static constexpr std::uint64_t kIdle = 0;
+  static constexpr std::size_t kReclaimBatch = 64;
+
+  // Each reader's own cache line.
+  struct alignas(64) Slot {
+    std::atomic<std::uint64_t> epoch{kIdle};
+  };
+
+  struct Retired {
+    std::uint64_t epoch;
+    void* object;
+    void (*free)(void*);
+  };
+
+  alignas(64) std::atomic<std::uint64_t> epoch_{kIdle + 1};
+  std::vector<Slot> slots_;
+  // Writer only, oldest first.
+  std::deque<Retired> retired_;
+  std::size_t reclaim_at_ = kReclaimBatch;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_CONCURRENT_EPOCH_DOMAIN_H_
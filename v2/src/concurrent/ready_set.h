@@ -0,0 +1,88 @@
+#ifndef MYREDIS_CONCURRENT_READY_SET_H_
+#define MYREDIS_CONCURRENT_READY_SET_H_
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "concurrent/waker.h"
+
+namespace myredis {
+
+// A set of producer indices with work for a single consumer, plus the wakeup
+// that tells the consumer to look. Producers Mark() their index; the consumer
+// calls Drain() to visit only the producers that marked since the last drain,
+// rather than polling all of them.
+//
+// Wakeups go through a Waker: a Mark only writes the eventfd when the consumer
+// has parked, so while it is busy draining, marks cost no syscall. The
+// consumer follows the Waker protocol through PrepareToPark/Unpark/ResetWakeup
+// and must Drain on every pass of its loop, not only when Fd() fires.
+class ReadySet {
+ public:
+  explicit ReadySet(std::size_t size) : words_((size + kBits - 1) / kBits) {}
+
+  ReadySet(const ReadySet&) = delete;
+  ReadySet& operator=(const ReadySet&) = delete;
+
+  // The eventfd the consumer watches (level-triggered EPOLLIN).
+  [[nodiscard]] int Fd() const { return waker_.Fd(); }
+
+  // Flags `index` as having work and wakes the consumer if it is parked. Safe
+  // to call from any thread.
+  void Mark(const std::size_t index) {
+    words_[index / kBits].bits.fetch_or(std::uint64_t{1} << (index % kBits),
+                                        std::memory_order_release);
+    waker_.Notify();
+  }
+
+  // Whether any index is marked. Safe to call from any thread.
+  [[nodiscard]] bool AnyMarked() const {
+    for (const Word& word : words_) {
+      if (word.bits.load(std::memory_order_acquire) != 0) return true;
+    }
+    return false;
+  }
+
+  // Consumer only: see Waker::PrepareToPark; the work is a marked index.
+  bool PrepareToPark() {
+    return waker_.PrepareToPark([this] { return AnyMarked(); });
+  }
+
+  // Consumer only: see Waker::Unpark.
+  void Unpark() { waker_.Unpark(); }
+
+  // Consumer only: resets the eventfd once Fd() was reported readable.
+  void ResetWakeup() const { waker_.Drain(); }
+
+  // Consumer only: calls `visit(index)` once for each index marked since the
+  // last Drain, in ascending order.
+  template <typename Visit>
+  void Drain(Visit&& visit) {
+    for (std::size_t w = 0; w < words_.size(); ++w) {
+      std::uint64_t bits =
+          words_[w].bits.exchange(0, std::memory_order_acquire);
+      while (bits != 0) {
+        visit(w * kBits + static_cast<std::size_t>(std::countr_zero(bits)));
+        bits &= bits - 1;
+      }
+    }
+  }
+
+ private:
+  static constexpr std::size_t kBits = 64;
+
+  // Producers on different words must not share a cache line.
+  struct alignas(64) Word {
+    std::atomic<std::uint64_t> bits{0};
+  };
+
+  std::vector<Word> words_;
+  alignas(64) Waker waker_;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_CONCURRENT_READY_SET_H_
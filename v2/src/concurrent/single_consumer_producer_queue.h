@@ -1,44 +1,154 @@
 #ifndef MY_REDIS_SINGLE_CONSUMER_PRODUCER_QUEUE_H
 #define MY_REDIS_SINGLE_CONSUMER_PRODUCER_QUEUE_H
-#include <array>
+#include <algorithm>
 #include <atomic>
+#include <bit>
+#include <cstddef>
+#include <new>
 #include <optional>
+#include <utility>
 
 namespace myredis {
 
+// Bounded single-producer single-consumer ring of N elements (a power of two).
+//
+// head_ and tail_ count every element ever popped and pushed, and index the
+// ring through a mask. Each side keeps its own index, plus a cached copy of
+// the other side's, on its own cache line. It only reloads the other side's
+// index when the cached one says the ring is full (producer) or empty
+// (consumer), so in steady state neither side touches the other's line.
+//
+// Elements are constructed in place by Emplace/Push/PushBatch and handed to
+// the consumer by reference in Consume/PopBatch. The batch calls publish
+// their index once for the whole batch.
 template <typename T, std::size_t N>
 class SingleConsumerProducerQueue {
-  std::array<std::optional<T>, N + 1> buffer_{};
-  std::atomic<size_t> head_{0};
-  std::atomic<size_t> tail_{0};
+  static_assert(std::has_single_bit(N), "capacity must be a power of two");
 
-  static size_t increment(const size_t n) {
-    return (n + 1) % (N+1);
+ public:
+  SingleConsumerProducerQueue() = default;
+  SingleConsumerProducerQueue(const SingleConsumerProducerQueue&) = delete;
+  SingleConsumerProducerQueue& operator=(const SingleConsumerProducerQueue&) =
+      delete;
+
+  ~SingleConsumerProducerQueue() {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    for (std::size_t h = head_.load(std::memory_order_relaxed); h != tail;
+         ++h) {
+      Slot(h)->~T();
+    }
+  }
+
+  // Producer: constructs an element from `args` at the tail. Returns false,
+  // leaving `args` untouched, if the ring is full.
+  template <typename... Args>
+  [[nodiscard]] bool Emplace(Args&&... args) {
+    const std::size_t t = tail_.load(std::memory_order_relaxed);
+    if (Room(t) == 0) return false;
+    ::new (Slot(t)) T(std::forward<Args>(args)...);
+    tail_.store(t + 1, std::memory_order_release);
+    return true;
   }
 
-public:
-  [[nodiscard]] bool Push(T element) {
-    const size_t t = tail_.load(std::memory_order_relaxed);  // we own tail_
-    if (increment(t) == head_.load(std::memory_order_acquire)) {
-      return false;
+  // Producer: moves `element` in at the tail. Only a successful push moves
+  // from it: if the ring is full it returns false and `element` is intact, so
+  // the caller can hold on to it and retry without having copied it first.
+  [[nodiscard]] bool Push(T&& element) { return Emplace(std::move(element)); }
+
+  // Producer: moves elements from [first, last) in order until the ring is
+  // full, publishing them together. Returns how many were taken; the rest
+  // are left untouched.
+  template <typename It>
+  std::size_t PushBatch(It first, const It last) {
+    const std::size_t t = tail_.load(std::memory_order_relaxed);
+    const std::size_t room = Room(t);
+    std::size_t pushed = 0;
+    for (; pushed < room && first != last; ++pushed, ++first) {
+      ::new (Slot(t + pushed)) T(std::move(*first));
     }
+    if (pushed > 0) tail_.store(t + pushed, std::memory_order_release);
+    return pushed;
+  }
 
-    buffer_[t] = std::move(element);
-    tail_.store(increment(t), std::memory_order_release);
+  // Consumer: calls `fn(T&)` on the head element in place, then destroys it.
+  // Returns false if the ring is empty.
+  template <typename F>
+  bool Consume(F&& fn) {
+    const std::size_t h = head_.load(std::memory_order_relaxed);
+    if (Available(h) == 0) return false;
+    T* const element = Slot(h);
+    fn(*element);
+    element->~T();
+    head_.store(h + 1, std::memory_order_release);
     return true;
   }
 
   [[nodiscard]] std::optional<T> Pop() {
-    const size_t h = head_.load(std::memory_order_relaxed); // we own head_
-    if (h == tail_.load(std::memory_order_acquire)) {
-      return std::nullopt;
+    std::optional<T> element;
+    Consume([&element](T& e) { element.emplace(std::move(e)); });
+    return element;
+  }
+
+  // Consumer: calls `fn(T&)` in order on every element present when the call
+  // starts, up to `max`, then frees their slots together. Returns how many
+  // were consumed. The producer cannot reuse the slots until it returns.
+  template <typename F>
+  std::size_t PopBatch(F&& fn, const std::size_t max = N) {
+    const std::size_t h = head_.load(std::memory_order_relaxed);
+    tail_cache_ = tail_.load(std::memory_order_acquire);
+    const std::size_t count = std::min(tail_cache_ - h, max);
+    for (std::size_t i = 0; i < count; ++i) {
+      T* const element = Slot(h + i);
+      fn(*element);
+      element->~T();
+    }
+    if (count > 0) head_.store(h + count, std::memory_order_release);
+    return count;
+  }
+
+  // Number of queued elements. Exact from either end's own thread; from any
+  // other thread it is a momentary snapshot.
+  [[nodiscard]] std::size_t Size() const {
+    const std::size_t h = head_.load(std::memory_order_acquire);
+    const std::size_t t = tail_.load(std::memory_order_acquire);
+    return t - h;
+  }
+
+ private:
+  static constexpr std::size_t kCacheLine = 64;
+
+  // Free slots as the producer sees them, reloading head_ only when the
+  // cached copy shows the ring full.
+  std::size_t Room(const std::size_t t) {
+    if (t - head_cache_ == N) {
+      head_cache_ = head_.load(std::memory_order_acquire);
     }
+    return N - (t - head_cache_);
+  }
 
-    std::optional<T> element = std::move(buffer_[h]);
-    buffer_[h].reset();
-    head_.store(increment(h), std::memory_order_release);
-    return element;
+  // Queued elements as the consumer sees them, reloading tail_ only when the
+  // cached copy shows the ring empty.
+  std::size_t Available(const std::size_t h) {
+    if (tail_cache_ == h) tail_cache_ = tail_.load(std::memory_order_acquire);
+    return tail_cache_ - h;
+  }
+
+  T* Slot(const std::size_t position) {
+    return std::launder(
+        reinterpret_cast<T*>(storage_[position & (N - 1)].bytes));
   }
+
+  struct alignas(T) Storage {
+    std::byte bytes[sizeof(T)];
+  };
+
+  // Producer line.
+  alignas(kCacheLine) std::atomic<std::size_t> tail_{0};
+  std::size_t head_cache_ = 0;
+  // Consumer line.
+  alignas(kCacheLine) std::atomic<std::size_t> head_{0};
+  std::size_t tail_cache_ = 0;
+  alignas(kCacheLine) Storage storage_[N];
 };
 } // namespace myredis
 
@@ -0,0 +1,125 @@
+#ifndef MYREDIS_CONCURRENT_WAKER_H_
+#define MYREDIS_CONCURRENT_WAKER_H_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "concurrent/event_fd.h"
+
+namespace myredis {
+
+// Tells the CPU we are busy-waiting (lets a sibling hyperthread run, saves
+// power), where the architecture has such a hint.
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+// Wakes one consumer thread that blocks in epoll or io_uring on Fd(), without
+// an eventfd write per message. The consumer spins briefly for work before it
+// parks, and announces that it is parking; producers only write the eventfd
+// when they find it parked. While the consumer is awake, Notify is a fence and
+// a load, no syscall.
+//
+// The spin budget adapts: it grows when a spin finds work or a Notify cuts a
+// park short soon after it began (a little more spinning would have caught
+// it), and shrinks when a park outlasts that window. It is zero on a single
+// CPU, where spinning only delays the producer.
+//
+// Consumer protocol, once it has run out of work:
+//
+//   if (waker.PrepareToPark(has_work)) {
+//     block on Fd() (and anything else) ...
+//     waker.Unpark();
+//   }
+//   if Fd() was reported readable: waker.Drain();
+//   look for work
+class Waker {
+ public:
+  Waker()
+      : max_spins_(std::thread::hardware_concurrency() > 1 ? kMaxSpins : 0) {}
+
+  Waker(const Waker&) = delete;
+  Waker& operator=(const Waker&) = delete;
+
+  // The eventfd the consumer blocks on (level-triggered EPOLLIN).
+  [[nodiscard]] int Fd() const { return event_.Fd(); }
+
+  // Producer: call after publishing work. Safe to call from any thread.
+  void Notify() {
+    // Pairs with the fence in PrepareToPark: either the consumer sees our work
+    // before it blocks, or we see it parked and wake it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked_.load(std::memory_order_relaxed) &&
+        parked_.exchange(false, std::memory_order_relaxed)) {
+      event_.Notify();
+    }
+  }
+
+  // Consumer: spins while `has_work()` is false, up to the current budget.
+  // Returns false if work turned up (do not block), true if the consumer is
+  // now parked and must block until Fd() or another of its events fires, then
+  // call Unpark.
+  template <typename HasWork>
+  bool PrepareToPark(const HasWork& has_work) {
+    for (unsigned spins = 0; spins < spin_limit_; ++spins) {
+      if (has_work()) {
+        if (spins > 0) Grow();
+        return false;
+      }
+      CpuRelax();
+    }
+    parked_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (has_work()) {
+      // A producer that already claimed the wakeup still writes the eventfd;
+      // that costs one spurious wakeup.
+      parked_.store(false, std::memory_order_relaxed);
+      return false;
+    }
+    park_start_ = std::chrono::steady_clock::now();
+    return true;
+  }
+
+  // Consumer: call once the wait that followed PrepareToPark has returned.
+  void Unpark() {
+    const bool notified = !parked_.exchange(false, std::memory_order_relaxed);
+    if (notified &&
+        std::chrono::steady_clock::now() - park_start_ < kShortPark) {
+      Grow();
+    } else {
+      spin_limit_ /= 2;
+    }
+  }
+
+  // Consumer: resets the eventfd once its wait reported it readable.
+  void Drain() const { event_.Drain(); }
+
+ private:
+  // Each spin is one CpuRelax plus a has_work() check: roughly 10-40ns, so
+  // the budget tops out at a few tens of microseconds.
+  static constexpr unsigned kMaxSpins = 1024;
+  static constexpr unsigned kSpinStep = 16;
+  // A park a Notify ends within this long was not worth its two syscalls.
+  static constexpr std::chrono::microseconds kShortPark{50};
+
+  void Grow() {
+    spin_limit_ = std::min(max_spins_, spin_limit_ * 2 + kSpinStep);
+  }
+
+  EventFd event_;
+  std::atomic<bool> parked_{false};
+  // Consumer-only state.
+  const unsigned max_spins_;
+  unsigned spin_limit_ = 0;
+  std::chrono::steady_clock::time_point park_start_;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_CONCURRENT_WAKER_H_
@@ -0,0 +1,203 @@
+#include "io_uring.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace myredis {
+
+namespace {
+int SetupRing(unsigned entries, io_uring_params& params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+}
+
+int Register(int ring_fd, unsigned opcode, const void* arg, unsigned nr_args) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+}  // namespace
+
+IoUring::IoUring(const unsigned entries, const unsigned cq_entries) {
+  io_uring_params params{};
+  // The owning IO thread is the only submitter, and it only reaps completions
+  // from inside io_uring_enter, so the kernel can defer task work until then
+  // instead of interrupting the thread with IPIs.
+  params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER |
+                 IORING_SETUP_COOP_TASKRUN | IORING_SETUP_SUBMIT_ALL;
+  params.cq_entries = cq_entries;
+  ring_fd_ = SetupRing(entries, params);
+  if (ring_fd_ < 0) return;
+
+  // Every kernel new enough for SINGLE_ISSUER maps both rings with one mmap.
+  if ((params.features & IORING_FEAT_SINGLE_MMAP) == 0) {
+    close(ring_fd_);
+    ring_fd_ = -1;
+    return;
+  }
+
+  ring_map_size_ =
+      std::max(params.sq_off.array + (params.sq_entries * sizeof(unsigned)),
+               params.cq_off.cqes + (params.cq_entries * sizeof(io_uring_cqe)));
+  ring_map_ = mmap(nullptr, ring_map_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  sqes_map_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes_map = mmap(nullptr, sqes_map_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (ring_map_ == MAP_FAILED || sqes_map == MAP_FAILED) {
+    if (ring_map_ != MAP_FAILED) munmap(ring_map_, ring_map_size_);
+    if (sqes_map != MAP_FAILED) munmap(sqes_map, sqes_map_size_);
+    ring_map_ = nullptr;
+    close(ring_fd_);
+    ring_fd_ = -1;
+    return;
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes_map);
+
+  auto* base = static_cast<char*>(ring_map_);
+  sq_head_ = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  cq_head_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+  // SQEs are always used in ring order, so the indirection array is the
+  // identity mapping and never needs touching again.
+  auto* sq_array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+  for (unsigned i = 0; i < sq_entries_; ++i) sq_array[i] = i;
+  sq_local_tail_ = *sq_tail_;
+}
+
+IoUring::~IoUring() {
+  if (ring_fd_ < 0) return;
+  munmap(sqes_, sqes_map_size_);
+  munmap(ring_map_, ring_map_size_);
+  close(ring_fd_);
+}
+
+bool IoUring::IsSupported() {
+  IoUring probe(/*entries=*/2, /*cq_entries=*/4);
+  if (!probe.Valid()) return false;
+  // Provided buffer rings arrived in 5.19 and multishot recv in 6.0; a kernel
+  // accepting SINGLE_ISSUER (6.0) has both, so registering a ring is the last
+  // thing left to check.
+  BufferRing buffers(probe, /*group_id=*/0, /*count=*/1, /*buffer_size=*/64);
+  return buffers.Valid();
+}
+
+io_uring_sqe* IoUring::GetSqe() {
+  const unsigned head =
+      std::atomic_ref(*sq_head_).load(std::memory_order_acquire);
+  if (sq_local_tail_ - head >= sq_entries_) return nullptr;
+  io_uring_sqe* sqe = &sqes_[sq_local_tail_ & sq_mask_];
+  ++sq_local_tail_;
+  std::memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+unsigned IoUring::SqSpaceLeft() const {
+  const unsigned head =
+      std::atomic_ref(*sq_head_).load(std::memory_order_acquire);
+  return sq_entries_ - (sq_local_tail_ - head);
+}
+
+int IoUring::Submit() { return SubmitAndWait(0); }
+
+int IoUring::SubmitAndWait(const unsigned wait_nr) {
+  // Publish the SQEs filled in since the last submit.
+  const unsigned published =
+      std::atomic_ref(*sq_tail_).load(std::memory_order_relaxed);
+  const unsigned to_submit = sq_local_tail_ - published;
+  std::atomic_ref(*sq_tail_).store(sq_local_tail_, std::memory_order_release);
+  if (to_submit == 0 && wait_nr == 0) return 0;
+  return Enter(to_submit, wait_nr, wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0);
+}
+
+int IoUring::Enter(const unsigned to_submit, const unsigned min_complete,
+                   const unsigned flags) {
+  const long result = syscall(__NR_io_uring_enter, ring_fd_, to_submit,
+                              min_complete, flags, nullptr, 0);
+  return result < 0 ? -errno : static_cast<int>(result);
+}
+
+bool IoUring::RegisterSparseFiles(const unsigned count) {
+  io_uring_rsrc_register reg{};
+  reg.nr = count;
+  reg.flags = IORING_RSRC_REGISTER_SPARSE;
+  return Register(ring_fd_, IORING_REGISTER_FILES2, &reg, sizeof(reg)) == 0;
+}
+
+bool IoUring::UpdateFile(const unsigned slot, int fd) {
+  io_uring_files_update update{};
+  update.offset = slot;
+  update.fds = reinterpret_cast<std::uint64_t>(&fd);
+  return Register(ring_fd_, IORING_REGISTER_FILES_UPDATE, &update, 1) == 1;
+}
+
+bool IoUring::RegisterBufferRing(io_uring_buf_ring* ring,
+                                 const unsigned ring_entries,
+                                 const std::uint16_t group_id) {
+  io_uring_buf_reg reg{};
+  reg.ring_addr = reinterpret_cast<std::uint64_t>(ring);
+  reg.ring_entries = ring_entries;
+  reg.bgid = group_id;
+  return Register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) == 0;
+}
+
+void IoUring::UnregisterBufferRing(const std::uint16_t group_id) {
+  io_uring_buf_reg reg{};
+  reg.bgid = group_id;
+  Register(ring_fd_, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+}
+
+BufferRing::BufferRing(IoUring& ring, const std::uint16_t group_id,
+                       const unsigned count, const std::size_t buffer_size)
+    : ring_(ring),
+      group_id_(group_id),
+      count_(count),
+      buffer_size_(buffer_size),
+      storage_(static_cast<std::size_t>(count) * buffer_size) {
+  // The kernel requires the ring itself to be page aligned.
+  buf_ring_size_ = count * sizeof(io_uring_buf);
+  void* mem = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) return;
+  buf_ring_ = static_cast<io_uring_buf_ring*>(mem);
+
+  if (!ring_.RegisterBufferRing(buf_ring_, count_, group_id_)) return;
+  registered_ = true;
+  for (unsigned bid = 0; bid < count_; ++bid) {
+    Add(static_cast<std::uint16_t>(bid));
+  }
+}
+
+BufferRing::~BufferRing() {
+  if (registered_) ring_.UnregisterBufferRing(group_id_);
+  if (buf_ring_ != nullptr) munmap(buf_ring_, buf_ring_size_);
+}
+
+void BufferRing::Recycle(const std::uint16_t bid) { Add(bid); }
+
+void BufferRing::Add(const std::uint16_t bid) {
+  // The tail overlays bufs[0].resv; the kernel only ever reads it, so we own
+  // it and can update the slot before publishing the new tail. The entries are
+  // indexed off the ring base rather than through `bufs`: in C++ the uapi
+  // header's flexible-array wrapper gains a one-byte empty member, shifting
+  // `bufs` eight bytes past where the kernel expects it.
+  const std::uint16_t tail = buf_ring_->tail;
+  io_uring_buf& buf =
+      reinterpret_cast<io_uring_buf*>(buf_ring_)[tail & (count_ - 1)];
+  buf.addr = reinterpret_cast<std::uint64_t>(Data(bid));
+  buf.len = static_cast<std::uint32_t>(buffer_size_);
+  buf.bid = bid;
+  std::atomic_ref(buf_ring_->tail)
+      .store(static_cast<std::uint16_t>(tail + 1), std::memory_order_release);
+}
+
+}  // namespace myredis
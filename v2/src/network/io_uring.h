@@ -0,0 +1,160 @@
+#ifndef MYREDIS_NETWORK_IO_URING_H_
+#define MYREDIS_NETWORK_IO_URING_H_
+
+#include <linux/io_uring.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace myredis {
+
+// A minimal RAII io_uring, driven directly through the raw syscalls (the build
+// has no liburing dependency). It exposes just what the server's IO threads
+// need: SQE acquisition, submit-and-wait, CQE iteration, a sparse registered
+// file table and kernel-provided buffer rings.
+//
+// Created with IORING_SETUP_SINGLE_ISSUER, so a ring must be constructed, fed
+// and reaped by one thread only: the IO thread that owns it.
+class IoUring {
+ public:
+  // Sets up a ring with `entries` SQ slots and `cq_entries` CQ slots. Check
+  // Valid() before use; setup fails on kernels without io_uring (or without
+  // the >= 6.0 features the server relies on).
+  IoUring(unsigned entries, unsigned cq_entries);
+  ~IoUring();
+
+  // Non-copyable, non-movable: the kernel holds pointers into our mappings.
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+  IoUring(IoUring&&) = delete;
+  IoUring& operator=(IoUring&&) = delete;
+
+  // True when this kernel supports every io_uring feature the server uses
+  // (single-issuer rings, provided buffer rings, multishot recv). Creates and
+  // tears down a throwaway ring, so call once at startup.
+  static bool IsSupported();
+
+  [[nodiscard]] bool Valid() const { return ring_fd_ >= 0; }
+  [[nodiscard]] int Fd() const { return ring_fd_; }
+
+  // Returns a zeroed SQE to fill in, or nullptr if the submission queue is
+  // full (call Submit() to hand the queued entries to the kernel first).
+  io_uring_sqe* GetSqe();
+
+  // Number of SQEs that can be acquired before the queue is full.
+  [[nodiscard]] unsigned SqSpaceLeft() const;
+
+  // Submits every queued SQE without waiting. Returns the number submitted or
+  // -errno.
+  int Submit();
+
+  // Submits every queued SQE and blocks until at least `wait_nr` completions
+  // are available. Returns -errno on failure (notably -EINTR).
+  int SubmitAndWait(unsigned wait_nr);
+
+  // Whether completions are waiting in the CQ, without entering the kernel.
+  [[nodiscard]] bool CqReady() const {
+    return std::atomic_ref(*cq_head_).load(std::memory_order_relaxed) !=
+           std::atomic_ref(*cq_tail_).load(std::memory_order_acquire);
+  }
+
+  // Invokes `fn(const io_uring_cqe&)` for every completion currently in the CQ
+  // and then marks them consumed. `fn` may acquire new SQEs. Returns the
+  // number of completions seen.
+  template <typename F>
+  unsigned ForEachCqe(F&& fn) {
+    unsigned seen = 0;
+    unsigned head = std::atomic_ref(*cq_head_).load(std::memory_order_relaxed);
+    const unsigned tail =
+        std::atomic_ref(*cq_tail_).load(std::memory_order_acquire);
+    while (head != tail) {
+      fn(cqes_[head & cq_mask_]);
+      ++head;
+      ++seen;
+    }
+    std::atomic_ref(*cq_head_).store(head, std::memory_order_release);
+    return seen;
+  }
+
+  // Registers a sparse table of `count` fixed-file slots. Returns false if the
+  // kernel refused (e.g. `count` exceeds RLIMIT_NOFILE).
+  bool RegisterSparseFiles(unsigned count);
+  // Points fixed-file `slot` at `fd`, or clears it when `fd` is -1.
+  bool UpdateFile(unsigned slot, int fd);
+
+  // Registers `ring_entries` (a power of two) io_uring_buf slots living at
+  // `ring` as provided-buffer group `group_id`.
+  bool RegisterBufferRing(io_uring_buf_ring* ring, unsigned ring_entries,
+                          std::uint16_t group_id);
+  void UnregisterBufferRing(std::uint16_t group_id);
+
+ private:
+  int Enter(unsigned to_submit, unsigned min_complete, unsigned flags);
+
+  int ring_fd_ = -1;
+
+  void* ring_map_ = nullptr;
+  std::size_t ring_map_size_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  std::size_t sqes_map_size_ = 0;
+
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+  // SQEs handed out by GetSqe but not yet published to the kernel.
+  unsigned sq_local_tail_ = 0;
+
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+};
+
+// A kernel-provided buffer ring: `count` equally sized receive buffers the
+// kernel picks from when a recv SQE carries IOSQE_BUFFER_SELECT. The CQE names
+// the buffer it filled (Bid); hand it back with Recycle once its bytes have
+// been consumed.
+class BufferRing {
+ public:
+  // `count` must be a power of two. Check Valid() before use.
+  BufferRing(IoUring& ring, std::uint16_t group_id, unsigned count,
+             std::size_t buffer_size);
+  ~BufferRing();
+
+  BufferRing(const BufferRing&) = delete;
+  BufferRing& operator=(const BufferRing&) = delete;
+
+  [[nodiscard]] bool Valid() const { return registered_; }
+  [[nodiscard]] std::uint16_t GroupId() const { return group_id_; }
+
+  // The buffer id a completion reports in its flags.
+  static std::uint16_t Bid(const io_uring_cqe& cqe) {
+    return static_cast<std::uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+  }
+  [[nodiscard]] const char* Data(std::uint16_t bid) const {
+    return storage_.data() + (static_cast<std::size_t>(bid) * buffer_size_);
+  }
+
+  // Returns buffer `bid` to the kernel.
+  void Recycle(std::uint16_t bid);
+
+ private:
+  void Add(std::uint16_t bid);
+
+  IoUring& ring_;
+  const std::uint16_t group_id_;
+  const unsigned count_;
+  const std::size_t buffer_size_;
+
+  io_uring_buf_ring* buf_ring_ = nullptr;
+  std::size_t buf_ring_size_ = 0;
+  std::vector<char> storage_;
+  bool registered_ = false;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_NETWORK_IO_URING_H_
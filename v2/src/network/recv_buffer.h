@@ -0,0 +1,186 @@
+#ifndef MYREDIS_NETWORK_RECV_BUFFER_H_
+#define MYREDIS_NETWORK_RECV_BUFFER_H_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace myredis {
+
+// A block of receive memory: 4 KiB << size_class bytes.
+//
+// Shared, so that requests parsed in place keep the bytes they point into
+// alive after the buffer has moved on (see RespFrames). A block is only
+// written to again once nothing else holds it.
+struct RecvBlock {
+  std::shared_ptr<char[]> data;
+  unsigned size_class = 0;
+
+  [[nodiscard]] std::size_t Capacity() const;
+  // Whether anything else still holds the block. Once not, the block may be
+  // written to: other threads' reads of it happened before they let go, as
+  // dropping a reference is a release operation on the count, which the
+  // fence here acquires (use_count() alone is a relaxed load).
+  [[nodiscard]] bool Shared() const {
+    if (data.use_count() > 1) return true;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return false;
+  }
+};
+
+// Free receive blocks, by size class, for one thread. Blocks are plain heap
+// allocations, so one acquired from a thread's pool may be released to
+// another's (a migrated client's buffer). Each class holds at most
+// kBytesPerClass of free blocks; beyond that, and for classes above
+// kMaxPooledClass, blocks are simply freed. Releasing a block that is still
+// shared only drops that reference: whoever releases the last one pools it.
+class RecvBufferPool {
+ public:
+  static constexpr std::size_t kMinBlockBytes = 4 * 1024;
+  static constexpr unsigned kMaxPooledClass = 8;  // 1 MiB
+  static constexpr std::size_t kBytesPerClass = 1024 * 1024;
+
+  static constexpr std::size_t BlockBytes(const unsigned size_class) {
+    return kMinBlockBytes << size_class;
+  }
+
+  RecvBlock Acquire(const unsigned size_class) {
+    if (size_class <= kMaxPooledClass) {
+      std::vector<RecvBlock>& free = free_[size_class];
+      if (!free.empty()) {
+        RecvBlock block = std::move(free.back());
+        free.pop_back();
+        return block;
+      }
+    }
+    return RecvBlock{
+        .data = std::make_shared_for_overwrite<char[]>(BlockBytes(size_class)),
+        .size_class = size_class};
+  }
+
+  void Release(RecvBlock block) {
+    if (!block.data || block.Shared() || block.size_class > kMaxPooledClass) {
+      return;
+    }
+    std::vector<RecvBlock>& free = free_[block.size_class];
+    if (free.size() < kBytesPerClass / BlockBytes(block.size_class)) {
+      free.push_back(std::move(block));
+    }
+  }
+
+ private:
+  std::array<std::vector<RecvBlock>, kMaxPooledClass + 1> free_;
+};
+
+inline std::size_t RecvBlock::Capacity() const {
+  return RecvBufferPool::BlockBytes(size_class);
+}
+
+// A connection's received-but-unparsed bytes, in a block from a
+// RecvBufferPool. recv() writes straight into WritableSpace() and the parser
+// reads Readable() in place; Consume() drops what it parsed.
+//
+// The block is only held while it has unparsed bytes: once a Consume empties
+// it, it goes back to the pool, so an idle client holds no receive memory.
+// Its size adapts per connection: a buffer that fills up moves to a block
+// twice the size, and the next block is a class smaller whenever the last one
+// was never more than a quarter full.
+//
+// Parsed bytes may still be referenced from outside (a Shared() block): they
+// are never overwritten, so the unparsed tail moves to a fresh block rather
+// than sliding down over them.
+class RecvBuffer {
+ public:
+  [[nodiscard]] bool Empty() const { return begin_ == end_; }
+  [[nodiscard]] std::string_view Readable() const {
+    return {block_.data.get() + begin_, end_ - begin_};
+  }
+  // The block Readable() points into, for pinning what was parsed from it.
+  [[nodiscard]] const RecvBlock& Block() const { return block_; }
+  // Bytes of receive memory held right now.
+  [[nodiscard]] std::size_t Footprint() const {
+    return block_.data ? block_.Capacity() : 0;
+  }
+
+  // Free space after the unparsed bytes for recv() to fill, acquiring or
+  // growing the block as needed. Never empty.
+  std::span<char> WritableSpace(RecvBufferPool& pool) {
+    if (!block_.data) {
+      block_ = pool.Acquire(size_hint_);
+    } else if (end_ == block_.Capacity()) {
+      // Sliding the tail down is only worth it if that frees half the block.
+      if (begin_ < block_.Capacity() / 2) {
+        MoveTo(block_.size_class + 1, pool);
+      } else if (block_.Shared()) {
+        MoveTo(block_.size_class, pool);
+      } else {
+        Compact();
+      }
+    }
+    return {block_.data.get() + end_, block_.Capacity() - end_};
+  }
+
+  // Records that recv() wrote `n` bytes into WritableSpace().
+  void Commit(const std::size_t n) {
+    end_ += n;
+    peak_ = std::max(peak_, end_ - begin_);
+  }
+
+  // Copies `bytes` in after the unparsed bytes.
+  void Append(std::string_view bytes, RecvBufferPool& pool) {
+    while (!bytes.empty()) {
+      const std::span<char> space = WritableSpace(pool);
+      const std::size_t n = std::min(space.size(), bytes.size());
+      std::memcpy(space.data(), bytes.data(), n);
+      Commit(n);
+      bytes.remove_prefix(n);
+    }
+  }
+
+  // Drops the first `n` unparsed bytes, returning the block to `pool` once
+  // nothing is left (or letting go of it, if it is still shared).
+  void Consume(const std::size_t n, RecvBufferPool& pool) {
+    begin_ += n;
+    if (begin_ != end_ || !block_.data) return;
+    if (size_hint_ > 0 && peak_ <= block_.Capacity() / 4) --size_hint_;
+    pool.Release(std::exchange(block_, {}));
+    begin_ = end_ = peak_ = 0;
+  }
+
+ private:
+  // Moves the unparsed tail to the front of the block.
+  void Compact() {
+    std::memmove(block_.data.get(), block_.data.get() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+  }
+
+  // Copies the unparsed tail into a new block of `size_class`.
+  void MoveTo(const unsigned size_class, RecvBufferPool& pool) {
+    RecvBlock next = pool.Acquire(size_class);
+    std::memcpy(next.data.get(), block_.data.get() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+    pool.Release(std::exchange(block_, std::move(next)));
+    size_hint_ = std::min(block_.size_class, RecvBufferPool::kMaxPooledClass);
+  }
+
+  RecvBlock block_;
+  std::size_t begin_ = 0;
+  std::size_t end_ = 0;
+  // Most unparsed bytes held at once since the block was acquired.
+  std::size_t peak_ = 0;
+  // Size class of the next block acquired.
+  unsigned size_hint_ = 0;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_NETWORK_RECV_BUFFER_H_
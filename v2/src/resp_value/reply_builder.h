@@ -0,0 +1,146 @@
+#ifndef MYREDIS_RESP_VALUE_REPLY_BUILDER_H_
+#define MYREDIS_RESP_VALUE_REPLY_BUILDER_H_
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace myredis {
+
+// Replies that never change, encoded once.
+inline constexpr std::string_view kOkReply = "+OK\r\n";
+inline constexpr std::string_view kPongReply = "+PONG\r\n";
+inline constexpr std::string_view kZeroReply = ":0\r\n";
+inline constexpr std::string_view kOneReply = ":1\r\n";
+inline constexpr std::string_view kNullBulkReply = "$-1\r\n";
+
+// A bulk string reply left for another thread to encode: `value`, shared
+// rather than copied, goes in at byte `offset` of the replies encoded around
+// it.
+struct DeferredBulk {
+  std::size_t offset = 0;
+  std::shared_ptr<const std::string> value;
+};
+
+// Writes RESP2 replies straight onto the end of a caller's buffer (for the
+// server, the reply buffer of the batch being executed, which the IO threads
+// pool and reuse), with no RespValue or temporary strings in between. Every
+// reply is a few appends into that one buffer: the constant ones are copied
+// from their preencoded bytes, and a bulk string costs its `$<len>` header
+// plus a single copy of its payload.
+//
+// Given a `deferred` list, a shared value (see SharedBulk) is not copied at
+// all: the builder records where its reply goes, and whoever holds the
+// replies later splices it in with EncodeDeferred. That moves the copy, and
+// the value's reply header, off the thread building the replies.
+class ReplyBuilder {
+ public:
+  explicit ReplyBuilder(std::string& out,
+                        std::vector<DeferredBulk>* deferred = nullptr)
+      : out_(out), deferred_(deferred) {}
+
+  // Already-encoded reply bytes, e.g. one of the constants above.
+  void Raw(const std::string_view encoded) { out_.append(encoded); }
+
+  void Ok() { Raw(kOkReply); }
+  void NullBulk() { Raw(kNullBulkReply); }
+
+  // `text` must not contain CR or LF.
+  void SimpleString(const std::string_view text) { Line('+', text); }
+  void Error(const std::string_view message) { Line('-', message); }
+
+  void Integer(const long long value) {
+    if (value == 0) {
+      Raw(kZeroReply);
+    } else if (value == 1) {
+      Raw(kOneReply);
+    } else {
+      Header(':', value);
+    }
+  }
+
+  void Bulk(const std::string_view bytes) {
+    // Grow once for the whole reply, not per append.
+    out_.reserve(out_.size() + bytes.size() + kMaxHeaderBytes + 2);
+    Header('$', static_cast<long long>(bytes.size()));
+    out_.append(bytes);
+    out_.append("\r\n", 2);
+  }
+  // A null bulk string for std::nullopt, e.g. a request's null argument.
+  void NullableBulk(const std::optional<std::string_view>& bytes) {
+    if (bytes) {
+      Bulk(*bytes);
+    } else {
+      NullBulk();
+    }
+  }
+
+  // A bulk string of an immutable value, deferred if the builder defers.
+  void SharedBulk(const std::shared_ptr<const std::string>& value) {
+    if (deferred_ != nullptr) {
+      deferred_->push_back(DeferredBulk{.offset = out_.size(), .value = value});
+    } else {
+      Bulk(*value);
+    }
+  }
+
+  // Starts an array; its `count` elements are the replies written next.
+  void ArrayHeader(const std::size_t count) {
+    Header('*', static_cast<long long>(count));
+  }
+
+ private:
+  // Type byte, up to 20 characters of a 64-bit number, CRLF.
+  static constexpr std::size_t kMaxHeaderBytes = 23;
+
+  void Line(const char type, const std::string_view text) {
+    out_.reserve(out_.size() + text.size() + 3);
+    out_.push_back(type);
+    out_.append(text);
+    out_.append("\r\n", 2);
+  }
+
+  // `type` followed by `value` in decimal and CRLF, formatted on the stack.
+  void Header(const char type, const long long value) {
+    std::array<char, kMaxHeaderBytes> header;
+    header[0] = type;
+    char* end = std::to_chars(header.data() + 1, header.data() + header.size(),
+                              value)
+                    .ptr;
+    *end++ = '\r';
+    *end++ = '\n';
+    out_.append(header.data(), end);
+  }
+
+  std::string& out_;
+  std::vector<DeferredBulk>* deferred_;
+};
+
+// Appends `encoded`, replies a ReplyBuilder wrote, to `out` with the replies
+// it deferred, in `deferred` (in order), encoded in their places.
+inline void EncodeDeferred(const std::string_view encoded,
+                           const std::span<const DeferredBulk> deferred,
+                           std::string& out) {
+  // Each deferred reply adds its value and at most 32 bytes of framing.
+  std::size_t total = encoded.size();
+  for (const DeferredBulk& bulk : deferred) total += bulk.value->size() + 32;
+  out.reserve(out.size() + total);
+  ReplyBuilder reply(out);
+  std::size_t done = 0;
+  for (const DeferredBulk& bulk : deferred) {
+    out.append(encoded.substr(done, bulk.offset - done));
+    reply.Bulk(*bulk.value);
+    done = bulk.offset;
+  }
+  out.append(encoded.substr(done));
+}
+
+}  // namespace myredis
+
+#endif  // MYREDIS_RESP_VALUE_REPLY_BUILDER_H_
@@ -0,0 +1,59 @@
+#ifndef MYREDIS_RESP_VALUE_RESP_FRAME_H_
+#define MYREDIS_RESP_VALUE_RESP_FRAME_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "network/recv_buffer.h"
+
+namespace myredis {
+
+// One argument of a request: a view of its bytes, or std::nullopt for a null
+// bulk string.
+using RespArg = std::optional<std::string_view>;
+
+// One parsed request: a range of RespFrames::args holding the command keyword
+// and then its arguments.
+struct RespFrame {
+  std::uint32_t first_arg = 0;
+  // 0 if the request is not a command: not an array, or an array that is
+  // empty, holds anything but bulk strings, or has a null or empty keyword.
+  std::uint32_t arg_count = 0;
+
+  // Filled in by the IO thread that parsed the request, once it has looked
+  // the command up (see ResolveCommand), so that the executor does not have
+  // to: the command's index in the command table, and the hash of its key.
+  static constexpr std::uint8_t kUnresolved = 0xff;
+  std::uint8_t command = kUnresolved;
+  std::size_t key_hash = 0;
+};
+
+// Requests parsed from one connection's input, flat: every request's
+// arguments sit in one array, as views of the bytes they were received in
+// rather than strings of their own. Parsing a pipeline of N requests fills
+// three reused vectors and allocates nothing per argument.
+//
+// The views point into `blocks`, the receive blocks the requests were parsed
+// from (just the one, when they all came out of a single read), which stay
+// alive and unwritten for as long as the RespFrames holds them. Only a
+// request with a bulk string too large to wait for in the receive buffer (see
+// RespFrameParser) has its arguments copied, into `owned`, whose elements
+// never move once added.
+struct RespFrames {
+  std::vector<RespFrame> frames;
+  std::vector<RespArg> args;
+  std::vector<RecvBlock> blocks;
+  std::deque<std::string> owned;
+
+  [[nodiscard]] bool Empty() const { return frames.empty(); }
+  [[nodiscard]] std::size_t Size() const { return frames.size(); }
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_RESP_VALUE_RESP_FRAME_H_
@@ -0,0 +1,198 @@
+#include "resp_frame_parser.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include "resp_scan.h"
+
+namespace myredis {
+
+bool RespFrameParser::Parse(RecvBuffer& buffer, RecvBufferPool& pool,
+                            RespFrames& out) {
+  while (!buffer.Empty()) {
+    if (!large_.Idle()) {
+      const std::optional<std::size_t> taken =
+          ParseStreamed(buffer.Readable(), out);
+      if (!taken) return false;
+      buffer.Consume(*taken, pool);
+      if (!large_.Idle()) return true;
+      continue;
+    }
+
+    const std::string_view input = buffer.Readable();
+    switch (Scan(input)) {
+      case ScanResult::kFrame: {
+        // Pin the block before consuming, which would otherwise recycle it.
+        if (out.blocks.empty() ||
+            out.blocks.back().data != buffer.Block().data) {
+          out.blocks.push_back(buffer.Block());
+        }
+        AddFrame(input.data(), out);
+        const std::size_t length = scanned_;
+        ResetScan();
+        buffer.Consume(length, pool);
+        break;
+      }
+      case ScanResult::kLarge: {
+        // Hand the request over, with the arguments it has so far, to the
+        // RespParser, which resumes at the large bulk string's header.
+        RespValue::RespArray parsed;
+        parsed.reserve(slices_.size());
+        for (const Slice& slice : slices_) {
+          parsed.push_back(RespValue::FromVariant(
+              RespValue::RespBulkString(input.substr(slice.offset,
+                                                     slice.length))));
+        }
+        large_.ResumeArray(std::move(parsed), open_.front());
+        const std::size_t length = scanned_;
+        ResetScan();
+        buffer.Consume(length, pool);
+        break;
+      }
+      case ScanResult::kNeedMore:
+        return true;
+      case ScanResult::kError:
+        return false;
+    }
+  }
+  return true;
+}
+
+std::optional<std::size_t> RespFrameParser::ParseStreamed(
+    const std::string_view input, RespFrames& out) {
+  if (large_.Idle()) return 0;
+  std::size_t pos = 0;
+  std::optional<RespValue> request;
+  switch (large_.Next(input, pos, request)) {
+    case RespParser::Status::kValue:
+      AddOwnedFrame(std::move(*request), out);
+      break;
+    case RespParser::Status::kNeedMore:
+      break;
+    case RespParser::Status::kError:
+      return std::nullopt;
+  }
+  return pos;
+}
+
+RespFrameParser::ScanResult RespFrameParser::Scan(
+    const std::string_view input) {
+  std::size_t pos = scanned_;
+  while (true) {
+    // Where the current request stands; it is complete once an element
+    // closes its last open array (or it is not an array at all).
+    scanned_ = pos;
+    if (pos == input.size()) return ScanResult::kNeedMore;
+    const char type = input[pos];
+    if (std::string_view("+-:$*").find(type) == std::string_view::npos) {
+      return ScanResult::kError;  // not a RESP type byte
+    }
+    const std::size_t crlf = FindCrlf(input, pos + 1);
+    if (crlf == std::string_view::npos) {
+      return input.size() - pos > kMaxLineBytes ? ScanResult::kError
+                                                : ScanResult::kNeedMore;
+    }
+    const std::size_t depth = open_.size();
+    const std::string_view text = input.substr(pos + 1, crlf - pos - 1);
+    long long number = 0;
+    pos = crlf + 2;
+
+    if (type == '$') {
+      if (!ParseDecimal(text, number) || number < -1 ||
+          number > kMaxBulkBytes) {
+        return ScanResult::kError;
+      }
+      Slice slice;
+      if (number >= 0) {
+        const auto length = static_cast<std::size_t>(number);
+        if (depth == 1 && command_ && length >= kStreamThreshold) {
+          return ScanResult::kLarge;
+        }
+        if (input.size() - pos < length + 2) return ScanResult::kNeedMore;
+        if (input[pos + length] != '\r' || input[pos + length + 1] != '\n') {
+          return ScanResult::kError;
+        }
+        slice = Slice{.offset = pos, .length = length};
+        pos += length + 2;
+      }
+      if (depth == 1 && command_) slices_.push_back(slice);
+    } else if (type == '*') {
+      if (!ParseDecimal(text, number) || number < 0) return ScanResult::kError;
+      if (depth > 0 || number == 0) command_ = false;
+      if (number > 0) {
+        open_.push_back(static_cast<std::size_t>(number));
+        continue;  // no element is complete until its array is
+      }
+    } else if (type == ':') {
+      if (!ParseDecimal(text, number)) return ScanResult::kError;
+      command_ = false;
+    } else {
+      command_ = false;
+    }
+
+    // An element is complete: count it against every array it completes.
+    while (!open_.empty() && --open_.back() == 0) open_.pop_back();
+    if (open_.empty()) {
+      scanned_ = pos;
+      return ScanResult::kFrame;
+    }
+  }
+}
+
+void RespFrameParser::AddFrame(const char* const start,
+                               RespFrames& out) const {
+  const auto first = static_cast<std::uint32_t>(out.args.size());
+  if (!command_ || slices_.empty() || slices_.front().length == Slice::kNull ||
+      slices_.front().length == 0) {
+    out.frames.push_back(RespFrame{.first_arg = first, .arg_count = 0});
+    return;
+  }
+  for (const Slice& slice : slices_) {
+    if (slice.length == Slice::kNull) {
+      out.args.emplace_back();
+    } else {
+      out.args.emplace_back(std::string_view(start + slice.offset,
+                                             slice.length));
+    }
+  }
+  out.frames.push_back(RespFrame{
+      .first_arg = first,
+      .arg_count = static_cast<std::uint32_t>(slices_.size())});
+}
+
+void RespFrameParser::AddOwnedFrame(RespValue request, RespFrames& out) {
+  const auto first = static_cast<std::uint32_t>(out.args.size());
+  auto& elements = std::get<RespValue::RespArray>(request.GetMutableValue());
+  // The elements after the large bulk string may still be anything.
+  for (const RespValue& element : elements) {
+    const auto* bulk =
+        std::get_if<RespValue::RespBulkString>(&element.GetValue());
+    if (bulk == nullptr ||
+        (&element == &elements.front() && (!*bulk || (*bulk)->empty()))) {
+      out.frames.push_back(RespFrame{.first_arg = first, .arg_count = 0});
+      return;
+    }
+  }
+  for (RespValue& element : elements) {
+    auto& bulk = std::get<RespValue::RespBulkString>(element.GetMutableValue());
+    if (!bulk) {
+      out.args.emplace_back();
+      continue;
+    }
+    out.args.emplace_back(out.owned.emplace_back(std::move(*bulk)));
+  }
+  out.frames.push_back(RespFrame{
+      .first_arg = first,
+      .arg_count = static_cast<std::uint32_t>(elements.size())});
+}
+
+void RespFrameParser::ResetScan() {
+  scanned_ = 0;
+  open_.clear();
+  slices_.clear();
+  command_ = true;
+}
+
+}  // namespace myredis
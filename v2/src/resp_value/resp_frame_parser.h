@@ -0,0 +1,99 @@
+#ifndef MYREDIS_RESP_VALUE_RESP_FRAME_PARSER_H_
+#define MYREDIS_RESP_VALUE_RESP_FRAME_PARSER_H_
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "network/recv_buffer.h"
+#include "resp_frame.h"
+#include "resp_parser.h"
+#include "resp_value.h"
+
+namespace myredis {
+
+// Parses client requests out of a connection's RecvBuffer into RespFrames,
+// without copying them: each argument becomes a view of its bytes in the
+// receive block, which the RespFrames pins.
+//
+// A request is only consumed from the buffer once it is complete, so all of
+// its bytes stay in one block. While it is incomplete the parser keeps its
+// progress (how far it has been scanned, and its arguments so far as
+// offsets from its start, which survive the buffer moving it to a new
+// block), so no byte is scanned twice except the header line of a bulk
+// string whose payload has not fully arrived.
+//
+// The exception is a command with a bulk string of kStreamThreshold bytes or
+// more, which is not worth holding in the receive buffer: from that bulk
+// string on, the request is handed to a RespParser that copies it into
+// strings of its own and can recv() the large payload straight into its
+// value (see StreamingSpace). Such a request's arguments land in
+// RespFrames::owned.
+class RespFrameParser {
+ public:
+  static constexpr std::size_t kMaxLineBytes = RespParser::kMaxLineBytes;
+  static constexpr long long kMaxBulkBytes = RespParser::kMaxBulkBytes;
+  static constexpr std::size_t kStreamThreshold = RespParser::kStreamThreshold;
+
+  // Parses every complete request in `buffer` into `out`, consuming it from
+  // the buffer; an incomplete one stays there, to be resumed after more
+  // input. Returns false on malformed framing, after which the parser must
+  // not be used again.
+  bool Parse(RecvBuffer& buffer, RecvBufferPool& pool, RespFrames& out);
+
+  // While a large request is being copied (see above), takes its bytes from
+  // `input` directly, for input the caller cannot leave in a RecvBuffer.
+  // Returns how many bytes it took (0 if no large request is in progress),
+  // or std::nullopt on malformed framing. The rest of `input` goes to Parse.
+  std::optional<std::size_t> ParseStreamed(std::string_view input,
+                                           RespFrames& out);
+
+  // See RespParser::StreamingSpace: only ever non-empty for a large request.
+  [[nodiscard]] std::span<char> StreamingSpace() {
+    return large_.StreamingSpace();
+  }
+  void CommitStreamed(const std::size_t n) { large_.CommitStreamed(n); }
+
+ private:
+  enum class ScanResult {
+    kFrame,     // a complete request: the first scanned_ bytes of the input
+    kNeedMore,  // the request is incomplete
+    kLarge,     // a large bulk string starts at scanned_
+    kError,     // malformed framing
+  };
+
+  // A top-level bulk string of the request being scanned, from its start.
+  struct Slice {
+    static constexpr std::size_t kNull = static_cast<std::size_t>(-1);
+    std::size_t offset = 0;
+    std::size_t length = kNull;
+  };
+
+  // Scans the request at the start of `input` from where the last call left
+  // off.
+  ScanResult Scan(std::string_view input);
+  // Adds the request just scanned, whose first byte is at `start`, to `out`.
+  void AddFrame(const char* start, RespFrames& out) const;
+  // Adds a request the RespParser produced to `out`, moving its strings into
+  // `out.owned`.
+  static void AddOwnedFrame(RespValue request, RespFrames& out);
+  // Forgets the request just scanned.
+  void ResetScan();
+
+  // Bytes of the request at the front of the buffer scanned so far.
+  std::size_t scanned_ = 0;
+  // Elements still to come in each array it has open, outermost first.
+  std::vector<std::size_t> open_;
+  // Its top-level bulk strings so far, if it is still a command.
+  std::vector<Slice> slices_;
+  bool command_ = true;
+  // Parses the rest of a request that has a large bulk string; idle
+  // otherwise.
+  RespParser large_;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_RESP_VALUE_RESP_FRAME_PARSER_H_
@@ -0,0 +1,133 @@
+#include "resp_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "resp_scan.h"
+
+namespace myredis {
+
+RespParser::Status RespParser::Next(const std::string_view input,
+                                    std::size_t& pos,
+                                    std::optional<RespValue>& value) {
+  while (true) {
+    if (bulk_) {
+      // Finish the bulk string in progress: payload, then its CRLF.
+      std::string& bulk = *bulk_;
+      const std::size_t n =
+          std::min(bulk.size() - filled_, input.size() - pos);
+      std::memcpy(bulk.data() + filled_, input.data() + pos, n);
+      filled_ += n;
+      pos += n;
+      if (filled_ < bulk.size() || input.size() - pos < 2) {
+        return Status::kNeedMore;
+      }
+      if (input[pos] != '\r' || input[pos + 1] != '\n') return Status::kError;
+      pos += 2;
+      filled_ = 0;
+      if (Complete(RespValue::FromVariant(std::exchange(bulk_, std::nullopt)),
+                   value)) {
+        return Status::kValue;
+      }
+      continue;
+    }
+
+    if (pos == input.size()) return Status::kNeedMore;
+    if (std::string_view("+-:$*").find(input[pos]) == std::string_view::npos) {
+      return Status::kError;  // not a RESP type byte
+    }
+    const std::size_t crlf = FindCrlf(input, pos + 1);
+    if (crlf == std::string_view::npos) {
+      return input.size() - pos > kMaxLineBytes ? Status::kError
+                                                : Status::kNeedMore;
+    }
+    std::optional<RespValue> element;
+    if (!ParseLine(input, pos, crlf, element)) return Status::kError;
+    pos = crlf + 2;
+    if (element && Complete(std::move(*element), value)) return Status::kValue;
+  }
+}
+
+bool RespParser::ParseLine(const std::string_view input, const std::size_t pos,
+                           const std::size_t crlf,
+                           std::optional<RespValue>& element) {
+  const std::string_view text = input.substr(pos + 1, crlf - pos - 1);
+  long long number = 0;
+  switch (input[pos]) {
+    case '+':
+      element = RespValue::FromVariant(RespValue::RespSimpleString(text));
+      return true;
+    case '-':
+      element = RespValue::FromVariant(
+          RespValue::RespSimpleError{.message = std::string(text)});
+      return true;
+    case ':':
+      if (!ParseDecimal(text, number)) return false;
+      element = RespValue::FromVariant(number);
+      return true;
+    case '$': {
+      if (!ParseDecimal(text, number) || number < -1 ||
+          number > kMaxBulkBytes) {
+        return false;
+      }
+      if (number == -1) {
+        element = RespValue::FromVariant(RespValue::RespBulkString());
+        return true;
+      }
+      // Sized once; every byte is written before the value is used. The
+      // length is captured rather than taken from the callback's argument,
+      // which some libstdc++ releases pass the grown capacity in.
+      const auto length = static_cast<std::size_t>(number);
+      bulk_.emplace().resize_and_overwrite(
+          length, [length](char*, std::size_t) { return length; });
+      return true;
+    }
+    case '*':
+      if (!ParseDecimal(text, number) || number < 0) return false;
+      if (number == 0) {
+        element = RespValue::FromVariant(RespValue::RespArray());
+        return true;
+      }
+      open_.push_back(OpenArray{.remaining = static_cast<std::size_t>(number)});
+      // The count is client-supplied: reserve for a typical request only.
+      open_.back().elements.reserve(
+          std::min<std::size_t>(open_.back().remaining, 16));
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool RespParser::Complete(RespValue value, std::optional<RespValue>& out) {
+  while (!open_.empty()) {
+    OpenArray& array = open_.back();
+    array.elements.push_back(std::move(value));
+    if (--array.remaining > 0) return false;
+    value = RespValue::FromVariant(std::move(array.elements));
+    open_.pop_back();
+  }
+  out = std::move(value);
+  return true;
+}
+
+std::span<char> RespParser::StreamingSpace() {
+  if (!bulk_ || bulk_->size() < kStreamThreshold) return {};
+  return {bulk_->data() + filled_, bulk_->size() - filled_};
+}
+
+void RespParser::CommitStreamed(const std::size_t n) { filled_ += n; }
+
+void RespParser::ResumeArray(RespValue::RespArray elements,
+                             const std::size_t remaining) {
+  open_.push_back(
+      OpenArray{.elements = std::move(elements), .remaining = remaining});
+}
+
+void RespParser::Reset() {
+  open_.clear();
+  bulk_.reset();
+  filled_ = 0;
+}
+
+}  // namespace myredis
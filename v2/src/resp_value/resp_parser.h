@@ -0,0 +1,96 @@
+#ifndef MYREDIS_RESP_VALUE_RESP_PARSER_H_
+#define MYREDIS_RESP_VALUE_RESP_PARSER_H_
+
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "resp_value.h"
+
+namespace myredis {
+
+// Incremental RESP parser for a byte stream that arrives in pieces.
+//
+// Unlike RespValue::FromString, it never re-reads what it has already taken:
+// open arrays (with the elements parsed so far) and a bulk string whose
+// payload is still arriving are kept in the parser between calls, and the
+// payload is copied straight into the final string, sized once from its
+// `$<len>` header. The only input it leaves for the caller to present again is
+// an incomplete line (a type byte, a length or a simple value, up to its CRLF),
+// which is at most kMaxLineBytes.
+//
+// Incomplete input and malformed framing are reported through Status rather
+// than exceptions.
+class RespParser {
+ public:
+  enum class Status {
+    kValue,     // a complete top-level value was parsed
+    kNeedMore,  // the input ran out before the next value was complete
+    kError,     // malformed framing; the parser must be Reset before reuse
+  };
+
+  // A line (simple string, error, integer or length header) longer than this
+  // without a CRLF is malformed. Matches Redis's inline and multibulk limit.
+  static constexpr std::size_t kMaxLineBytes = 64 * 1024;
+  // Longest bulk string accepted (Redis's default proto-max-bulk-len).
+  static constexpr long long kMaxBulkBytes = 512LL * 1024 * 1024;
+  // Bulk strings at least this long can be received straight into their
+  // value: see StreamingSpace.
+  static constexpr std::size_t kStreamThreshold = 64 * 1024;
+
+  // Parses `input` from `pos` on, advancing `pos` past every byte it takes.
+  // On kValue the value is stored in `value`; call again for the next one.
+  // On kNeedMore every byte from `pos` on is the start of an incomplete line,
+  // which the caller must pass again, followed by more input, next time.
+  Status Next(std::string_view input, std::size_t& pos,
+              std::optional<RespValue>& value);
+
+  // While a bulk string of at least kStreamThreshold bytes is arriving, the
+  // part of its payload not yet received, so the caller can recv() into the
+  // value directly; empty otherwise. Only valid while the caller holds no
+  // unparsed input.
+  [[nodiscard]] std::span<char> StreamingSpace();
+  // Records that `n` bytes were written into StreamingSpace().
+  void CommitStreamed(std::size_t n);
+
+  // True between values: no array or bulk string is partly parsed.
+  [[nodiscard]] bool Idle() const { return open_.empty() && !bulk_; }
+
+  // Continues an array whose start, and first `elements`, another parser
+  // took: the next input starts with its element after those, and
+  // `remaining` elements (counting that one) are still to come. Only valid
+  // while Idle().
+  void ResumeArray(RespValue::RespArray elements, std::size_t remaining);
+
+  void Reset();
+
+ private:
+  // An array whose elements are still arriving.
+  struct OpenArray {
+    RespValue::RespArray elements{};
+    std::size_t remaining = 0;
+  };
+
+  // Adds a finished value to the innermost open array, closing every array
+  // that completes. Returns true, with the value in `out`, once a top-level
+  // value is complete.
+  bool Complete(RespValue value, std::optional<RespValue>& out);
+
+  // Parses one line's worth of value starting at input[pos], with the line's
+  // CRLF at `crlf`. Returns false on malformed framing.
+  bool ParseLine(std::string_view input, std::size_t pos, std::size_t crlf,
+                 std::optional<RespValue>& element);
+
+  std::vector<OpenArray> open_;
+  // The bulk string being received, sized to its final length, and how many
+  // of its bytes have arrived.
+  std::optional<std::string> bulk_;
+  std::size_t filled_ = 0;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_RESP_VALUE_RESP_PARSER_H_
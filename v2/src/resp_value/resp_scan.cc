@@ -0,0 +1,116 @@
+#include "resp_scan.h"
+
+#include <atomic>
+#include <bit>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace myredis {
+
+namespace {
+
+// memchr for each '\r', then a look at the byte after it.
+std::size_t FindCrlfPortable(const std::string_view input, std::size_t from) {
+  const char* const data = input.data();
+  while (from + 1 < input.size()) {
+    const void* const cr =
+        std::memchr(data + from, '\r', input.size() - from - 1);
+    if (cr == nullptr) break;
+    const std::size_t pos = static_cast<const char*>(cr) - data;
+    if (data[pos + 1] == '\n') return pos;
+    from = pos + 1;
+  }
+  return std::string_view::npos;
+}
+
+#if defined(__x86_64__)
+
+// RESP lines are short: a type byte and a length or a short status. The
+// SIMD scanners look at the first block with one compare for '\r' (checking
+// the byte after each match for '\n', which in RESP is almost always there)
+// and hand longer lines to the portable scan, whose memchr is glibc's own
+// runtime-dispatched vector loop and hard to beat over long stretches.
+
+// The first CRLF among the '\r' positions set in `mask`, relative to `base`.
+inline std::size_t CrlfInMask(const std::string_view input,
+                              const std::size_t base, unsigned mask) {
+  for (; mask != 0; mask &= mask - 1) {
+    const std::size_t pos = base + std::countr_zero(mask);
+    if (pos + 1 < input.size() && input[pos + 1] == '\n') return pos;
+  }
+  return std::string_view::npos;
+}
+
+__attribute__((target("sse2"))) std::size_t FindCrlfSse2(
+    const std::string_view input, const std::size_t from) {
+  if (from + 16 > input.size()) return FindCrlfPortable(input, from);
+  const __m128i block =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + from));
+  const auto mask = static_cast<unsigned>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+  const std::size_t pos = CrlfInMask(input, from, mask);
+  return pos != std::string_view::npos ? pos
+                                       : FindCrlfPortable(input, from + 16);
+}
+
+__attribute__((target("avx2"))) std::size_t FindCrlfAvx2(
+    const std::string_view input, const std::size_t from) {
+  if (from + 32 > input.size()) return FindCrlfSse2(input, from);
+  const __m256i block = _mm256_loadu_si256(
+      reinterpret_cast<const __m256i*>(input.data() + from));
+  const auto mask = static_cast<unsigned>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r'))));
+  const std::size_t pos = CrlfInMask(input, from, mask);
+  return pos != std::string_view::npos ? pos
+                                       : FindCrlfPortable(input, from + 32);
+}
+
+#endif  // defined(__x86_64__)
+
+std::vector<CrlfScanner> DetectCrlfScanners() {
+  std::vector<CrlfScanner> scanners{{"portable", &FindCrlfPortable}};
+#if defined(__x86_64__)
+  __builtin_cpu_init();
+  scanners.push_back({"sse2", &FindCrlfSse2});  // part of x86-64
+  if (__builtin_cpu_supports("avx2")) {
+    scanners.push_back({"avx2", &FindCrlfAvx2});
+  }
+#endif
+  return scanners;
+}
+
+using FindCrlfFn = std::size_t (*)(std::string_view, std::size_t);
+
+std::size_t ResolveAndFindCrlf(std::string_view input, std::size_t from);
+
+// Starts out at the resolver, which swaps in the chosen scanner on the first
+// call, so FindCrlf is safe to call from any thread or static initializer and
+// costs one indirect call afterwards.
+std::atomic<FindCrlfFn> find_crlf{&ResolveAndFindCrlf};
+
+std::size_t ResolveAndFindCrlf(const std::string_view input,
+                               const std::size_t from) {
+  const FindCrlfFn find = ActiveCrlfScanner().find;
+  find_crlf.store(find, std::memory_order_relaxed);
+  return find(input, from);
+}
+
+}  // namespace
+
+std::size_t FindCrlf(const std::string_view input, const std::size_t from) {
+  return find_crlf.load(std::memory_order_relaxed)(input, from);
+}
+
+std::vector<CrlfScanner> SupportedCrlfScanners() {
+  return DetectCrlfScanners();
+}
+
+const CrlfScanner& ActiveCrlfScanner() {
+  static const CrlfScanner active = DetectCrlfScanners().back();
+  return active;
+}
+
+}  // namespace myredis
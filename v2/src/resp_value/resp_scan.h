@@ -0,0 +1,51 @@
+#ifndef MYREDIS_RESP_VALUE_RESP_SCAN_H_
+#define MYREDIS_RESP_VALUE_RESP_SCAN_H_
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace myredis {
+
+// The byte-level scanning the RESP parsers are built on.
+
+// Position of the first "\r\n" in `input` at or after `from`, or
+// std::string_view::npos: the same result as input.find("\r\n", from), from
+// the fastest implementation this CPU supports (chosen once, at startup).
+std::size_t FindCrlf(std::string_view input, std::size_t from);
+
+// One implementation of FindCrlf.
+struct CrlfScanner {
+  const char* name;
+  std::size_t (*find)(std::string_view input, std::size_t from);
+};
+
+// Every implementation this CPU can run, the portable one first, and the one
+// FindCrlf uses. For tests and benchmarks.
+std::vector<CrlfScanner> SupportedCrlfScanners();
+const CrlfScanner& ActiveCrlfScanner();
+
+// Reads the whole of `text` as a decimal long long: an optional '-' and 1 to
+// 19 digits, nothing else. Returns false if it is not one or overflows.
+// Digits are validated together rather than one branch each.
+inline bool ParseDecimal(const std::string_view text, long long& out) {
+  const bool negative = !text.empty() && text.front() == '-';
+  const std::string_view digits = text.substr(negative ? 1 : 0);
+  if (digits.empty() || digits.size() > 19) return false;
+  unsigned long long value = 0;
+  unsigned bad = 0;
+  for (const char c : digits) {
+    const unsigned digit = static_cast<unsigned char>(c) - unsigned{'0'};
+    bad |= static_cast<unsigned>(digit > 9);
+    value = value * 10 + digit;  // 19 digits cannot wrap 64 bits
+  }
+  constexpr unsigned long long kMax = 9223372036854775807ULL;
+  if (bad != 0 || value > kMax + (negative ? 1 : 0)) return false;
+  out = negative ? static_cast<long long>(0ULL - value)
+                 : static_cast<long long>(value);
+  return true;
+}
+
+}  // namespace myredis
+
+#endif  // MYREDIS_RESP_VALUE_RESP_SCAN_H_
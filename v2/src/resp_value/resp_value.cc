@@ -3,11 +3,14 @@
 #include <cassert>
 #include <stdexcept>
 
+#include "reply_builder.h"
+#include "resp_scan.h"
+
 namespace myredis {
 
 RespValue::RespValue(RespVariant variant) : value_(std::move(variant)) {}
 
-RespValue::RespVariant RespValue::ParseVariant(const std::string& str,
+RespValue::RespVariant RespValue::ParseVariant(std::string_view str,
                                                size_t& pos) {
   if (pos >= str.size()) {
     throw std::out_of_range("Unexpected end of input while parsing RESP value");
@@ -28,52 +31,57 @@ RespValue::RespVariant RespValue::ParseVariant(const std::string& str,
   }
 }
 
-RespValue::RespSimpleString RespValue::ParseSimpleString(const std::string& str,
+RespValue::RespSimpleString RespValue::ParseSimpleString(std::string_view str,
                                                          size_t& pos) {
   assert(str[pos] == '+');
-  const size_t end_pos = str.find("\r\n", pos + 1);
-  if (end_pos == std::string::npos) {
+  const size_t end_pos = FindCrlf(str, pos + 1);
+  if (end_pos == std::string_view::npos) {
     throw std::out_of_range("Missing CRLF for simple string");
   }
-  const std::string simple_string = str.substr(pos + 1, end_pos - pos - 1);
+  const std::string simple_string(str.substr(pos + 1, end_pos - pos - 1));
   pos = end_pos + 2;  // skip \r\n
   return simple_string;
 }
 
-RespValue::RespSimpleError RespValue::ParseSimpleError(const std::string& str,
+RespValue::RespSimpleError RespValue::ParseSimpleError(std::string_view str,
                                                        size_t& pos) {
   assert(str[pos] == '-');
-  const size_t end_pos = str.find("\r\n", pos + 1);
-  if (end_pos == std::string::npos) {
+  const size_t end_pos = FindCrlf(str, pos + 1);
+  if (end_pos == std::string_view::npos) {
     throw std::out_of_range("Missing CRLF for simple error");
   }
-  const std::string error_message = str.substr(pos + 1, end_pos - pos - 1);
+  const std::string error_message(str.substr(pos + 1, end_pos - pos - 1));
   pos = end_pos + 2;  // skip \r\n
   return RespSimpleError{.message = error_message};
 }
 
-RespValue::RespInteger RespValue::ParseInteger(const std::string& str,
+RespValue::RespInteger RespValue::ParseInteger(std::string_view str,
                                                size_t& pos) {
   assert(str[pos] == ':');
-  const size_t end_pos = str.find("\r\n", pos + 1);
-  if (end_pos == std::string::npos) {
+  const size_t end_pos = FindCrlf(str, pos + 1);
+  if (end_pos == std::string_view::npos) {
     throw std::out_of_range("Missing CRLF for integer");
   }
-  const std::string integer_string = str.substr(pos + 1, end_pos - pos - 1);
-  const int64_t integer_value = stoll(integer_string);
+  long long integer_value = 0;
+  if (!ParseDecimal(str.substr(pos + 1, end_pos - pos - 1), integer_value)) {
+    throw std::invalid_argument("Invalid integer");
+  }
   pos = end_pos + 2;  // skip \r\n
   return integer_value;
 }
 
-RespValue::RespBulkString RespValue::ParseBulkString(const std::string& str,
+RespValue::RespBulkString RespValue::ParseBulkString(std::string_view str,
                                                      size_t& pos) {
   assert(str[pos] == '$');
-  const size_t end_of_length = str.find("\r\n", pos + 1);
-  if (end_of_length == std::string::npos) {
+  const size_t end_of_length = FindCrlf(str, pos + 1);
+  if (end_of_length == std::string_view::npos) {
     throw std::out_of_range("Missing CRLF after bulk-string length");
   }
-  const std::string length_string = str.substr(pos + 1, end_of_length - pos - 1);
-  const long long bulk_string_length = stoll(length_string);
+  long long bulk_string_length = 0;
+  if (!ParseDecimal(str.substr(pos + 1, end_of_length - pos - 1),
+                    bulk_string_length)) {
+    throw std::invalid_argument("Invalid bulk-string length");
+  }
   pos = end_of_length + 2;
   if (bulk_string_length == -1) {
     return std::nullopt;
@@ -92,21 +100,24 @@ RespValue::RespBulkString RespValue::ParseBulkString(const std::string& str,
       str[pos + bulk_string_length + 1] != '\n') {
     throw std::out_of_range("Bulk string missing terminating CRLF");
   }
-  std::string bulk_string =
-      str.substr(pos, static_cast<size_t>(bulk_string_length));
+  std::string bulk_string(
+      str.substr(pos, static_cast<size_t>(bulk_string_length)));
   pos += static_cast<size_t>(bulk_string_length) + 2;
   return bulk_string;
 }
 
-RespValue::RespArray RespValue::ParseArray(const std::string& str,
+RespValue::RespArray RespValue::ParseArray(std::string_view str,
                                            size_t& pos) {
   assert(str[pos] == '*');
-  const size_t end_of_length = str.find("\r\n", pos + 1);
-  if (end_of_length == std::string::npos) {
+  const size_t end_of_length = FindCrlf(str, pos + 1);
+  if (end_of_length == std::string_view::npos) {
     throw std::out_of_range("Missing CRLF after array length");
   }
-  const std::string length_string = str.substr(pos + 1, end_of_length - pos - 1);
-  const long long array_length = stoll(length_string);
+  long long array_length = 0;
+  if (!ParseDecimal(str.substr(pos + 1, end_of_length - pos - 1),
+                    array_length)) {
+    throw std::invalid_argument("Invalid array length");
+  }
   pos = end_of_length + 2;
   if (array_length < 0) {
     throw std::invalid_argument("Negative array length not allowed");
@@ -122,36 +133,43 @@ RespValue::RespArray RespValue::ParseArray(const std::string& str,
 }
 
 std::string RespValue::Serialize() const {
-  return std::visit(
-      []<typename RespVariant>(const RespVariant& val) -> std::string {
+  std::string out;
+  SerializeTo(out);
+  return out;
+}
+
+void RespValue::SerializeTo(std::string& out) const {
+  ReplyBuilder reply(out);
+  std::visit(
+      [&reply, &out]<typename RespVariant>(const RespVariant& val) {
         using T = std::decay_t<RespVariant>;
 
         if constexpr (std::is_same_v<T, RespSimpleString>) {
-          return "+" + val + "\r\n";
+          reply.SimpleString(val);
         } else if constexpr (std::is_same_v<T, RespSimpleError>) {
-          return "-" + val.message + "\r\n";
+          reply.Error(val.message);
         } else if constexpr (std::is_same_v<T, RespInteger>) {
-          return ":" + std::to_string(val) + "\r\n";
+          reply.Integer(val);
         } else if constexpr (std::is_same_v<T, RespBulkString>) {
-          if (!val.has_value()) {
-            return "$-1\r\n";
+          if (val.has_value()) {
+            reply.Bulk(std::string_view(*val));
+          } else {
+            reply.NullBulk();
           }
-          const std::string& str = val.value();
-          return "$" + std::to_string(str.length()) + "\r\n" + str + "\r\n";
         } else if constexpr (std::is_same_v<T, RespArray>) {
-          std::string result = "*" + std::to_string(val.size()) + "\r\n";
+          reply.ArrayHeader(val.size());
           for (const auto& element : val) {
-            result += element.Serialize();
+            element.SerializeTo(out);
           }
-          return result;
         }
-        throw std::invalid_argument("Resp Value variant not a valid variant");
       },
       value_);
 }
 
 const RespValue::RespVariant& RespValue::GetValue() const { return value_; }
 
+RespValue::RespVariant& RespValue::GetMutableValue() { return value_; }
+
 std::string RespValue::Show() const {
   return std::visit(
       []<typename RespVariant>(const RespVariant& val) -> std::string {
@@ -182,7 +200,7 @@ std::string RespValue::Show() const {
       value_);
 }
 
-std::pair<RespValue, size_t> RespValue::FromString(const std::string& str) {
+std::pair<RespValue, size_t> RespValue::FromString(std::string_view str) {
   size_t pos = 0;
   return std::make_pair(RespValue(ParseVariant(str, pos)), pos);
 }
@@ -191,4 +209,8 @@ RespValue RespValue::FromVariant(const RespVariant& variant) {
   return RespValue(variant);
 }
 
+RespValue RespValue::FromVariant(RespVariant&& variant) {
+  return RespValue(std::move(variant));
+}
+
 }  // namespace myredis
@@ -3,6 +3,7 @@
 
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -21,23 +22,29 @@ class RespValue {
                                    RespInteger, RespBulkString, RespArray>;
 
   [[nodiscard]] std::string Serialize() const;
+  // Appends the serialized value to `out`.
+  void SerializeTo(std::string& out) const;
   [[nodiscard]] const RespVariant& GetValue() const;
+  // For a consumer that takes the value's contents (e.g. moves a request's
+  // bulk strings into the store) instead of copying them.
+  [[nodiscard]] RespVariant& GetMutableValue();
   [[nodiscard]] std::string Show() const;
 
-  static std::pair<RespValue, size_t> FromString(const std::string& str);
+  static std::pair<RespValue, size_t> FromString(std::string_view str);
   static RespValue FromVariant(const RespVariant& variant);
+  static RespValue FromVariant(RespVariant&& variant);
 
  private:
   RespVariant value_;
 
   explicit RespValue(RespVariant variant);
-  static RespVariant ParseVariant(const std::string& str, size_t& pos);
-  static RespSimpleString ParseSimpleString(const std::string& str,
+  static RespVariant ParseVariant(std::string_view str, size_t& pos);
+  static RespSimpleString ParseSimpleString(std::string_view str,
                                             size_t& pos);
-  static RespSimpleError ParseSimpleError(const std::string& str, size_t& pos);
-  static RespInteger ParseInteger(const std::string& str, size_t& pos);
-  static RespBulkString ParseBulkString(const std::string& str, size_t& pos);
-  static RespArray ParseArray(const std::string& str, size_t& pos);
+  static RespSimpleError ParseSimpleError(std::string_view str, size_t& pos);
+  static RespInteger ParseInteger(std::string_view str, size_t& pos);
+  static RespBulkString ParseBulkString(std::string_view str, size_t& pos);
+  static RespArray ParseArray(std::string_view str, size_t& pos);
 };
 
 }  // namespace myredis
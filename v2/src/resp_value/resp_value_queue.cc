@@ -1,35 +1,48 @@
 #include "resp_value_queue.h"
 
-#include <cassert>
 #include <stdexcept>
+#include <utility>
 
 namespace myredis {
 
-void RespValueQueue::PushString(const std::string& str) { buffer_.append(str); }
+void RespValueQueue::PushString(const std::string_view str) {
+  // Drop the parsed prefix once it is at least half the buffer, so the
+  // buffer is not shifted after every value but cannot grow without bound.
+  if (read_pos_ > 0 && read_pos_ >= buffer_.size() / 2) {
+    buffer_.erase(0, read_pos_);
+    read_pos_ = 0;
+  }
+  buffer_.append(str);
+}
 
-std::optional<RespValue> RespValueQueue::PopValue() {
-  // Try process anything on the string buffer.
-  try {
-    while (true) {
-      auto [val, pos] = RespValue::FromString(buffer_);
-      // Successfully parsed a value that consumed 'pos' chars of buffer_.
-      values_.push(std::move(val));
-
-      // Remove consumed prefix from buffer_
-      if (pos < buffer_.size()) {
-        buffer_ = buffer_.substr(pos);
-      } else {
-        buffer_.clear();
-      }
+std::optional<std::size_t> RespValueQueue::Parse(const std::string_view input) {
+  std::size_t pos = 0;
+  std::optional<RespValue> value;
+  while (true) {
+    switch (parser_.Next(input, pos, value)) {
+      case RespParser::Status::kValue:
+        values_.push(std::move(*value));
+        break;
+      case RespParser::Status::kNeedMore:
+        return pos;
+      case RespParser::Status::kError:
+        parser_.Reset();
+        return std::nullopt;
     }
-  } catch (const std::out_of_range&) {  // NOLINT(*-empty-catch)
-    // Incomplete input: leave the partial data in buffer_ and wait for more.
   }
-  // let std::invalid_argument propagate to caller
+}
+
+std::optional<RespValue> RespValueQueue::PopValue() {
+  if (read_pos_ < buffer_.size()) {
+    const std::optional<std::size_t> taken =
+        Parse(std::string_view(buffer_).substr(read_pos_));
+    if (!taken) throw std::invalid_argument("Malformed RESP framing");
+    read_pos_ += *taken;
+  }
 
   if (values_.empty()) return std::nullopt;
 
-  RespValue value = values_.front();
+  RespValue value = std::move(values_.front());
   values_.pop();
   return value;
 }
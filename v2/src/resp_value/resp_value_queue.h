@@ -1,37 +1,58 @@
 #ifndef MYREDIS_RESP_VALUE_RESP_VALUE_QUEUE_H_
 #define MYREDIS_RESP_VALUE_RESP_VALUE_QUEUE_H_
 
+#include <cstddef>
 #include <optional>
 #include <queue>
+#include <span>
 #include <string>
+#include <string_view>
 
+#include "resp_parser.h"
 #include "resp_value.h"
 
 namespace myredis {
 
+// Turns a byte stream into a queue of RespValues, with a RespParser that
+// carries partly parsed values over from one piece of input to the next.
 class RespValueQueue {
  public:
+  static constexpr std::size_t kStreamThreshold = RespParser::kStreamThreshold;
+
   // Appends `str` to the internal buffer. Parsing happens lazily in PopValue,
   // so this never throws.
-  void PushString(const std::string& str);
-
-  /* Parses as many RespValue objects as the buffer allows, then removes and
-   * returns the next one (std::nullopt if none are available).
+  void PushString(std::string_view str);
+
+  // Parses `input` into the queue without buffering it, and returns how many
+  // bytes were taken: everything but an incomplete trailing line, which the
+  // caller keeps and passes again, with more bytes after it, next time.
+  // Returns std::nullopt on malformed framing. Not to be mixed with
+  // PushString.
+  std::optional<std::size_t> Parse(std::string_view input);
+
+  // See RespParser::StreamingSpace: lets the caller recv() the rest of a
+  // large bulk string straight into the value.
+  [[nodiscard]] std::span<char> StreamingSpace() {
+    return parser_.StreamingSpace();
+  }
+  void CommitStreamed(const std::size_t n) { parser_.CommitStreamed(n); }
+
+  /* Parses whatever PushString has buffered, then removes and returns the
+   * next value (std::nullopt if none are available).
    *
    * Behavior:
-   * - Repeatedly attempts to parse RespValue objects from the front of the
-   *   buffer. Each successfully parsed value is moved into the internal queue_
-   *   and the consumed prefix is removed from the buffer.
-   * - If parsing encounters incomplete input, RespValue::FromString throws
-   *   std::out_of_range; this is caught and the (partial) data is left in the
-   *   buffer waiting for more input.
-   * - If parsing fails with std::invalid_argument (malformed framing), that
-   *   exception is not caught here and propagates to the caller.
+   * - Buffered bytes are parsed from a read cursor, once each: a partly
+   *   received value is carried over in the parser, not re-parsed, and the
+   *   parsed prefix is only dropped when PushString next needs the room.
+   * - Malformed framing throws std::invalid_argument.
    */
   std::optional<RespValue> PopValue();
 
  private:
+  RespParser parser_;
   std::string buffer_;
+  // Bytes of buffer_ already parsed.
+  std::size_t read_pos_ = 0;
   std::queue<RespValue> values_;
 };
 
@@ -0,0 +1,133 @@
+#ifndef MYREDIS_SERVER_BATCH_SCHEDULER_H_
+#define MYREDIS_SERVER_BATCH_SCHEDULER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "server/messages.h"
+
+namespace myredis {
+
+// Decides which of the CommandBatches queued for a thread executing commands
+// (the main thread, or an executor) runs next, so that a client pipelining
+// thousands of commands cannot hold up every other client behind it.
+//
+// Clients with batches queued take turns, round-robin, whichever IO thread
+// their batches came from. A turn runs at most `budget` commands of the
+// client's oldest batches, so a large batch is executed a slice at a time,
+// across as many rounds as it takes, while the batches of other clients are
+// executed in between. A client's batches still run in the order they were
+// queued, and each is answered once its last command has run, so replies
+// keep their order too.
+//
+// Clients are told apart by fd. The owner must Finish a client before its fd
+// can be reused, or a new client would just share its place in the rounds.
+class BatchScheduler {
+ public:
+  // `budget` is how many commands a client runs per turn (0: all that it has
+  // queued). `threads` is how many IO threads batches come from.
+  BatchScheduler(const std::size_t budget, const std::size_t threads)
+      : budget_(budget == 0 ? SIZE_MAX : budget), queued_(threads) {}
+
+  BatchScheduler(const BatchScheduler&) = delete;
+  BatchScheduler& operator=(const BatchScheduler&) = delete;
+
+  // Queues `batch`, which came from IO thread `thread`, behind the client's
+  // other batches. A client with nothing queued joins the end of the round.
+  void Add(CommandBatch batch, const std::size_t thread) {
+    Client& client = clients_[batch.fd];
+    client.batches.push_back(Entry{std::move(batch), thread});
+    ++queued_[thread];
+    if (!client.scheduled) {
+      client.scheduled = true;
+      runnable_.push_back(&client);
+    }
+  }
+
+  // Whether no batch is queued.
+  [[nodiscard]] bool Empty() const { return runnable_.empty(); }
+
+  // How many batches from IO thread `thread` have yet to be answered.
+  [[nodiscard]] std::size_t Queued(const std::size_t thread) const {
+    return queued_[thread];
+  }
+
+  // Gives a turn to every client with batches queued as the round starts.
+  // For each slice of a batch, calls `run(CommandBatch&, begin, end)` to
+  // execute requests [begin, end), appending their replies to its `reply`;
+  // once a batch has run to its end, calls `done(CommandBatch&, thread)`,
+  // which may move from it, with the IO thread it came from.
+  template <typename Run, typename Done>
+  void RunRound(Run&& run, Done&& done) {
+    for (std::size_t turns = runnable_.size(); turns > 0; --turns) {
+      Client& client = *runnable_.front();
+      runnable_.pop_front();
+      RunTurn(client, budget_, run, done);
+      if (client.batches.empty()) {
+        client.scheduled = false;
+      } else {
+        runnable_.push_back(&client);
+      }
+    }
+  }
+
+  // Runs whatever the client on `fd` has queued to its end, at once, e.g.
+  // before the fd is closed. Its place in the round, if any, is kept for the
+  // next client on the same fd.
+  template <typename Run, typename Done>
+  void Finish(const int fd, Run&& run, Done&& done) {
+    const auto iter = clients_.find(fd);
+    if (iter != clients_.end()) RunTurn(iter->second, SIZE_MAX, run, done);
+  }
+
+ private:
+  struct Entry {
+    CommandBatch batch;
+    std::size_t thread;
+  };
+  struct Client {
+    std::deque<Entry> batches;
+    // The next request of the oldest batch to run.
+    std::size_t next = 0;
+    // Whether the client is in runnable_.
+    bool scheduled = false;
+  };
+
+  template <typename Run, typename Done>
+  void RunTurn(Client& client, std::size_t budget, Run& run, Done& done) {
+    while (!client.batches.empty()) {
+      Entry& oldest = client.batches.front();
+      const std::size_t size = oldest.batch.requests.Size();
+      const std::size_t end =
+          size - client.next > budget ? client.next + budget : size;
+      run(oldest.batch, client.next, end);
+      budget -= end - client.next;
+      if (end < size) {
+        client.next = end;
+        return;
+      }
+      client.next = 0;
+      --queued_[oldest.thread];
+      done(oldest.batch, oldest.thread);
+      client.batches.pop_front();
+      if (budget == 0) return;
+    }
+  }
+
+  const std::size_t budget_;
+  // Never erased, so the pointers in runnable_ stay valid; there are no more
+  // of them than fds.
+  std::unordered_map<int, Client> clients_;
+  // The clients with batches queued, in the order of their next turn.
+  std::deque<Client*> runnable_;
+  // Indexed by IO thread.
+  std::vector<std::size_t> queued_;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_SERVER_BATCH_SCHEDULER_H_
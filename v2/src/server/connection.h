@@ -1,24 +1,73 @@
 #ifndef MYREDIS_SERVER_CONNECTION_H_
 #define MYREDIS_SERVER_CONNECTION_H_
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <optional>
 #include <string>
 
-#include "resp_value/resp_value_queue.h"
+#include "network/recv_buffer.h"
+#include "resp_value/resp_frame_parser.h"
+#include "server/output_buffer.h"
 
 namespace myredis {
 
 // Per-client state owned exclusively by the single IO thread that the client
 // was assigned to. Because exactly one thread touches a Connection, it needs no
-// locking.
+// locking; migrating a client to another thread moves the whole struct through
+// the message queues.
 struct Connection {
-  explicit Connection(int client_fd) : fd(client_fd) {}
+  explicit Connection(int client_fd) : fd(client_fd), id(NextId()) {}
+
+  // A client's state only ever moves, between threads along with the client.
+  Connection(const Connection&) = delete;
+  Connection& operator=(const Connection&) = delete;
+  Connection(Connection&&) = default;
+  Connection& operator=(Connection&&) = default;
 
   int fd;
-  // Incrementally accumulates received bytes and yields parsed RESP values.
-  RespValueQueue parse_queue;
-  // Bytes queued for writing that have not yet been accepted by the socket
-  // (i.e. SendAll returned would-block). Drained on EPOLLOUT.
-  std::string out_buffer;
+  // Unique to this client for the life of the process, unlike its fd, so that
+  // a reply meant for an earlier client with the same fd is told apart.
+  std::uint64_t id;
+  // Received bytes not yet parsed: at most an incomplete request, between
+  // reads. Empty (and holding no memory) for an idle client.
+  RecvBuffer recv_buffer;
+  // How far the incomplete request in recv_buffer has been parsed.
+  RespFrameParser parser;
+  // Reply bytes not yet accepted by the socket. The epoll engine writes from
+  // it directly; the io_uring engine only parks replies here while the client
+  // migrates between threads.
+  OutputBuffer out_buffer;
+  // Set while the unwritten replies exceed the soft output-buffer limit. No
+  // more requests are read from a throttled client until they drain below it.
+  bool throttled = false;
+  // When the unwritten replies went over the soft limit, if they still are.
+  std::optional<std::chrono::steady_clock::time_point> over_soft_limit_since;
+
+  // Replies are numbered in the order of the requests they answer, as the IO
+  // thread hands the requests on or answers them itself, and written in that
+  // order whichever thread produced them and whenever they arrive (see
+  // IoThread::DeliverReply).
+  std::uint64_t replies_issued = 0;
+  std::uint64_t replies_written = 0;
+  // Replies that arrived before an earlier one: [i] is reply number
+  // replies_written + i, or std::nullopt while it has yet to arrive.
+  std::deque<std::optional<std::string>> early_replies;
+  // CommandBatches handed to other threads and not answered yet. A read the
+  // IO thread could answer itself (see IoThread::SetReadStore) goes after
+  // them instead while there are any, so it sees the client's earlier writes.
+  std::uint64_t batches_executing = 0;
+  // Requests parsed from this client since the thread owning it last
+  // reported them in a ClientLoads.
+  std::uint64_t recent_commands = 0;
+
+ private:
+  static std::uint64_t NextId() {
+    static std::atomic<std::uint64_t> next{1};
+    return next.fetch_add(1, std::memory_order_relaxed);
+  }
 };
 
 }  // namespace myredis
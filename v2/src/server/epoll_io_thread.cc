@@ -0,0 +1,294 @@
+#include "epoll_io_thread.h"
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <span>
+#include <string>
+#include <unordered_set>
+#include <utility>
+
+namespace myredis {
+
+namespace {
+constexpr std::size_t kMaxEvents = 64;
+// Reply chunks handed to one sendmsg.
+constexpr std::size_t kMaxWriteChunks = 64;
+// Most bytes read from one client per EPOLLIN before they are parsed.
+constexpr std::size_t kMaxReadBytes = 1024 * 1024;
+
+// recv/send on a non-blocking, level-triggered socket can report these to mean
+// "nothing more right now" rather than a real failure. EINTR is grouped here
+// because the socket stays readable/writable and epoll will fire again.
+bool WouldBlockOrInterrupted(const ssize_t result) {
+  return result < 0 &&
+         (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+}
+}  // namespace
+
+EpollIoThread::EpollIoThread(ReadySet& main_ready,
+                             const std::size_t index, const int listen_fd,
+                             const OutputBufferLimits output_limits)
+    : IoThread(main_ready, index, listen_fd, output_limits),
+      epoll_fd_(epoll_create1(EPOLL_CLOEXEC)) {
+  // Register the inbox wakeup so the main thread can hand us work while we are
+  // blocked in epoll_wait, plus our own listen socket if we accept directly,
+  // and the soft output-limit timer if there is one.
+  for (const int watched_fd :
+       {InboxWaker().Fd(), ListenFd(), SoftLimitTimerFd()}) {
+    if (watched_fd < 0) continue;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = watched_fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, watched_fd, &ev);
+  }
+}
+
+EpollIoThread::~EpollIoThread() {
+  Stop();
+  if (epoll_fd_ >= 0) close(epoll_fd_);
+}
+
+void EpollIoThread::Run() {
+  std::array<epoll_event, kMaxEvents> events{};
+  while (IsRunning()) {
+    DrainInbox();
+    FlushPendingWrites();
+    // Only block once neither the sockets nor the inbox have anything for us;
+    // while we are awake the main thread posts without waking us.
+    int nfds = epoll_wait(epoll_fd_, events.data(), events.size(), 0);
+    if (nfds == 0 && PrepareToPark()) {
+      nfds = epoll_wait(epoll_fd_, events.data(), events.size(), -1);
+      FinishPark();
+    }
+    if (nfds < 0) {
+      if (errno == EINTR) continue;  // interrupted; just re-arm
+      break;                         // unrecoverable epoll error
+    }
+
+    for (int i = 0; i < nfds; ++i) {
+      const epoll_event& ev = events[i];
+      const bool is_inbox = ev.data.fd == InboxWaker().Fd();
+      const bool is_error = (ev.events & (EPOLLERR | EPOLLHUP)) != 0;
+
+      if (is_inbox) {
+        InboxWaker().Drain();  // the inbox itself is drained every pass
+      } else if (ev.data.fd == ListenFd()) {
+        HandleAcceptable();
+      } else if (ev.data.fd == SoftLimitTimerFd()) {
+        for (const int client_fd : TakeStalledClients()) {
+          connections_.at(client_fd).out_buffer.Clear();
+          CloseConnection(client_fd, /*notify_main=*/true);
+        }
+      } else if (is_error) {
+        CloseConnection(ev.data.fd, /*notify_main=*/true);
+      } else {
+        if (ev.events & EPOLLIN) HandleReadable(ev.data.fd);
+        // HandleReadable may have closed the connection; only write if it is
+        // still alive.
+        if ((ev.events & EPOLLOUT) && connections_.contains(ev.data.fd)) {
+          HandleWritable(ev.data.fd);
+        }
+      }
+    }
+  }
+}
+
+void EpollIoThread::HandleAssign(int client_fd) {
+  // Client sockets must be non-blocking for the epoll loop.
+  const int flags = fcntl(client_fd, F_GETFL, 0);
+  fcntl(client_fd, F_SETFL, flags | O_NONBLOCK);
+
+  connections_.try_emplace(client_fd, client_fd);
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = client_fd;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_fd, &ev);
+}
+
+void EpollIoThread::HandleWriteResponse(WriteResponse& response) {
+  const auto it = connections_.find(response.fd);
+  if (it == connections_.end()) {  // client already disconnected
+    ReleaseReplyBuffer(std::move(response.bytes));
+    return;
+  }
+  // Written by FlushPendingWrites once the whole inbox has been drained.
+  it->second.out_buffer.Append(std::move(response.bytes), Recycler());
+  pending_writes_.push_back(response.fd);
+}
+
+void EpollIoThread::HandleMigrate(int client_fd) {
+  const auto it = connections_.find(client_fd);
+  if (it == connections_.end()) return;  // already disconnected
+  // Bytes still in the socket's receive buffer are simply read by the adopting
+  // thread; whatever we have buffered either way travels with the Connection.
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, client_fd, nullptr);
+  Connection conn = std::move(it->second);
+  connections_.erase(it);
+  EmitDetached(std::move(conn));
+}
+
+void EpollIoThread::HandleAdopt(Connection& connection) {
+  const int client_fd = connection.fd;
+  Connection& conn =
+      connections_.insert_or_assign(client_fd, std::move(connection))
+          .first->second;
+
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.fd = client_fd;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_fd, &ev);
+  // Replies the previous thread had not written yet go out before anything
+  // the main thread sends us for this client.
+  if (!conn.out_buffer.Empty()) pending_writes_.push_back(client_fd);
+}
+
+void EpollIoThread::ResumeReads() {
+  // Swap out first: UpdateEpoll re-inserts if the outbox fills up again.
+  std::unordered_set<int> paused;
+  paused.swap(read_paused_);
+  for (const int client_fd : paused) {
+    const auto it = connections_.find(client_fd);
+    if (it != connections_.end()) UpdateEpoll(it->second);
+  }
+}
+
+void EpollIoThread::HandleAcceptable() {
+  // Drain the accept queue (the listen socket is non-blocking), then hand the
+  // whole burst to the main thread in one message.
+  int client_fd = accept4(ListenFd(), nullptr, nullptr, SOCK_NONBLOCK);
+  while (client_fd >= 0) {
+    accepted_.push_back(client_fd);
+    client_fd = accept4(ListenFd(), nullptr, nullptr, SOCK_NONBLOCK);
+  }
+  if (accepted_.empty()) return;
+  RegisterAccepted(accepted_);
+  accepted_.clear();
+}
+
+void EpollIoThread::HandleReadable(int client_fd) {
+  const auto it = connections_.find(client_fd);
+  if (it == connections_.end()) return;
+  Connection& conn = it->second;
+  if (ReadsPaused(conn)) {
+    // Leave the bytes in the socket until we can take more requests.
+    UpdateEpoll(conn);
+    return;
+  }
+
+  const bool alive = ReadIntoParseQueue(conn);
+  const bool well_formed = EmitParsedCommands(conn);
+
+  // Drop the connection on peer shutdown or a protocol error.
+  if (!alive || !well_formed) CloseConnection(client_fd, /*notify_main=*/true);
+}
+
+bool EpollIoThread::ReadIntoParseQueue(Connection& conn) {
+  // recv straight into the connection's receive buffer, which grows while a
+  // client keeps it full. Stop after kMaxReadBytes so a client streaming
+  // faster than we parse cannot make it grow without bound; the rest stays
+  // in the socket for the next EPOLLIN.
+  //
+  // While the parser is streaming in a large bulk string and nothing is
+  // buffered ahead of it, recv into the value itself instead.
+  std::size_t read = 0;
+  ssize_t n = 0;
+  while (read < kMaxReadBytes) {
+    std::span<char> space;
+    if (conn.recv_buffer.Empty()) space = conn.parser.StreamingSpace();
+    const bool streaming = !space.empty();
+    if (!streaming) space = conn.recv_buffer.WritableSpace(RecvPool());
+    n = recv(conn.fd, space.data(), space.size(), MSG_DONTWAIT);
+    if (n <= 0) break;
+    RecordBytesRead(static_cast<std::size_t>(n));
+    if (streaming) {
+      conn.parser.CommitStreamed(static_cast<std::size_t>(n));
+    } else {
+      conn.recv_buffer.Commit(static_cast<std::size_t>(n));
+    }
+    read += static_cast<std::size_t>(n);
+  }
+
+  if (n == 0) return false;  // peer performed an orderly shutdown
+  // n < 0: drained (still alive) for would-block/interrupt, otherwise fatal.
+  return n > 0 || WouldBlockOrInterrupted(n);
+}
+
+void EpollIoThread::HandleWritable(int client_fd) {
+  const auto it = connections_.find(client_fd);
+  if (it == connections_.end()) return;
+  FlushOutBuffer(it->second);
+}
+
+void EpollIoThread::FlushOutBuffer(Connection& conn) {
+  // Write as much as the socket will currently accept, a whole batch of chunks
+  // per sendmsg (a writev that can pass MSG_NOSIGNAL), and keep the rest for
+  // EPOLLOUT.
+  std::array<iovec, kMaxWriteChunks> iov;
+  while (!conn.out_buffer.Empty()) {
+    msghdr msg{};
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = conn.out_buffer.Gather(iov.data(), iov.size());
+    const ssize_t n = sendmsg(conn.fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (n > 0) {
+      conn.out_buffer.Consume(static_cast<std::size_t>(n), Recycler());
+    } else if (WouldBlockOrInterrupted(n)) {
+      break;
+    } else {
+      conn.out_buffer.Clear();
+      CloseConnection(conn.fd, /*notify_main=*/true);  // fatal write error
+      return;
+    }
+  }
+
+  if (!CheckOutputBuffer(conn, conn.out_buffer.Size())) {
+    conn.out_buffer.Clear();
+    CloseConnection(conn.fd, /*notify_main=*/true);  // over its output limit
+    return;
+  }
+  UpdateEpoll(conn);
+}
+
+void EpollIoThread::FlushPendingWrites() {
+  if (pending_writes_.empty()) return;
+  std::ranges::sort(pending_writes_);
+  const auto duplicates = std::ranges::unique(pending_writes_);
+  pending_writes_.erase(duplicates.begin(), duplicates.end());
+  for (const int client_fd : pending_writes_) {
+    const auto it = connections_.find(client_fd);
+    if (it != connections_.end()) FlushOutBuffer(it->second);
+  }
+  pending_writes_.clear();
+}
+
+void EpollIoThread::CloseConnection(int client_fd, bool notify_main) {
+  const auto it = connections_.find(client_fd);
+  if (it == connections_.end()) return;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, client_fd, nullptr);
+  connections_.erase(it);
+  // The main thread closes the fd once it has dropped its routing entry.
+  if (notify_main) {
+    Emit(Disconnect{client_fd});
+  } else {
+    close(client_fd);
+  }
+}
+
+void EpollIoThread::UpdateEpoll(const Connection& conn) {
+  if (OutboxBlocked()) read_paused_.insert(conn.fd);
+  epoll_event ev{};
+  if (!ReadsPaused(conn)) ev.events |= EPOLLIN;
+  // Subscribe to EPOLLOUT only while bytes remain to be flushed.
+  if (!conn.out_buffer.Empty()) ev.events |= EPOLLOUT;
+  ev.data.fd = conn.fd;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &ev);
+}
+
+}  // namespace myredis
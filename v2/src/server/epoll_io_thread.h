@@ -0,0 +1,70 @@
+#ifndef MYREDIS_SERVER_EPOLL_IO_THREAD_H_
+#define MYREDIS_SERVER_EPOLL_IO_THREAD_H_
+
+#include <cstddef>
+#include <unordered_set>
+#include <vector>
+
+#include "concurrent/ready_set.h"
+#include "server/connection.h"
+#include "server/io_thread.h"
+#include "server/messages.h"
+
+namespace myredis {
+
+// IoThread driven by a level-triggered epoll set: each wakeup reports ready
+// sockets, which are then drained with recv and written with send.
+class EpollIoThread final : public IoThread {
+ public:
+  EpollIoThread(ReadySet& main_ready, std::size_t index, int listen_fd,
+                OutputBufferLimits output_limits);
+  ~EpollIoThread() override;
+
+  EpollIoThread(const EpollIoThread&) = delete;
+  EpollIoThread& operator=(const EpollIoThread&) = delete;
+
+ private:
+  void Run() override;
+
+  void HandleAssign(int client_fd) override;
+  void HandleWriteResponse(WriteResponse& response) override;
+  void HandleMigrate(int client_fd) override;
+  void HandleAdopt(Connection& connection) override;
+  void ResumeReads() override;
+
+  // Accepts every client queued on ListenFd() and registers them as a batch.
+  void HandleAcceptable();
+
+  // Client socket handling.
+  void HandleReadable(int client_fd);
+  void HandleWritable(int client_fd);
+  // Reads until the socket would block. Returns false if the connection should
+  // be closed (peer shutdown or fatal error), true if it is still alive.
+  bool ReadIntoParseQueue(Connection& conn);
+  // Writes as much of conn.out_buffer as the socket accepts, applies the
+  // output-buffer limits to whatever remains and updates the epoll interest.
+  void FlushOutBuffer(Connection& conn);
+  // Flushes every client that got replies since the last call: once per pass
+  // of the event loop, after DrainInbox has appended all of them, so a burst
+  // of replies to one client costs one write.
+  void FlushPendingWrites();
+
+  void CloseConnection(int client_fd, bool notify_main);
+  // Set epoll interest for a client: EPOLLIN unless its reads are paused,
+  // plus EPOLLOUT while it has bytes left to write. A client paused for the
+  // outbox is remembered in read_paused_.
+  void UpdateEpoll(const Connection& conn);
+
+  int epoll_fd_ = -1;
+  // Scratch list for HandleAcceptable, kept to reuse its allocation.
+  std::vector<int> accepted_;
+  // Clients with replies appended since the last FlushPendingWrites. May hold
+  // duplicates and clients that have since gone.
+  std::vector<int> pending_writes_;
+  // Clients whose EPOLLIN was dropped because the outbox was full.
+  std::unordered_set<int> read_paused_;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_SERVER_EPOLL_IO_THREAD_H_
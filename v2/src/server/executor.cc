@@ -0,0 +1,135 @@
+#include "executor.h"
+
+#include <poll.h>
+
+#include <cassert>
+#include <string>
+#include <utility>
+#include <variant>
+
+#include "resp_value/reply_builder.h"
+#include "server/handler/command.h"
+#include "server/server_stats.h"
+#include "time/timenow.h"
+
+namespace myredis {
+
+Executor::Executor(const std::vector<std::unique_ptr<IoThread>>& io_threads,
+                   const bool io_encode_replies, const bool io_reads,
+                   const std::size_t command_budget)
+    : store_(std::make_unique<Store>(
+          std::make_unique<TimeNow>(),
+          StoreConcurrency{.readers = io_reads ? io_threads.size() : 0})),
+      // INFO is executed on the main thread, never here.
+      dispatcher_(store_, [] { return ServerStats{}; }),
+      io_threads_(io_threads),
+      io_encode_replies_(io_encode_replies),
+      ready_(io_threads.size() + 1),
+      control_(io_threads.size()),
+      scheduler_(command_budget, io_threads.size()) {
+  for (const auto& io_thread : io_threads_) {
+    [[maybe_unused]] const std::size_t previous = link_;
+    link_ = io_thread->AddExecutorLink(ready_);
+    // Every IO thread has its executors' links in the same order.
+    assert(previous == 0 || link_ == previous);
+    if (io_reads) io_thread->SetReadStore(link_, *store_);
+  }
+}
+
+Executor::~Executor() { Stop(); }
+
+void Executor::Start() {
+  running_.store(true, std::memory_order_relaxed);
+  thread_ = std::thread([this] { Run(); });
+}
+
+void Executor::Stop() {
+  running_.store(false, std::memory_order_relaxed);
+  ready_.Mark(control_);
+  if (thread_.joinable()) thread_.join();
+}
+
+void Executor::Pause() {
+  pause_requested_.store(true, std::memory_order_release);
+  ready_.Mark(control_);
+  paused_.wait(false, std::memory_order_acquire);
+}
+
+void Executor::Resume() {
+  pause_requested_.store(false, std::memory_order_release);
+  pause_requested_.notify_one();
+  // So that a Pause straight after cannot mistake this pause for its own.
+  paused_.wait(true, std::memory_order_acquire);
+}
+
+void Executor::Run() {
+  while (running_.load(std::memory_order_relaxed)) {
+    ready_.Drain([this](const std::size_t index) {
+      if (index != control_) ProcessOutbox(index);
+    });
+    RunRound();
+    if (pause_requested_.load(std::memory_order_acquire)) {
+      paused_.store(true, std::memory_order_release);
+      paused_.notify_one();
+      pause_requested_.wait(true, std::memory_order_acquire);
+      paused_.store(false, std::memory_order_release);
+      paused_.notify_one();
+      continue;
+    }
+    if (scheduler_.Empty() && ready_.PrepareToPark()) {
+      pollfd wakeup{.fd = ready_.Fd(), .events = POLLIN, .revents = 0};
+      const int ready = poll(&wakeup, 1, -1);
+      ready_.Unpark();
+      if (ready > 0) ready_.ResetWakeup();
+    }
+  }
+}
+
+void Executor::ProcessOutbox(const std::size_t thread_index) {
+  IoThread& io_thread = *io_threads_[thread_index];
+  // Whatever did not fit in its inbox last time goes first.
+  io_thread.FlushBacklog(link_);
+  // As Server::ProcessOutbox: no more batches wait here than its outbox
+  // holds.
+  if (scheduler_.Queued(thread_index) >= IoThread::kQueueCapacity) {
+    ready_.Mark(thread_index);
+    return;
+  }
+  io_thread.DrainOutbox(
+      [this, thread_index](OutboxMsg& msg) {
+        // IO threads send executors nothing else.
+        scheduler_.Add(std::move(std::get<CommandBatch>(msg)), thread_index);
+      },
+      link_);
+}
+
+void Executor::RunRound() {
+  // As Server::ExecuteSlice and Server::Respond, but replying to the IO
+  // thread the batch came from: a client never moves to another one while
+  // there are executors. A client that went away is not dropped from the
+  // scheduler, as the main thread does: this executor never hears of it, and
+  // its IO thread drops the replies.
+  scheduler_.RunRound(
+      [this](CommandBatch& batch, const std::size_t begin,
+             const std::size_t end) {
+        ReplyBuilder reply(batch.reply,
+                           io_encode_replies_ ? &batch.deferred : nullptr);
+        for (std::size_t i = begin; i < end; ++i) {
+          Command command = CommandAt(batch.requests, i);
+          dispatcher_.Dispatch(command, reply);
+        }
+        commands_processed_.fetch_add(end - begin, std::memory_order_relaxed);
+      },
+      [this](CommandBatch& batch, const std::size_t thread_index) {
+        io_threads_[thread_index]->PostResponse(
+            WriteResponse{.fd = batch.fd,
+                          .client_id = batch.client_id,
+                          .seq = batch.seq,
+                          .bytes = std::move(batch.reply),
+                          .spent_requests = std::move(batch.requests),
+                          .deferred = std::move(batch.deferred)},
+            link_);
+      });
+}
+
+}  // namespace myredis
@@ -0,0 +1,93 @@
+#ifndef MYREDIS_SERVER_EXECUTOR_H_
+#define MYREDIS_SERVER_EXECUTOR_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "concurrent/ready_set.h"
+#include "server/batch_scheduler.h"
+#include "server/handler/request_dispatcher.h"
+#include "server/io_thread.h"
+#include "server/messages.h"
+#include "store/store.h"
+
+namespace myredis {
+
+// One of several command executors (ServerConfig::executors > 1), each a
+// thread with a store of its own: the shard holding the keys in its range of
+// hash slots (see ExecutorForKey). IO threads hand it the requests on those
+// keys directly and it answers them directly, so the shards are never shared
+// and need no locking, and the main thread is not involved at all.
+//
+// Executors are connected to every IO thread, through a link of their own
+// (see IoThread), and mark their ReadySet like the main thread's.
+class Executor {
+ public:
+  // Adds a link to this executor to each of `io_threads`, none of which may
+  // have started yet, and all of which must outlive the executor. With
+  // `io_reads`, the shard is read-concurrent and they serve reads from it.
+  // Clients take turns at running `command_budget` commands (see
+  // BatchScheduler).
+  Executor(const std::vector<std::unique_ptr<IoThread>>& io_threads,
+           bool io_encode_replies, bool io_reads, std::size_t command_budget);
+  ~Executor();
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  void Start();
+  // Signal the thread to stop and join it.
+  void Stop();
+
+  // Waits for the thread to stop between two turns (see BatchScheduler) and
+  // keep off its store until Resume, e.g. to fork a snapshot of it. Main
+  // thread only.
+  void Pause();
+  void Resume();
+
+  // The shard. Only while the executor is not running, or paused.
+  [[nodiscard]] Store& GetStore() { return *store_; }
+
+  // Commands executed so far. Safe to call from any thread.
+  [[nodiscard]] std::uint64_t CommandsProcessed() const {
+    return commands_processed_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  void Run();
+  void ProcessOutbox(std::size_t thread_index);
+  // Runs every client with batches queued for a turn.
+  void RunRound();
+
+  // Declared before `dispatcher_`, which binds a reference to it.
+  std::unique_ptr<Store> store_;
+  RequestDispatcher dispatcher_;
+
+  const std::vector<std::unique_ptr<IoThread>>& io_threads_;
+  const bool io_encode_replies_;
+  // This executor's link number on every IO thread.
+  std::size_t link_ = 0;
+
+  // IO threads -> this executor wakeup, indexed like io_threads_, plus one
+  // more index, control_, marked to have the thread look at running_ and
+  // pause_requested_.
+  ReadySet ready_;
+  const std::size_t control_;
+  // The CommandBatches drained from the IO threads, waiting for their turn.
+  BatchScheduler scheduler_;
+
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> pause_requested_{false};
+  std::atomic<bool> paused_{false};
+
+  std::atomic<std::uint64_t> commands_processed_{0};
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_SERVER_EXECUTOR_H_
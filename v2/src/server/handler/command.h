@@ -1,51 +1,97 @@
 #ifndef MYREDIS_SERVER_HANDLER_COMMAND_H_
 #define MYREDIS_SERVER_HANDLER_COMMAND_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <optional>
+#include <span>
 #include <string>
-#include <variant>
-#include <vector>
+#include <string_view>
+#include <utility>
 
-#include "resp_value/resp_value.h"
+#include "resp_value/resp_frame.h"
+#include "server/handler/command_table.h"
+#include "store/map/hash.h"
 
 namespace myredis {
 
 // A client request is a RESP array of bulk strings: the command keyword
-// followed by its arguments. `Command` is the parsed form shared by the
-// handlers in the request-dispatch chain.
+// followed by its arguments. `Command` is the form the dispatcher looks up and
+// the handlers execute.
 //
-// `name` is the (non-null, non-empty) command keyword. `args` are the bulk
-// strings that follow it; an argument may itself be a null bulk string (e.g.
-// the value of `SET key <nil>`), hence std::optional.
+// `name` is the (non-null, non-empty) command keyword, or empty for a request
+// that is not a well-formed command (not an array, empty, or a non-bulk-string
+// / null / empty command keyword). `args` are the bulk strings that follow it;
+// an argument may itself be a null bulk string (e.g. the value of
+// `SET key <nil>`), hence std::optional. Both view the bytes the request was
+// received in rather than copying them, so checking a request against every
+// handler costs nothing per byte of a large value; they are only valid while
+// the RespFrames it was parsed into is alive.
+//
+// `spec` and `key_hash` are what ResolveCommand worked out for the request on
+// the IO thread: its command, and the hash of its key (if it has one).
 struct Command {
-  std::string name;
-  std::vector<std::optional<std::string>> args;
+  std::string_view name;
+  std::span<const RespArg> args;
+  const CommandSpec* spec = nullptr;
+  std::size_t key_hash = 0;
+  // The strings of the batch that some arguments may view (see
+  // RespFrames::owned), which TakeArg moves rather than copies.
+  std::deque<std::string>* owned = nullptr;
 };
 
-// Parses `request` into a Command, or returns std::nullopt if it is not a
-// well-formed command array (not an array, empty, or a non-bulk-string /
-// null / empty command keyword).
-inline std::optional<Command> ParseCommand(const RespValue& request) {
-  const auto* array =
-      std::get_if<RespValue::RespArray>(&request.GetValue());
-  if (array == nullptr || array->empty()) return std::nullopt;
-
-  const auto* name = std::get_if<RespValue::RespBulkString>(
-      &array->front().GetValue());
-  if (name == nullptr || !name->has_value() || (*name)->empty()) {
-    return std::nullopt;
+// The Command for request `index` of `requests`.
+inline Command CommandAt(RespFrames& requests, const std::size_t index) {
+  const RespFrame& frame = requests.frames[index];
+  if (frame.arg_count == 0) return Command{};
+  const std::span<const RespArg> args(requests.args.data() + frame.first_arg,
+                                      frame.arg_count);
+  return Command{
+      .name = *args.front(),
+      .args = args.subspan(1),
+      .spec = frame.command == RespFrame::kUnresolved
+                  ? nullptr
+                  : &kCommandTable[frame.command],
+      .key_hash = frame.key_hash,
+      .owned = &requests.owned};
+}
+
+// Looks `frame` (one of `requests`) up in the command table, recording its
+// command and the hash of its key in it. Returns false, leaving it
+// unresolved, if it is not a command, or not one the server knows, or has the
+// wrong number of arguments for it: a request only to be answered with
+// kUnknownCommandError. Whether the arguments make sense beyond their number
+// is left to the command's handler.
+inline bool ResolveCommand(const RespFrames& requests, RespFrame& frame) {
+  if (frame.arg_count == 0) return false;
+  const RespArg* args = requests.args.data() + frame.first_arg;
+  const CommandSpec* spec = FindCommand(*args[0]);
+  if (spec == nullptr || !spec->AcceptsArgCount(frame.arg_count - 1)) {
+    return false;
   }
+  frame.command = static_cast<std::uint8_t>(spec->id);
+  if (spec->first_key != 0 && args[spec->first_key].has_value()) {
+    frame.key_hash = StringHash(*args[spec->first_key]);
+  }
+  return true;
+}
 
-  Command command;
-  command.name = **name;
-  command.args.reserve(array->size() - 1);
-  for (std::size_t i = 1; i < array->size(); ++i) {
-    const auto* arg =
-        std::get_if<RespValue::RespBulkString>(&(*array)[i].GetValue());
-    if (arg == nullptr) return std::nullopt;  // arguments must be bulk strings
-    command.args.push_back(*arg);
+// Argument `index` of `command` as a string the handler can hand on (e.g.
+// into the store). An argument received into a string of its own (a large
+// value) is moved out of it rather than copied, invalidating its view.
+inline std::optional<std::string> TakeArg(const Command& command,
+                                          const std::size_t index) {
+  const RespArg& arg = command.args[index];
+  if (!arg) return std::nullopt;
+  if (command.owned != nullptr) {
+    for (std::string& owned : *command.owned) {
+      if (owned.data() == arg->data() && !owned.empty()) {
+        return std::move(owned);
+      }
+    }
   }
-  return command;
+  return std::string(*arg);
 }
 
 }  // namespace myredis
@@ -0,0 +1,204 @@
+#ifndef MYREDIS_SERVER_HANDLER_COMMAND_TABLE_H_
+#define MYREDIS_SERVER_HANDLER_COMMAND_TABLE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace myredis {
+
+// Every command the server implements, indexing kCommandTable.
+enum class CommandId : std::uint8_t {
+  kGet,
+  kSet,
+  kDel,
+  kExpire,
+  kPexpire,
+  kExpireat,
+  kPexpireat,
+  kTtl,
+  kPttl,
+  kPersist,
+  kEcho,
+  kPing,
+  kHello,
+  kInfo,
+};
+inline constexpr std::size_t kCommandCount =
+    static_cast<std::size_t>(CommandId::kInfo) + 1;
+
+// Command flags, after Redis's command table.
+inline constexpr std::uint32_t kCommandWrite = 1U << 0;     // modifies keys
+inline constexpr std::uint32_t kCommandReadOnly = 1U << 1;  // only reads keys
+inline constexpr std::uint32_t kCommandFast = 1U << 2;      // O(1) or O(log N)
+// Touches neither the store nor server state, so the IO thread that parsed
+// the request answers it itself (see StatelessDispatcher).
+inline constexpr std::uint32_t kCommandStateless = 1U << 3;
+
+struct CommandSpec {
+  // Upper case; requests match it case-insensitively.
+  std::string_view name;
+  CommandId id;
+  // Number of request elements, counting the name, as Redis gives it: N
+  // means exactly N, -N at least N. Handlers may check further.
+  int arity;
+  std::uint32_t flags;
+  // Position of the key among the request elements (the name being 0), or 0
+  // for a command that takes none.
+  int first_key;
+
+  // Whether a request with `args` arguments after the name fits the arity.
+  [[nodiscard]] constexpr bool AcceptsArgCount(const std::size_t args) const {
+    const std::size_t elements = args + 1;
+    return arity >= 0 ? elements == static_cast<std::size_t>(arity)
+                      : elements >= static_cast<std::size_t>(-arity);
+  }
+};
+
+inline constexpr std::array<CommandSpec, kCommandCount> kCommandTable = {{
+    {"GET", CommandId::kGet, 2, kCommandReadOnly | kCommandFast, 1},
+    {"SET", CommandId::kSet, 3, kCommandWrite, 1},
+    {"DEL", CommandId::kDel, 2, kCommandWrite, 1},
+    {"EXPIRE", CommandId::kExpire, -3, kCommandWrite | kCommandFast, 1},
+    {"PEXPIRE", CommandId::kPexpire, -3, kCommandWrite | kCommandFast, 1},
+    {"EXPIREAT", CommandId::kExpireat, -3, kCommandWrite | kCommandFast, 1},
+    {"PEXPIREAT", CommandId::kPexpireat, -3, kCommandWrite | kCommandFast, 1},
+    {"TTL", CommandId::kTtl, 2, kCommandReadOnly | kCommandFast, 1},
+    {"PTTL", CommandId::kPttl, 2, kCommandReadOnly | kCommandFast, 1},
+    {"PERSIST", CommandId::kPersist, 2, kCommandWrite | kCommandFast, 1},
+    {"ECHO", CommandId::kEcho, 2, kCommandFast | kCommandStateless, 0},
+    {"PING", CommandId::kPing, -1, kCommandFast | kCommandStateless, 0},
+    {"HELLO", CommandId::kHello, -1, kCommandFast | kCommandStateless, 0},
+    {"INFO", CommandId::kInfo, -1, 0, 0},
+}};
+
+// The reply to a request for a command that does not exist, or with the
+// wrong number of arguments for it.
+inline constexpr std::string_view kUnknownCommandError =
+    "Unknown subcommand or command";
+
+namespace command_table_internal {
+
+constexpr char ToUpper(const char c) {
+  return c >= 'a' && c <= 'z' ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// FNV-1a over the upper-cased name, seeded.
+constexpr std::uint32_t HashName(const std::string_view name,
+                                 const std::uint32_t seed) {
+  std::uint32_t hash = 2166136261U ^ seed;
+  for (const char c : name) {
+    hash ^= static_cast<unsigned char>(ToUpper(c));
+    hash *= 16777619U;
+  }
+  return hash;
+}
+
+// A power of two with room to spare, so a collision-free seed is quick to
+// find.
+inline constexpr std::size_t kSlotCount = 64;
+static_assert(kSlotCount >= 2 * kCommandCount);
+
+constexpr bool IsPerfect(const std::uint32_t seed) {
+  std::array<bool, kSlotCount> taken{};
+  for (const CommandSpec& spec : kCommandTable) {
+    bool& slot = taken[HashName(spec.name, seed) % kSlotCount];
+    if (slot) return false;
+    slot = true;
+  }
+  return true;
+}
+
+consteval std::uint32_t FindSeed() {
+  std::uint32_t seed = 0;
+  while (!IsPerfect(seed)) ++seed;
+  return seed;
+}
+
+inline constexpr std::uint32_t kSeed = FindSeed();
+
+// kCommandTable index + 1 for each slot, 0 for an empty one.
+consteval std::array<std::uint8_t, kSlotCount> BuildSlots() {
+  std::array<std::uint8_t, kSlotCount> slots{};
+  for (std::size_t i = 0; i < kCommandTable.size(); ++i) {
+    slots[HashName(kCommandTable[i].name, kSeed) % kSlotCount] =
+        static_cast<std::uint8_t>(i + 1);
+  }
+  return slots;
+}
+
+inline constexpr std::array<std::uint8_t, kSlotCount> kSlots = BuildSlots();
+
+consteval std::size_t LongestName() {
+  std::size_t longest = 0;
+  for (const CommandSpec& spec : kCommandTable) {
+    longest = spec.name.size() > longest ? spec.name.size() : longest;
+  }
+  return longest;
+}
+
+inline constexpr std::size_t kLongestName = LongestName();
+
+consteval bool IdsMatchIndices() {
+  for (std::size_t i = 0; i < kCommandTable.size(); ++i) {
+    if (static_cast<std::size_t>(kCommandTable[i].id) != i) return false;
+  }
+  return true;
+}
+
+static_assert(IdsMatchIndices(), "kCommandTable must be in CommandId order");
+
+consteval bool StatelessCommandsTakeNoKeys() {
+  for (const CommandSpec& spec : kCommandTable) {
+    if ((spec.flags & kCommandStateless) != 0 && spec.first_key != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(StatelessCommandsTakeNoKeys());
+
+consteval bool KeysWithinArity() {
+  for (const CommandSpec& spec : kCommandTable) {
+    const int min_elements = spec.arity >= 0 ? spec.arity : -spec.arity;
+    if (spec.first_key < 0 ||
+        (spec.first_key != 0 && spec.first_key >= min_elements)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(KeysWithinArity(), "a command's key must always be present");
+
+}  // namespace command_table_internal
+
+// The command called `name`, matched case-insensitively, or nullptr. A
+// perfect hash built at compile time picks the only candidate, so this costs
+// one pass over the name to hash it and one to compare it, however many
+// commands there are.
+constexpr const CommandSpec* FindCommand(const std::string_view name) {
+  namespace internal = command_table_internal;
+  if (name.empty() || name.size() > internal::kLongestName) return nullptr;
+  const std::uint8_t slot =
+      internal::kSlots[internal::HashName(name, internal::kSeed) %
+                       internal::kSlotCount];
+  if (slot == 0) return nullptr;
+  const CommandSpec& spec = kCommandTable[slot - 1];
+  if (spec.name.size() != name.size()) return nullptr;
+  for (std::size_t i = 0; i < name.size(); ++i) {
+    if (internal::ToUpper(name[i]) != spec.name[i]) return nullptr;
+  }
+  return &spec;
+}
+
+static_assert(FindCommand("persist")->id == CommandId::kPersist);
+static_assert(FindCommand("PExpireAt")->id == CommandId::kPexpireat);
+static_assert(FindCommand("GETS") == nullptr);
+static_assert(FindCommand("") == nullptr);
+
+}  // namespace myredis
+
+#endif  // MYREDIS_SERVER_HANDLER_COMMAND_TABLE_H_
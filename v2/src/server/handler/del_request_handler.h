@@ -2,11 +2,9 @@
 #define MYREDIS_SERVER_HANDLER_DEL_REQUEST_HANDLER_H_
 
 #include <memory>
-#include <optional>
 #include <string>
 
-#include "resp_value/resp_value.h"
-#include "resp_value/resp_values.h"
+#include "resp_value/reply_builder.h"
 #include "server/handler/command.h"
 #include "server/handler/handler.h"
 #include "store/store.h"
@@ -19,16 +17,13 @@ class DelRequestHandler final : public Handler {
   explicit DelRequestHandler(const std::unique_ptr<Store>& store)
       : store_(store) {}
 
-  [[nodiscard]] bool IsHandler(const RespValue& request) const override {
-    const std::optional<Command> command = ParseCommand(request);
-    return command && command->name == "DEL" && command->args.size() == 1 &&
-           command->args[0].has_value() && !command->args[0]->empty();
+  [[nodiscard]] bool Accepts(const Command& command) const override {
+    return command.args[0].has_value() && !command.args[0]->empty();
   }
 
-  [[nodiscard]] RespValue Handle(const RespValue& request) override {
-    const std::optional<Command> command = ParseCommand(request);
-    store_->Del(*command->args[0]);
-    return Integer(1);
+  void Handle(Command& command, ReplyBuilder& reply) override {
+    store_->Del(std::string(*command.args[0]), command.key_hash);
+    reply.Raw(kOneReply);
   }
 
  private:
@@ -1,22 +1,15 @@
 #ifndef MYREDIS_SERVER_HANDLER_ECHO_REQUEST_HANDLER_H_
 #define MYREDIS_SERVER_HANDLER_ECHO_REQUEST_HANDLER_H_
 
-#include "resp_value/resp_value.h"
-#include "resp_value/resp_values.h"
+#include "resp_value/reply_builder.h"
 #include "server/handler/command.h"
 #include "server/handler/handler.h"
 
 namespace myredis {
 
 class EchoRequestHandler final : public Handler {
-  [[nodiscard]] bool IsHandler(const RespValue& request) const override {
-    const std::optional<Command> command = ParseCommand(request);
-    return command && command->name == "ECHO" && command->args.size() == 1;
-  }
-
-  [[nodiscard]] RespValue Handle(const RespValue& request) override {
-    const std::optional<Command> command = ParseCommand(request);
-    return BulkString(command->args[0]);
+  void Handle(Command& command, ReplyBuilder& reply) override {
+    reply.NullableBulk(command.args[0]);
   }
 };
 
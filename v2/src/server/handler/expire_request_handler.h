@@ -6,9 +6,9 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 
-#include "resp_value/resp_value.h"
-#include "resp_value/resp_values.h"
+#include "resp_value/reply_builder.h"
 #include "server/handler/command.h"
 #include "server/handler/handler.h"
 #include "store/store.h"
@@ -23,41 +23,36 @@ namespace myredis {
 // condition isn't met.
 class ExpireRequestHandler final : public Handler {
  public:
-  explicit ExpireRequestHandler(std::string handler_name,
-                                const int time_conversion_factor,
-                                const bool relative_to_now,
-                                const std::unique_ptr<Store>& store)
+  ExpireRequestHandler(const int time_conversion_factor,
+                       const bool relative_to_now,
+                       const std::unique_ptr<Store>& store)
       : store_(store),
-        handler_name_(std::move(handler_name)),
         time_conversion_factor_(time_conversion_factor),
         relative_to_now_(relative_to_now) {}
 
-  [[nodiscard]] bool IsHandler(const RespValue& request) const override {
-    const std::optional<Command> command = ParseCommand(request);
-    return command && command->name == handler_name_ &&
-           (command->args.size() == 2 || command->args.size() == 3) &&
-           command->args[0].has_value() && !command->args[0]->empty() &&
-           ParseInteger(command->args[1]).has_value() &&
-           (command->args.size() == 2 ||
-            Store::ToExpireOption(*command->args[2]).has_value());
+  [[nodiscard]] bool Accepts(const Command& command) const override {
+    return command.args.size() <= 3 && command.args[0].has_value() && !command.args[0]->empty() &&
+           ParseInteger(command.args[1]).has_value() &&
+           (command.args.size() == 2 ||
+            Store::ToExpireOption(*command.args[2]).has_value());
   }
 
-  [[nodiscard]] RespValue Handle(const RespValue& request) override {
-    const std::optional<Command> command = ParseCommand(request);
-    const int64_t value = *ParseInteger(command->args[1]);
+  void Handle(Command& command, ReplyBuilder& reply) override {
+    const int64_t value = *ParseInteger(command.args[1]);
     const Store::ExpireOption option =
-        command->args.size() == 3 ? *Store::ToExpireOption(*command->args[2])
+        command.args.size() == 3 ? *Store::ToExpireOption(*command.args[2])
                                   : Store::ExpireOption::NA;
     const int64_t base = relative_to_now_ ? store_->NowMs() : 0;
     const int64_t proposed_expiry = base + (value * time_conversion_factor_);
-    const bool set =
-        store_->ExpireAt(*command->args[0], proposed_expiry, option);
-    return Integer(set ? 1 : 0);
+    const bool set = store_->ExpireAt(std::string(*command.args[0]),
+                                      command.key_hash, proposed_expiry,
+                                      option);
+    reply.Raw(set ? kOneReply : kZeroReply);
   }
 
  private:
   static std::optional<int64_t> ParseInteger(
-      const std::optional<std::string>& arg) {
+      const std::optional<std::string_view>& arg) {
     if (!arg.has_value() || arg->empty()) return std::nullopt;
     int64_t value = 0;
     const auto [ptr, errc] =
@@ -72,8 +67,6 @@ class ExpireRequestHandler final : public Handler {
   // reference stays valid even if the store's contents are replaced (e.g.
   // snapshot restore).
   const std::unique_ptr<Store>& store_;
-
-  const std::string handler_name_;
   const int time_conversion_factor_;
   const bool relative_to_now_;
 };
@@ -2,11 +2,9 @@
 #define MYREDIS_SERVER_HANDLER_GET_REQUEST_HANDLER_H_
 
 #include <memory>
-#include <optional>
 #include <string>
 
-#include "resp_value/resp_value.h"
-#include "resp_value/resp_values.h"
+#include "resp_value/reply_builder.h"
 #include "server/handler/command.h"
 #include "server/handler/handler.h"
 #include "store/store.h"
@@ -20,17 +18,23 @@ class GetRequestHandler final : public Handler {
   explicit GetRequestHandler(const std::unique_ptr<Store>& store)
       : store_(store) {}
 
-  [[nodiscard]] bool IsHandler(const RespValue& request) const override {
-    const std::optional<Command> command = ParseCommand(request);
-    return command && command->name == "GET" && command->args.size() == 1 &&
-           command->args[0].has_value() && !command->args[0]->empty();
+  [[nodiscard]] bool Accepts(const Command& command) const override {
+    return command.args[0].has_value() && !command.args[0]->empty();
   }
 
-  [[nodiscard]] RespValue Handle(const RespValue& request) override {
-    const std::optional<Command> command = ParseCommand(request);
-    const std::optional<std::string> found = store_->Get(*command->args[0]);
-    if (!found.has_value()) return NullBulkString();
-    return BulkString(found);
+  void Handle(Command& command, ReplyBuilder& reply) override {
+    // Copied once, from the store into the reply; a large value perhaps not
+    // even on this thread (see ReplyBuilder::SharedBulk).
+    const bool found = store_->VisitValue(
+        std::string(*command.args[0]), command.key_hash,
+        [&reply](const Store::Value& value) {
+          if (const auto* shared = value.Shared()) {
+            reply.SharedBulk(*shared);
+          } else {
+            reply.Bulk(value.Bytes());
+          }
+        });
+    if (!found) reply.NullBulk();
   }
 
  private:
@@ -1,23 +1,35 @@
 #ifndef MYREDIS_SERVER_HANDLER_HANDLER_H_
 #define MYREDIS_SERVER_HANDLER_HANDLER_H_
 
-#include "resp_value/resp_value.h"
+#include "resp_value/reply_builder.h"
+#include "server/handler/command.h"
 
 namespace myredis {
 
-// One link in the request-dispatch chain. The dispatcher walks its handlers in
-// order, asking each whether it handles a given request; the first match
-// produces the response.
+// Executes one command of the command table (see command_table.h). The IO
+// thread that parsed the request looks its command up there and checks its
+// arity (see ResolveCommand); the dispatcher then hands it to that command's
+// handler, which may reject arguments the arity alone does not rule out.
 //
-// A handler returns the response RespValue rather than writing to a socket.
-// Command execution is single-threaded, so handlers run without locking; the
-// returned value is serialized and routed back to the owning IO thread.
+// A handler writes its reply into `reply` rather than to a socket: straight
+// into the buffer that carries the batch's replies back to the owning IO
+// thread, with no RespValue in between. Command execution is single-threaded,
+// so handlers run without locking. The handlers of stateless commands are
+// the exception: each IO thread runs instances of its own (see
+// StatelessDispatcher), so they must hold no state that outlives a Handle.
+// Handle may take the request's arguments (see TakeArg) rather than copy
+// them; the command is not used again afterwards.
 class Handler {
  public:
   virtual ~Handler() = default;
 
-  [[nodiscard]] virtual bool IsHandler(const RespValue& request) const = 0;
-  [[nodiscard]] virtual RespValue Handle(const RespValue& request) = 0;
+  // Whether `command`'s arguments are acceptable. Its name and argument count
+  // have already been matched against the command's table entry.
+  [[nodiscard]] virtual bool Accepts(const Command& /*command*/) const {
+    return true;
+  }
+  // Writes exactly one reply.
+  virtual void Handle(Command& command, ReplyBuilder& reply) = 0;
 };
 
 }  // namespace myredis
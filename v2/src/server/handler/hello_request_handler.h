@@ -1,8 +1,9 @@
 #ifndef MYREDIS_SERVER_HANDLER_HELLO_REQUEST_HANDLER_H_
 #define MYREDIS_SERVER_HANDLER_HELLO_REQUEST_HANDLER_H_
 
-#include "resp_value/resp_value.h"
-#include "resp_value/resp_values.h"
+#include <string_view>
+
+#include "resp_value/reply_builder.h"
 #include "server/handler/command.h"
 #include "server/handler/handler.h"
 
@@ -13,31 +14,26 @@ namespace myredis {
 // protover is "2"; anything else (notably "3") is rejected the way real
 // Redis rejects protocol versions the server doesn't speak.
 class HelloRequestHandler final : public Handler {
-  [[nodiscard]] bool IsHandler(const RespValue& request) const override {
-    const std::optional<Command> command = ParseCommand(request);
-    return command && command->name == "HELLO" && command->args.size() <= 1;
+  [[nodiscard]] bool Accepts(const Command& command) const override {
+    return command.args.size() <= 1;
   }
 
-  [[nodiscard]] RespValue Handle(const RespValue& request) override {
-    const std::optional<Command> command = ParseCommand(request);
-    if (command->args.size() == 1 && command->args[0] != "2") {
-      return Error(
-          "NOPROTO unsupported protocol version");
+  // The server info never changes, so it is encoded once.
+  static constexpr std::string_view kHelloReply =
+      "*12\r\n"
+      "$6\r\nserver\r\n$7\r\nmyredis\r\n"
+      "$7\r\nversion\r\n$5\r\n0.1.0\r\n"
+      "$5\r\nproto\r\n:2\r\n"
+      "$4\r\nmode\r\n$10\r\nstandalone\r\n"
+      "$4\r\nrole\r\n$6\r\nmaster\r\n"
+      "$7\r\nmodules\r\n*0\r\n";
+
+  void Handle(Command& command, ReplyBuilder& reply) override {
+    if (command.args.size() == 1 && command.args[0] != "2") {
+      reply.Error("NOPROTO unsupported protocol version");
+      return;
     }
-    return Array({
-        BulkString("server"),
-        BulkString("myredis"),
-        BulkString("version"),
-        BulkString("0.1.0"),
-        BulkString("proto"),
-        Integer(2),
-        BulkString("mode"),
-        BulkString("standalone"),
-        BulkString("role"),
-        BulkString("master"),
-        BulkString("modules"),
-        Array({}),
-    });
+    reply.Raw(kHelloReply);
   }
 };
 
@@ -0,0 +1,87 @@
+#ifndef MYREDIS_SERVER_HANDLER_INFO_REQUEST_HANDLER_H_
+#define MYREDIS_SERVER_HANDLER_INFO_REQUEST_HANDLER_H_
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "resp_value/reply_builder.h"
+#include "server/handler/command.h"
+#include "server/handler/handler.h"
+#include "server/server_stats.h"
+
+namespace myredis {
+
+// INFO [section ...]: replies with a bulk string of `# Section` headers, each
+// followed by `field:value` lines, as Redis does. With no arguments (or
+// "all"/"everything"/"default") every section is included; otherwise only the
+// named ones, matched case-insensitively.
+class InfoRequestHandler final : public Handler {
+ public:
+  // `stats` is called once per INFO to gather the current counters.
+  explicit InfoRequestHandler(std::function<ServerStats()> stats)
+      : stats_(std::move(stats)) {}
+
+  void Handle(Command& command, ReplyBuilder& reply) override {
+    const ServerStats stats = stats_();
+    std::string info;
+    if (Wants(command, "server")) {
+      AppendSection(info, "Server", {{"io_threads", stats.io_threads},
+                                     {"executors", stats.executors}});
+    }
+    if (Wants(command, "clients")) {
+      AppendSection(info, "Clients",
+                    {{"connected_clients", stats.connected_clients}});
+    }
+    if (Wants(command, "stats")) {
+      AppendSection(
+          info, "Stats",
+          {{"total_commands_processed", stats.total_commands_processed},
+           {"io_commands_processed", stats.io_commands_processed},
+           {"io_inbox_overflows", stats.io_inbox_overflows},
+           {"io_inbox_backlog", stats.io_inbox_backlog},
+           {"io_outbox_overflows", stats.io_outbox_overflows},
+           {"client_migrations", stats.client_migrations}});
+    }
+    reply.Bulk(info);
+  }
+
+ private:
+  using Field = std::pair<std::string_view, std::uint64_t>;
+
+  static bool Wants(const Command& command, std::string_view section) {
+    if (command.args.empty()) return true;
+    return std::any_of(
+        command.args.begin(), command.args.end(),
+        [section](const std::optional<std::string_view>& arg) {
+          if (!arg.has_value()) return false;
+          std::string name(*arg);
+          std::transform(name.begin(), name.end(), name.begin(),
+                         [](unsigned char c) { return std::tolower(c); });
+          return name == section || name == "all" || name == "everything" ||
+                 name == "default";
+        });
+  }
+
+  static void AppendSection(std::string& info, std::string_view title,
+                            std::initializer_list<Field> fields) {
+    if (!info.empty()) info += "\r\n";
+    info.append("# ").append(title).append("\r\n");
+    for (const auto& [name, value] : fields) {
+      info.append(name).append(":").append(std::to_string(value)).append(
+          "\r\n");
+    }
+  }
+
+  std::function<ServerStats()> stats_;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_SERVER_HANDLER_INFO_REQUEST_HANDLER_H_
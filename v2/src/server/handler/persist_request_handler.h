@@ -2,11 +2,9 @@
 #define MYREDIS_SERVER_HANDLER_PERSIST_REQUEST_HANDLER_H_
 
 #include <memory>
-#include <optional>
 #include <string>
 
-#include "resp_value/resp_value.h"
-#include "resp_value/resp_values.h"
+#include "resp_value/reply_builder.h"
 #include "server/handler/command.h"
 #include "server/handler/handler.h"
 #include "store/store.h"
@@ -20,17 +18,14 @@ class PersistRequestHandler final : public Handler {
   explicit PersistRequestHandler(const std::unique_ptr<Store>& store)
       : store_(store) {}
 
-  [[nodiscard]] bool IsHandler(const RespValue& request) const override {
-    const std::optional<Command> command = ParseCommand(request);
-    return command && command->name == "PERSIST" &&
-           command->args.size() == 1 && command->args[0].has_value() &&
-           !command->args[0]->empty();
+  [[nodiscard]] bool Accepts(const Command& command) const override {
+    return command.args[0].has_value() && !command.args[0]->empty();
   }
 
-  [[nodiscard]] RespValue Handle(const RespValue& request) override {
-    const std::optional<Command> command = ParseCommand(request);
-    const bool persisted = store_->Persist(*command->args[0]);
-    return Integer(persisted ? 1 : 0);
+  void Handle(Command& command, ReplyBuilder& reply) override {
+    const bool persisted =
+        store_->Persist(std::string(*command.args[0]), command.key_hash);
+    reply.Raw(persisted ? kOneReply : kZeroReply);
   }
 
  private:
@@ -0,0 +1,42 @@
+#include "server/handler/read_dispatcher.h"
+
+#include <cassert>
+#include <cstdint>
+#include <string_view>
+
+namespace myredis {
+
+void ReadDispatcher::Dispatch(const Store& store, const Command& command,
+                              ReplyBuilder& reply) const {
+  assert(command.spec != nullptr && "requests are resolved on the IO thread");
+  // The handlers' Accepts: every read-only command takes just a key.
+  if (!command.args[0].has_value() || command.args[0]->empty()) {
+    reply.Error(kUnknownCommandError);
+    return;
+  }
+  const std::string_view key = *command.args[0];
+  switch (command.spec->id) {
+    case CommandId::kGet:
+      if (!store.ReadValue(reader_, key, command.key_hash,
+                           [&reply](const std::string_view value) {
+                             reply.Bulk(value);
+                           })) {
+        reply.NullBulk();
+      }
+      return;
+    case CommandId::kTtl:
+    case CommandId::kPttl: {
+      const std::int64_t result =
+          store.ReadTtl(reader_, key, command.key_hash);
+      const int factor = command.spec->id == CommandId::kTtl ? 1000 : 1;
+      // As TtlRequestHandler: the sentinels are not durations.
+      reply.Integer(result < 0 ? result : result / factor);
+      return;
+    }
+    default:
+      assert(false && "every read-only command needs a case here");
+      reply.Error(kUnknownCommandError);
+  }
+}
+
+}  // namespace myredis
@@ -0,0 +1,41 @@
+#ifndef MYREDIS_SERVER_HANDLER_READ_DISPATCHER_H_
+#define MYREDIS_SERVER_HANDLER_READ_DISPATCHER_H_
+
+#include <cstddef>
+
+#include "resp_value/reply_builder.h"
+#include "resp_value/resp_frame.h"
+#include "server/handler/command.h"
+#include "server/handler/command_table.h"
+#include "store/store.h"
+
+namespace myredis {
+
+// Executes the commands flagged kCommandReadOnly (GET, TTL, PTTL) against a
+// read-concurrent store (see Store::ReadValue), so that an IO thread can
+// answer them while the thread that owns the store goes on writing it. The
+// replies are those of the commands' handlers, copied out of the store here
+// rather than by the owner. Each IO thread has its own, with its own reader
+// number on the stores.
+class ReadDispatcher {
+ public:
+  explicit ReadDispatcher(const std::size_t reader) : reader_(reader) {}
+
+  // Whether `frame`, a resolved request, is for a read-only command.
+  [[nodiscard]] static bool Handles(const RespFrame& frame) {
+    return frame.command != RespFrame::kUnresolved &&
+           (kCommandTable[frame.command].flags & kCommandReadOnly) != 0;
+  }
+
+  // As RequestDispatcher::Dispatch, for a command this Handles, on `store`:
+  // the one holding its key.
+  void Dispatch(const Store& store, const Command& command,
+                ReplyBuilder& reply) const;
+
+ private:
+  const std::size_t reader_;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_SERVER_HANDLER_READ_DISPATCHER_H_
@@ -1,19 +1,22 @@
 #include "server/handler/request_dispatcher.h"
 
+#include <cassert>
+#include <cstddef>
+#include <functional>
 #include <memory>
 #include <string>
+#include <utility>
 
-#include "resp_value/resp_values.h"
 #include "server/handler/del_request_handler.h"
 #include "server/handler/echo_request_handler.h"
 #include "server/handler/expire_request_handler.h"
 #include "server/handler/get_request_handler.h"
 #include "server/handler/hello_request_handler.h"
+#include "server/handler/info_request_handler.h"
 #include "server/handler/persist_request_handler.h"
 #include "server/handler/ping_request_handler.h"
 #include "server/handler/set_request_handler.h"
 #include "server/handler/ttl_request_handler.h"
-#include "server/handler/unknown_request_handler.h"
 
 namespace {
 constexpr int SECONDS_TO_MILLISECONDS = 1000;
@@ -21,46 +24,52 @@ constexpr int SECONDS_TO_MILLISECONDS = 1000;
 
 namespace myredis {
 
-RequestDispatcher::RequestDispatcher(const std::unique_ptr<Store>& store)
+RequestDispatcher::RequestDispatcher(const std::unique_ptr<Store>& store,
+                                     std::function<ServerStats()> stats)
     : store_(store) {
-  handlers_.push_back(std::make_unique<GetRequestHandler>(store_));
-  handlers_.push_back(std::make_unique<SetRequestHandler>(store_));
-  handlers_.push_back(std::make_unique<DelRequestHandler>(store_));
-  // EXPIRE handler
-  handlers_.push_back(std::make_unique<ExpireRequestHandler>(
-      "EXPIRE", SECONDS_TO_MILLISECONDS, /*relative_to_now=*/true, store_));
-  // PEXPIRE handler
-  handlers_.push_back(std::make_unique<ExpireRequestHandler>(
-      "PEXPIRE", 1, /*relative_to_now=*/true, store_));
-  // EXPIREAT handler
-  handlers_.push_back(std::make_unique<ExpireRequestHandler>(
-      "EXPIREAT", SECONDS_TO_MILLISECONDS, /*relative_to_now=*/false,
-      store_));
-  // PEXPIREAT handler
-  handlers_.push_back(std::make_unique<ExpireRequestHandler>(
-      "PEXPIREAT", 1, /*relative_to_now=*/false, store_));
-  // TTL
-  handlers_.push_back(std::make_unique<TtlRequestHandler>(
-      "TTL", SECONDS_TO_MILLISECONDS, store_));
-  // PTTL
-  handlers_.push_back(std::make_unique<TtlRequestHandler>("PTTL", 1, store_));
-  // PERSIST
-  handlers_.push_back(std::make_unique<PersistRequestHandler>(store_));
-  handlers_.push_back(std::make_unique<EchoRequestHandler>());
-  handlers_.push_back(std::make_unique<PingRequestHandler>());
-  handlers_.push_back(std::make_unique<HelloRequestHandler>());
-  // Must remain last: matches anything the handlers above rejected.
-  handlers_.push_back(std::make_unique<UnknownRequestHandler>());
+  Register(CommandId::kGet, std::make_unique<GetRequestHandler>(store_));
+  Register(CommandId::kSet, std::make_unique<SetRequestHandler>(store_));
+  Register(CommandId::kDel, std::make_unique<DelRequestHandler>(store_));
+  Register(CommandId::kExpire,
+           std::make_unique<ExpireRequestHandler>(
+               SECONDS_TO_MILLISECONDS, /*relative_to_now=*/true, store_));
+  Register(CommandId::kPexpire,
+           std::make_unique<ExpireRequestHandler>(
+               1, /*relative_to_now=*/true, store_));
+  Register(CommandId::kExpireat,
+           std::make_unique<ExpireRequestHandler>(
+               SECONDS_TO_MILLISECONDS, /*relative_to_now=*/false, store_));
+  Register(CommandId::kPexpireat,
+           std::make_unique<ExpireRequestHandler>(
+               1, /*relative_to_now=*/false, store_));
+  Register(CommandId::kTtl, std::make_unique<TtlRequestHandler>(
+                                SECONDS_TO_MILLISECONDS, store_));
+  Register(CommandId::kPttl, std::make_unique<TtlRequestHandler>(1, store_));
+  Register(CommandId::kPersist,
+           std::make_unique<PersistRequestHandler>(store_));
+  Register(CommandId::kEcho, std::make_unique<EchoRequestHandler>());
+  Register(CommandId::kPing, std::make_unique<PingRequestHandler>());
+  Register(CommandId::kHello, std::make_unique<HelloRequestHandler>());
+  Register(CommandId::kInfo,
+           std::make_unique<InfoRequestHandler>(std::move(stats)));
+  for (const std::unique_ptr<Handler>& handler : handlers_) {
+    assert(handler != nullptr && "every command in the table needs a handler");
+  }
+}
+
+void RequestDispatcher::Register(const CommandId id,
+                                 std::unique_ptr<Handler> handler) {
+  handlers_[static_cast<std::size_t>(id)] = std::move(handler);
 }
 
-RespValue RequestDispatcher::Dispatch(const RespValue& request) const {
-  for (const auto& handler : handlers_) {
-    if (handler->IsHandler(request)) {
-      return handler->Handle(request);
-    }
+void RequestDispatcher::Dispatch(Command& command, ReplyBuilder& reply) const {
+  assert(command.spec != nullptr && "requests are resolved on the IO thread");
+  Handler& handler = *handlers_[static_cast<std::size_t>(command.spec->id)];
+  if (handler.Accepts(command)) {
+    handler.Handle(command, reply);
+    return;
   }
-  // Unreachable: UnknownRequestHandler always matches.
-  return Error("Unknown subcommand or command");
+  reply.Error(kUnknownCommandError);
 }
 
 }  // namespace myredis
@@ -1,37 +1,50 @@
 #ifndef MYREDIS_SERVER_HANDLER_REQUEST_DISPATCHER_H_
 #define MYREDIS_SERVER_HANDLER_REQUEST_DISPATCHER_H_
 
+#include <array>
+#include <functional>
 #include <memory>
-#include <vector>
 
-#include "resp_value/resp_value.h"
+#include "resp_value/reply_builder.h"
+#include "server/handler/command.h"
+#include "server/handler/command_table.h"
 #include "server/handler/handler.h"
+#include "server/server_stats.h"
 #include "store/store.h"
 
 namespace myredis {
 
-// Routes a parsed request to the first handler that claims it and returns the
-// response. Takes ownership of the command store, which the handlers reference;
-// the store is injected so the dispatcher stays decoupled from any concrete
-// Map.
+// Routes a request to its command's handler, which writes the reply. The
+// command has already been looked up (see ResolveCommand), by the IO thread
+// that parsed the request. Takes ownership of the
+// command store, which the handlers reference; the store is injected so the
+// dispatcher stays decoupled from any concrete Map. `stats` gathers the server
+// counters INFO reports.
 //
-// Single-threaded: the sole caller of Dispatch is the server's main thread, so
-// the store needs no locking. Not thread-safe by design.
+// Single-threaded: every thread that executes commands (the main thread, an
+// Executor, or with ServerConfig::io_execute each IO thread) has a dispatcher
+// of its own, and the store is either that thread's alone or striped (see
+// StoreConcurrency). Not thread-safe by design.
 class RequestDispatcher {
  public:
-  explicit RequestDispatcher(const std::unique_ptr<Store>& store);
+  RequestDispatcher(const std::unique_ptr<Store>& store,
+                    std::function<ServerStats()> stats);
 
   RequestDispatcher(const RequestDispatcher&) = delete;
   RequestDispatcher& operator=(const RequestDispatcher&) = delete;
 
-  // Executes `request` and returns the response. The chain always ends in an
-  // UnknownRequestHandler, so this always produces a value.
-  [[nodiscard]] RespValue Dispatch(const RespValue& request) const;
+  // Executes `command`, which must be resolved, and writes its reply to
+  // `reply`: an error for arguments its handler does not accept. The handler
+  // may move arguments out of `command`.
+  void Dispatch(Command& command, ReplyBuilder& reply) const;
 
  private:
+  void Register(CommandId id, std::unique_ptr<Handler> handler);
+
   // Declared before `handlers_` so it outlives the handlers that reference it.
   const std::unique_ptr<Store>& store_;
-  std::vector<std::unique_ptr<Handler>> handlers_;
+  // By CommandId.
+  std::array<std::unique_ptr<Handler>, kCommandCount> handlers_;
 };
 
 }  // namespace myredis
@@ -4,9 +4,9 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <utility>
 
-#include "resp_value/resp_value.h"
-#include "resp_value/resp_values.h"
+#include "resp_value/reply_builder.h"
 #include "server/handler/command.h"
 #include "server/handler/handler.h"
 #include "store/store.h"
@@ -19,16 +19,16 @@ class SetRequestHandler final : public Handler {
   explicit SetRequestHandler(const std::unique_ptr<Store>& store)
       : store_(store) {}
 
-  [[nodiscard]] bool IsHandler(const RespValue& request) const override {
-    const std::optional<Command> command = ParseCommand(request);
-    return command && command->name == "SET" && command->args.size() == 2 &&
-           command->args[0].has_value() && !command->args[0]->empty();
+  [[nodiscard]] bool Accepts(const Command& command) const override {
+    return command.args[0].has_value() && !command.args[0]->empty();
   }
 
-  [[nodiscard]] RespValue Handle(const RespValue& request) override {
-    const std::optional<Command> command = ParseCommand(request);
-    store_->Set(*command->args[0], command->args[1]);
-    return SimpleString("OK");
+  void Handle(Command& command, ReplyBuilder& reply) override {
+    // Moved, not copied: a large value goes from the buffer it was received
+    // into straight to the store.
+    std::optional<std::string> key = TakeArg(command, 0);
+    store_->Set(std::move(*key), command.key_hash, TakeArg(command, 1));
+    reply.Ok();
   }
 
  private:
@@ -0,0 +1,39 @@
+#include "server/handler/stateless_dispatcher.h"
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+
+#include "server/handler/echo_request_handler.h"
+#include "server/handler/hello_request_handler.h"
+#include "server/handler/ping_request_handler.h"
+
+namespace myredis {
+
+StatelessDispatcher::StatelessDispatcher() {
+  handlers_[static_cast<std::size_t>(CommandId::kEcho)] =
+      std::make_unique<EchoRequestHandler>();
+  handlers_[static_cast<std::size_t>(CommandId::kPing)] =
+      std::make_unique<PingRequestHandler>();
+  handlers_[static_cast<std::size_t>(CommandId::kHello)] =
+      std::make_unique<HelloRequestHandler>();
+  for (const CommandSpec& spec : kCommandTable) {
+    [[maybe_unused]] const bool stateless = (spec.flags & kCommandStateless) != 0;
+    assert(stateless == (handlers_[static_cast<std::size_t>(spec.id)] !=
+                         nullptr) &&
+           "every stateless command needs a handler here");
+  }
+}
+
+void StatelessDispatcher::Dispatch(Command& command,
+                                   ReplyBuilder& reply) const {
+  assert(command.spec != nullptr && "requests are resolved on the IO thread");
+  Handler& handler = *handlers_[static_cast<std::size_t>(command.spec->id)];
+  if (handler.Accepts(command)) {
+    handler.Handle(command, reply);
+    return;
+  }
+  reply.Error(kUnknownCommandError);
+}
+
+}  // namespace myredis
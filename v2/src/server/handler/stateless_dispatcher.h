@@ -0,0 +1,43 @@
+#ifndef MYREDIS_SERVER_HANDLER_STATELESS_DISPATCHER_H_
+#define MYREDIS_SERVER_HANDLER_STATELESS_DISPATCHER_H_
+
+#include <array>
+#include <memory>
+
+#include "resp_value/reply_builder.h"
+#include "resp_value/resp_frame.h"
+#include "server/handler/command.h"
+#include "server/handler/command_table.h"
+#include "server/handler/handler.h"
+
+namespace myredis {
+
+// Executes the commands flagged kCommandStateless (PING, ECHO, HELLO), which
+// need neither the store nor the main thread, so that an IO thread can answer
+// them without a round trip through the executor. Each IO thread has its own,
+// and with it its own handler instances. RequestDispatcher can still execute
+// these commands too.
+class StatelessDispatcher {
+ public:
+  StatelessDispatcher();
+
+  StatelessDispatcher(const StatelessDispatcher&) = delete;
+  StatelessDispatcher& operator=(const StatelessDispatcher&) = delete;
+
+  // Whether `frame`, a resolved request, is for a stateless command.
+  [[nodiscard]] static bool Handles(const RespFrame& frame) {
+    return frame.command != RespFrame::kUnresolved &&
+           (kCommandTable[frame.command].flags & kCommandStateless) != 0;
+  }
+
+  // As RequestDispatcher::Dispatch, for a command this Handles.
+  void Dispatch(Command& command, ReplyBuilder& reply) const;
+
+ private:
+  // By CommandId; null for the commands that are not stateless.
+  std::array<std::unique_ptr<Handler>, kCommandCount> handlers_;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_SERVER_HANDLER_STATELESS_DISPATCHER_H_
@@ -0,0 +1,30 @@
+#ifndef MYREDIS_SERVER_HASH_SLOT_H_
+#define MYREDIS_SERVER_HASH_SLOT_H_
+
+#include <cstddef>
+
+namespace myredis {
+
+// The keyspace is cut into this many hash slots, as in Redis Cluster, and
+// with several executors (see Executor) each owns an equal, contiguous range
+// of them.
+inline constexpr std::size_t kHashSlots = 16384;
+
+// The hash slot of a key whose hash (StringHash) is `key_hash`.
+constexpr std::size_t HashSlot(const std::size_t key_hash) {
+  return key_hash % kHashSlots;
+}
+
+// Which of `executors` executors owns the key whose hash is `key_hash`.
+constexpr std::size_t ExecutorForKey(const std::size_t key_hash,
+                                     const std::size_t executors) {
+  return HashSlot(key_hash) * executors / kHashSlots;
+}
+
+static_assert(ExecutorForKey(0, 4) == 0);
+static_assert(ExecutorForKey(kHashSlots - 1, 4) == 3);
+static_assert(ExecutorForKey(kHashSlots / 2, 2) == 1);
+
+}  // namespace myredis
+
+#endif  // MYREDIS_SERVER_HASH_SLOT_H_
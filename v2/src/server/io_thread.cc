@@ -1,244 +1,578 @@
 #include "io_thread.h"
 
-#include <fcntl.h>
-#include <sys/epoll.h>
-#include <sys/socket.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 
-#include <array>
-#include <cerrno>
-#include <stdexcept>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <utility>
 #include <variant>
 #include <vector>
 
-namespace myredis {
-
-namespace {
-constexpr std::size_t kMaxEvents = 64;
-constexpr std::size_t kReadBufSize = 4096;
+#include "resp_value/reply_builder.h"
+#include "server/handler/command.h"
+#include "server/handler/command_table.h"
+#include "server/hash_slot.h"
+#include "server/server_stats.h"
 
-// recv/send on a non-blocking, level-triggered socket can report these to mean
-// "nothing more right now" rather than a real failure. EINTR is grouped here
-// because the socket stays readable/writable and epoll will fire again.
-bool WouldBlockOrInterrupted(const ssize_t result) {
-  return result < 0 &&
-         (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
-}
-}  // namespace
+namespace myredis {
 
-IoThread::IoThread(const EventFd& command_event)
-    : epoll_fd_(epoll_create1(EPOLL_CLOEXEC)), command_event_(command_event) {
-  // Register the inbox wakeup so the main thread can hand us work while we are
-  // blocked in epoll_wait.
-  epoll_event ev{};
-  ev.events = EPOLLIN;
-  ev.data.fd = inbox_event_.Fd();
-  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, inbox_event_.Fd(), &ev);
+IoThread::IoThread(ReadySet& main_ready, const std::size_t index,
+                   const int listen_fd, const OutputBufferLimits output_limits)
+    : index_(index),
+      listen_fd_(listen_fd),
+      reads_(index),
+      output_limits_(output_limits) {
+  links_.push_back(std::make_unique<Link>(main_ready));
+  if (output_limits.soft_bytes > 0 && output_limits.soft_duration.count() > 0) {
+    soft_limit_timer_fd_ =
+        timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    const auto interval = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        kSoftLimitCheckInterval);
+    itimerspec its{};
+    its.it_interval.tv_nsec = interval.count();
+    its.it_value = its.it_interval;
+    timerfd_settime(soft_limit_timer_fd_, 0, &its, nullptr);
+  }
 }
 
 IoThread::~IoThread() {
   Stop();
   // Best-effort cleanup of any still-open client sockets.
   for (const auto& [client_fd, conn] : connections_) close(client_fd);
-  if (epoll_fd_ >= 0) close(epoll_fd_);
+  if (listen_fd_ >= 0) close(listen_fd_);
+  if (soft_limit_timer_fd_ >= 0) close(soft_limit_timer_fd_);
+}
+
+std::size_t IoThread::AddExecutorLink(ReadySet& ready) {
+  links_.push_back(std::make_unique<Link>(ready));
+  return links_.size() - 1;
+}
+
+void IoThread::SetReadStore(const std::size_t link, const Store& store) {
+  if (read_stores_.size() <= link) read_stores_.resize(link + 1);
+  read_stores_[link] = &store;
+}
+
+void IoThread::SetExecutionStore(const std::unique_ptr<Store>& store) {
+  // INFO is executed on the main thread, never here.
+  dispatcher_ = std::make_unique<RequestDispatcher>(
+      store, [] { return ServerStats{}; });
 }
 
 void IoThread::Start() {
   running_.store(true, std::memory_order_relaxed);
-  thread_ = std::thread(&IoThread::Run, this);
+  thread_ = std::thread([this] { Run(); });
 }
 
 void IoThread::Stop() {
   running_.store(false, std::memory_order_relaxed);
-  inbox_event_.Notify();  // wake epoll_wait so it observes running_ == false
+  inbox_waker_.Notify();  // wake the event loop so it observes running_ == false
   if (thread_.joinable()) thread_.join();
 }
 
 void IoThread::PostAssign(int client_fd) {
-  // AssignConnection is trivially copyable, so reconstructing it on every
-  // attempt is safe even though a failed Push consumes its argument.
-  while (!inbox_.Push(AssignConnection{client_fd})) {
-    std::this_thread::yield();
+  Post(AssignConnection{client_fd}, *links_[kMainLink]);
+}
+
+void IoThread::PostResponse(WriteResponse response, const std::size_t link) {
+  Post(std::move(response), *links_[link]);
+}
+
+void IoThread::PostMigrate(int client_fd) {
+  Post(MigrateConnection{client_fd}, *links_[kMainLink]);
+}
+
+void IoThread::PostAdopt(Connection connection) {
+  Post(AdoptConnection{std::move(connection)}, *links_[kMainLink]);
+}
+
+void IoThread::PostSampleClientLoads() {
+  Post(SampleClientLoads{}, *links_[kMainLink]);
+}
+
+void IoThread::Post(InboxMsg&& msg, Link& link) {
+  // A failed Push leaves `msg` intact, so it moves exactly once either way.
+  if (link.backlog.empty() && link.inbox.Push(std::move(msg))) {
+    inbox_waker_.Notify();
+    return;
+  }
+  link.inbox_overflows.fetch_add(1, std::memory_order_relaxed);
+  link.backlog.push_back(std::move(msg));
+  // Newly backlogged: FlushBacklog arranges for this thread to tell us once
+  // there is room. Otherwise that is already arranged.
+  if (link.backlog.size() == 1) FlushBacklog(link);
+}
+
+void IoThread::FlushBacklog(const std::size_t link) {
+  FlushBacklog(*links_[link]);
+}
+
+void IoThread::FlushBacklog(Link& link) {
+  std::deque<InboxMsg>& backlog = link.backlog;
+  if (backlog.empty()) return;
+  std::size_t flushed = link.inbox.PushBatch(backlog.begin(), backlog.end());
+  if (flushed < backlog.size()) {
+    // Full. Ask this thread to mark itself in peer_ready once it has emptied
+    // the inbox, then look once more in case it emptied it just before it
+    // could see the request (pairs with the fence in DrainInbox).
+    link.awaiting_inbox_room.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    flushed += link.inbox.PushBatch(backlog.begin() + flushed, backlog.end());
   }
-  inbox_event_.Notify();
+  backlog.erase(backlog.begin(), backlog.begin() + flushed);
+  if (flushed > 0) inbox_waker_.Notify();
 }
 
-void IoThread::PostResponse(int client_fd, std::string bytes) {
-  // Build the message once and copy on retry: a failed Push consumes its
-  // argument, so retrying with a moved value would lose `bytes`.
-  InboxMsg msg = WriteResponse{client_fd, std::move(bytes)};
-  while (!inbox_.Push(msg)) {
-    std::this_thread::yield();
+void IoThread::OnOutboxDrained(Link& link) {
+  // Pairs with the fence in FlushOverflow: either we see the flag here, or the
+  // IO thread's retry after setting it sees the room we made.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (link.awaiting_outbox_room.load(std::memory_order_relaxed) &&
+      link.awaiting_outbox_room.exchange(false, std::memory_order_relaxed)) {
+    inbox_waker_.Notify();
   }
-  inbox_event_.Notify();
 }
 
-void IoThread::Run() {
-  std::array<epoll_event, kMaxEvents> events{};
-  while (running_.load(std::memory_order_relaxed)) {
-    const int nfds = epoll_wait(epoll_fd_, events.data(), events.size(), -1);
-    if (nfds < 0) {
-      if (errno == EINTR) continue;  // interrupted; just re-arm
-      break;                         // unrecoverable epoll error
-    }
+IoThreadLoad IoThread::Load() const {
+  std::size_t outbox_depth = 0;
+  for (const auto& link : links_) outbox_depth += link->outbox.Size();
+  return {.bytes_read = bytes_read_.load(std::memory_order_relaxed),
+          .commands_parsed = commands_parsed_.load(std::memory_order_relaxed),
+          .outbox_depth = outbox_depth};
+}
 
-    for (int i = 0; i < nfds; ++i) {
-      const epoll_event& ev = events[i];
-      const bool is_inbox = ev.data.fd == inbox_event_.Fd();
-      const bool is_error = (ev.events & (EPOLLERR | EPOLLHUP)) != 0;
+IoThreadStats IoThread::Stats() const {
+  std::uint64_t inbox_overflows = 0;
+  for (const auto& link : links_) {
+    inbox_overflows += link->inbox_overflows.load(std::memory_order_relaxed);
+  }
+  return {.inbox_overflows = inbox_overflows,
+          .outbox_overflows = outbox_overflows_.load(std::memory_order_relaxed),
+          .inbox_backlog = links_[kMainLink]->backlog.size(),
+          .commands_processed =
+              commands_processed_.load(std::memory_order_relaxed)};
+}
 
-      if (is_inbox) {
-        inbox_event_.Drain();
-        DrainInbox();
-      } else if (is_error) {
-        CloseConnection(ev.data.fd, /*notify_main=*/true);
-      } else {
-        if (ev.events & EPOLLIN) HandleReadable(ev.data.fd);
-        // HandleReadable may have closed the connection; only write if it is
-        // still alive.
-        if ((ev.events & EPOLLOUT) && connections_.contains(ev.data.fd)) {
-          HandleWritable(ev.data.fd);
-        }
-      }
+bool IoThread::HasInboxWork() const {
+  if (!IsRunning() || !local_ready_.empty()) return true;
+  for (const auto& link : links_) {
+    if (link->inbox.Size() != 0 ||
+        (!link->overflow.empty() &&
+         !link->awaiting_outbox_room.load(std::memory_order_relaxed))) {
+      return true;
     }
   }
+  return false;
 }
 
 void IoThread::DrainInbox() {
-  while (std::optional<InboxMsg> msg = inbox_.Pop()) {
-    if (const auto* assign = std::get_if<AssignConnection>(&*msg)) {
+  if (OutboxBlocked()) {
+    for (const auto& link : links_) {
+      if (!link->overflow.empty()) FlushOverflow(*link);
+    }
+    if (!OutboxBlocked()) ResumeReads();
+  }
+  for (const int client_fd : local_ready_) FlushEarlyReplies(client_fd);
+  local_ready_.clear();
+  // Consume messages in place, a batch at a time.
+  const auto dispatch = [this](InboxMsg& msg) {
+    if (const auto* assign = std::get_if<AssignConnection>(&msg)) {
       HandleAssign(assign->fd);
-    } else if (const auto* response = std::get_if<WriteResponse>(&*msg)) {
-      HandleWriteResponse(*response);
+    } else if (auto* response = std::get_if<WriteResponse>(&msg)) {
+      DeliverReply(*response);
+    } else if (const auto* migrate = std::get_if<MigrateConnection>(&msg)) {
+      HandleMigrate(migrate->fd);
+    } else if (auto* adopt = std::get_if<AdoptConnection>(&msg)) {
+      const int client_fd = adopt->connection.fd;
+      HandleAdopt(adopt->connection);
+      FlushEarlyReplies(client_fd);
+    } else if (std::holds_alternative<SampleClientLoads>(msg)) {
+      EmitClientLoads();
     }
+  };
+  for (const auto& link : links_) {
+    while (link->inbox.PopBatch(dispatch) > 0) {
+    }
+    // Pairs with the fence in FlushBacklog, as OnOutboxDrained does with
+    // FlushOverflow.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (link->awaiting_inbox_room.load(std::memory_order_relaxed) &&
+        link->awaiting_inbox_room.exchange(false, std::memory_order_relaxed)) {
+      link->peer_ready.Mark(index_);
+    }
+  }
+}
+
+void IoThread::EmitClientLoads() {
+  ClientLoads loads;
+  for (auto& [client_fd, conn] : connections_) {
+    if (conn.recent_commands == 0) continue;
+    loads.commands.emplace_back(client_fd, conn.recent_commands);
+    conn.recent_commands = 0;
   }
+  if (!loads.commands.empty()) Emit(std::move(loads));
 }
 
-void IoThread::HandleAssign(int client_fd) {
-  // Client sockets must be non-blocking for the epoll loop.
-  const int flags = fcntl(client_fd, F_GETFL, 0);
-  fcntl(client_fd, F_SETFL, flags | O_NONBLOCK);
+void IoThread::RegisterAccepted(const std::vector<int>& client_fds) {
+  // Register before adopting: the main thread must know where to route a
+  // client's replies before it sees that client's first CommandBatch, and the
+  // outbox is FIFO.
+  Emit(ConnectionsAccepted{client_fds});
+  for (const int client_fd : client_fds) HandleAssign(client_fd);
+}
 
-  connections_.try_emplace(client_fd, client_fd);
+bool IoThread::EmitParsedCommands(Connection& conn,
+                                  std::string_view received) {
+  // Coalesce every request parsed for this connection into a single outbox
+  // message so a pipelined batch costs one push + Notify, not one per command.
+  // The requests are parsed in place and point into the receive block.
+  RespFrames batch = AcquireBatch();
+  RecvBuffer& buffered = conn.recv_buffer;
+  bool well_formed = true;
+  if (buffered.Empty() && !received.empty()) {
+    const std::optional<std::size_t> streamed =
+        conn.parser.ParseStreamed(received, batch);
+    well_formed = streamed.has_value();
+    if (well_formed) received.remove_prefix(*streamed);
+  }
+  if (well_formed) {
+    buffered.Append(received, recv_pool_);
+    well_formed = conn.parser.Parse(buffered, recv_pool_, batch);
+  }
+  if (!well_formed || batch.Empty()) {
+    ReleaseBatch(std::move(batch));
+    return well_formed;  // malformed framing: the caller drops the client
+  }
+  commands_parsed_.fetch_add(batch.Size(), std::memory_order_relaxed);
+  conn.recent_commands += batch.Size();
+  RouteRequests(conn, std::move(batch));
+  return true;
+}
 
-  epoll_event ev{};
-  ev.events = EPOLLIN;
-  ev.data.fd = client_fd;
-  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, client_fd, &ev);
+std::size_t IoThread::LinkFor(const RespFrame& frame) const {
+  if (frame.command == RespFrame::kUnresolved ||
+      StatelessDispatcher::Handles(frame)) {
+    return kAnsweredHere;
+  }
+  const bool keyless = kCommandTable[frame.command].first_key == 0;
+  if (dispatcher_ != nullptr && !keyless) return kAnsweredHere;
+  const std::size_t executors = links_.size() - 1;
+  if (executors == 0 || keyless) return kMainLink;
+  return kMainLink + 1 + ExecutorForKey(frame.key_hash, executors);
 }
 
-void IoThread::HandleWriteResponse(const WriteResponse& response) {
-  const auto it = connections_.find(response.fd);
-  if (it == connections_.end()) return;  // client already disconnected
-  Connection& conn = it->second;
-  conn.out_buffer.append(response.bytes);
-  FlushOutBuffer(conn);
+std::size_t IoThread::RouteFor(const RespFrame& frame, bool& behind) const {
+  const std::size_t link = LinkFor(frame);
+  if (link == kAnsweredHere) return link;
+  if (!behind && link < read_stores_.size() && read_stores_[link] != nullptr &&
+      ReadDispatcher::Handles(frame)) {
+    return kAnsweredHere;
+  }
+  behind = true;
+  return link;
 }
 
-void IoThread::HandleReadable(int client_fd) {
-  const auto it = connections_.find(client_fd);
-  if (it == connections_.end()) return;
-  Connection& conn = it->second;
+void IoThread::RouteRequests(Connection& conn, RespFrames requests) {
+  std::size_t first_link = kAnsweredHere;
+  bool one_link = true;
+  bool behind = conn.batches_executing > 0;
+  for (RespFrame& frame : requests.frames) {
+    ResolveCommand(requests, frame);
+    const std::size_t link = RouteFor(frame, behind);
+    if (&frame == &requests.frames.front()) first_link = link;
+    one_link &= link == first_link;
+  }
+  if (one_link && first_link != kAnsweredHere) {
+    EmitBatch(conn, first_link, std::move(requests));
+    return;
+  }
+  std::uint64_t processed = 0;
+  if (one_link) {
+    std::string bytes = AcquireReplyBuffer();
+    ReplyBuilder reply(bytes);
+    for (std::size_t i = 0; i < requests.Size(); ++i) {
+      processed += AnswerHere(requests, i, reply) ? 1 : 0;
+    }
+    QueueLocalReply(conn, std::move(bytes));
+    ReleaseBatch(std::move(requests));
+    commands_processed_.fetch_add(processed, std::memory_order_relaxed);
+    return;
+  }
 
-  const bool alive = ReadIntoParseQueue(conn);
+  // Runs of requests for one thread each, and of replies written here. The
+  // requests are copied over as they are, views and all, and keep holding
+  // the receive blocks they view.
+  struct Piece {
+    std::size_t link;
+    RespFrames requests{};  // unless answered here
+    std::string reply{};    // if answered here
+  };
+  std::vector<Piece> pieces;
+  behind = conn.batches_executing > 0;
+  for (std::size_t i = 0; i < requests.Size(); ++i) {
+    const RespFrame& frame = requests.frames[i];
+    const std::size_t link = RouteFor(frame, behind);
+    if (pieces.empty() || pieces.back().link != link) {
+      Piece& piece = pieces.emplace_back(Piece{.link = link});
+      if (link == kAnsweredHere) {
+        piece.reply = AcquireReplyBuffer();
+      } else {
+        piece.requests = AcquireBatch();
+        piece.requests.blocks = requests.blocks;
+      }
+    }
+    Piece& piece = pieces.back();
+    if (link == kAnsweredHere) {
+      ReplyBuilder reply(piece.reply);
+      processed += AnswerHere(requests, i, reply) ? 1 : 0;
+      continue;
+    }
+    RespFrames& segment = piece.requests;
+    RespFrame& copy = segment.frames.emplace_back(frame);
+    copy.first_arg = static_cast<std::uint32_t>(segment.args.size());
+    const auto first = requests.args.begin() + frame.first_arg;
+    segment.args.insert(segment.args.end(), first, first + frame.arg_count);
+  }
+  // Arguments copied into `owned` go with the segment that views them, as the
+  // segments may be executed at the same time and answered in any order.
+  // Only now that `pieces` no longer grows: it copies, not moves, a
+  // RespFrames.
+  for (Piece& piece : pieces) {
+    if (requests.owned.empty()) break;
+    for (RespArg& arg : piece.requests.args) {
+      if (!arg.has_value()) continue;
+      for (std::string& owned : requests.owned) {
+        if (owned.data() == arg->data() && owned.size() == arg->size()) {
+          arg = piece.requests.owned.emplace_back(std::move(owned));
+          break;
+        }
+      }
+    }
+  }
+  for (Piece& piece : pieces) {
+    if (piece.link == kAnsweredHere) {
+      QueueLocalReply(conn, std::move(piece.reply));
+    } else {
+      EmitBatch(conn, piece.link, std::move(piece.requests));
+    }
+  }
+  ReleaseBatch(std::move(requests));
+  commands_processed_.fetch_add(processed, std::memory_order_relaxed);
+}
 
-  // Parsing (and any std::invalid_argument for malformed RESP framing) happens
-  // in PopValue, inside EmitParsedCommands.
-  bool well_formed = true;
-  try {
-    EmitParsedCommands(conn);
-  } catch (const std::invalid_argument&) {
-    well_formed = false;  // drop the connection on a protocol error
+bool IoThread::AnswerHere(RespFrames& requests, const std::size_t index,
+                          ReplyBuilder& reply) {
+  const RespFrame& frame = requests.frames[index];
+  if (frame.command == RespFrame::kUnresolved) {
+    reply.Error(kUnknownCommandError);
+    return false;
+  }
+  Command command = CommandAt(requests, index);
+  if (StatelessDispatcher::Handles(frame)) {
+    stateless_.Dispatch(command, reply);
+  } else if (dispatcher_ != nullptr) {
+    dispatcher_->Dispatch(command, reply);
+  } else {
+    reads_.Dispatch(*read_stores_[LinkFor(frame)], command, reply);
+  }
+  return true;
+}
+
+void IoThread::EmitBatch(Connection& conn, const std::size_t link,
+                         RespFrames requests) {
+  std::vector<DeferredBulk> deferred;
+  if (!deferred_pool_.empty()) {
+    deferred = std::move(deferred_pool_.back());
+    deferred_pool_.pop_back();
   }
+  ++conn.batches_executing;
+  Emit(CommandBatch{.fd = conn.fd,
+                    .client_id = conn.id,
+                    .seq = conn.replies_issued++,
+                    .requests = std::move(requests),
+                    .reply = AcquireReplyBuffer(),
+                    .deferred = std::move(deferred)},
+       link);
+}
+
+void IoThread::QueueLocalReply(Connection& conn, std::string bytes) {
+  const std::size_t place = conn.replies_issued++ - conn.replies_written;
+  if (conn.early_replies.size() <= place) conn.early_replies.resize(place + 1);
+  conn.early_replies[place] = std::move(bytes);
+  // Written from DrainInbox rather than here, in the middle of the engine's
+  // read handling. If it has to wait, DeliverReply writes it instead.
+  if (place == 0) local_ready_.push_back(conn.fd);
+}
 
-  if (!alive || !well_formed) CloseConnection(client_fd, /*notify_main=*/true);
+void IoThread::DeliverReply(WriteResponse& response) {
+  if (!response.deferred.empty()) EncodeDeferred(response);
+  ReleaseBatch(std::move(response.spent_requests));
+  const auto iter = connections_.find(response.fd);
+  // A reply meant for an earlier client with this fd number is dropped.
+  if (iter == connections_.end() || iter->second.id != response.client_id) {
+    ReleaseReplyBuffer(std::move(response.bytes));
+    return;
+  }
+  Connection& conn = iter->second;
+  --conn.batches_executing;
+  const std::size_t place = response.seq - conn.replies_written;
+  if (place > 0) {
+    if (conn.early_replies.size() <= place) {
+      conn.early_replies.resize(place + 1);
+    }
+    conn.early_replies[place] = std::move(response.bytes);
+    return;
+  }
+  ++conn.replies_written;
+  if (!conn.early_replies.empty()) conn.early_replies.pop_front();
+  HandleWriteResponse(response);
+  FlushEarlyReplies(response.fd);
 }
 
-bool IoThread::ReadIntoParseQueue(Connection& conn) {
-  std::array<char, kReadBufSize> buf{};
-  ssize_t n = recv(conn.fd, buf.data(), buf.size(), MSG_DONTWAIT);
-  while (n > 0) {
-    conn.parse_queue.PushString(
-        std::string(buf.data(), static_cast<std::size_t>(n)));
-    n = recv(conn.fd, buf.data(), buf.size(), MSG_DONTWAIT);
+void IoThread::FlushEarlyReplies(const int client_fd) {
+  // Looked up afresh every time, since a write may close the client.
+  while (true) {
+    const auto iter = connections_.find(client_fd);
+    if (iter == connections_.end()) return;
+    Connection& conn = iter->second;
+    if (conn.early_replies.empty() || !conn.early_replies.front()) return;
+    WriteResponse response{.fd = client_fd,
+                           .bytes = std::move(*conn.early_replies.front())};
+    conn.early_replies.pop_front();
+    ++conn.replies_written;
+    HandleWriteResponse(response);
   }
+}
 
-  if (n == 0) return false;  // peer performed an orderly shutdown
-  // n < 0: drained (still alive) for would-block/interrupt, otherwise fatal.
-  return WouldBlockOrInterrupted(n);
+RespFrames IoThread::AcquireBatch() {
+  if (batch_pool_.empty()) return {};
+  RespFrames batch = std::move(batch_pool_.back());
+  batch_pool_.pop_back();
+  return batch;
 }
 
-void IoThread::EmitParsedCommands(Connection& conn) {
-  // Coalesce every request drained from this read into a single outbox message
-  // so a pipelined batch costs one push + Notify, not one per command.
-  std::vector<RespValue> batch;
-  while (std::optional<RespValue> request = conn.parse_queue.PopValue()) {
-    batch.push_back(std::move(*request));
+void IoThread::ReleaseBatch(RespFrames batch) {
+  for (RecvBlock& block : batch.blocks) recv_pool_.Release(std::move(block));
+  batch.blocks.clear();
+  if (batch.frames.capacity() == 0 ||
+      batch.frames.capacity() > kMaxPooledBatch ||
+      batch.args.capacity() > kMaxPooledArgs ||
+      batch_pool_.size() >= kMaxPooled) {
+    return;
   }
-  if (!batch.empty()) Emit(CommandBatch{conn.fd, std::move(batch)});
+  batch.frames.clear();
+  batch.args.clear();
+  batch.owned.clear();
+  batch_pool_.push_back(std::move(batch));
 }
 
-void IoThread::HandleWritable(int client_fd) {
-  const auto it = connections_.find(client_fd);
-  if (it == connections_.end()) return;
-  FlushOutBuffer(it->second);
+void IoThread::EncodeDeferred(WriteResponse& response) {
+  std::string encoded = AcquireReplyBuffer();
+  myredis::EncodeDeferred(response.bytes, response.deferred, encoded);
+  ReleaseReplyBuffer(std::exchange(response.bytes, std::move(encoded)));
+  response.deferred.clear();
+  if (response.deferred.capacity() <= kMaxPooledBatch &&
+      deferred_pool_.size() < kMaxPooled) {
+    deferred_pool_.push_back(std::move(response.deferred));
+  }
 }
 
-void IoThread::FlushOutBuffer(Connection& conn) {
-  // Write as much of out_buffer as the socket will currently accept, tracking
-  // exactly how many bytes were consumed so the remainder can be retried on
-  // EPOLLOUT. (SendAll is unsuitable here: it cannot report partial progress
-  // when a non-blocking send would block.)
-  std::size_t sent = 0;
-  bool would_block = false;
-  while (sent < conn.out_buffer.size() && !would_block) {
-    const ssize_t n = send(conn.fd, conn.out_buffer.data() + sent,
-                           conn.out_buffer.size() - sent,
-                           MSG_NOSIGNAL | MSG_DONTWAIT);
-    if (n > 0) {
-      sent += static_cast<std::size_t>(n);
-    } else if (WouldBlockOrInterrupted(n)) {
-      would_block = true;
-    } else {
-      conn.out_buffer.clear();
-      CloseConnection(conn.fd, /*notify_main=*/true);  // fatal write error
-      return;
-    }
+std::string IoThread::AcquireReplyBuffer() {
+  if (reply_pool_.empty()) return {};
+  std::string buffer = std::move(reply_pool_.back());
+  reply_pool_.pop_back();
+  return buffer;
+}
+
+void IoThread::ReleaseReplyBuffer(std::string buffer) {
+  // Strings within the small-string capacity own no heap memory.
+  if (buffer.capacity() <= std::string().capacity() ||
+      buffer.capacity() > kMaxPooledReply ||
+      reply_pool_.size() >= kMaxPooled) {
+    return;
   }
+  buffer.clear();
+  reply_pool_.push_back(std::move(buffer));
+}
 
-  conn.out_buffer.erase(0, sent);
-  // Subscribe to EPOLLOUT only while bytes remain to be flushed.
-  UpdateEpoll(conn.fd, /*writable=*/!conn.out_buffer.empty());
+void IoThread::EmitDetached(Connection connection) {
+  Emit(ConnectionDetached{std::move(connection)});
 }
 
-void IoThread::CloseConnection(int client_fd, bool notify_main) {
-  const auto it = connections_.find(client_fd);
-  if (it == connections_.end()) return;
-  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, client_fd, nullptr);
-  close(client_fd);
-  connections_.erase(it);
-  if (notify_main) Emit(Disconnect{client_fd});
+void IoThread::Emit(OutboxMsg&& msg, const std::size_t link) {
+  Link& to = *links_[link];
+  // As in Post, `msg` survives a failed Push to go on the overflow list.
+  if (to.overflow.empty() && to.outbox.Push(std::move(msg))) {
+    to.peer_ready.Mark(index_);
+    return;
+  }
+  outbox_overflows_.fetch_add(1, std::memory_order_relaxed);
+  to.overflow.push_back(std::move(msg));
+  // Newly blocked: FlushOverflow arranges to be woken once there is room.
+  // Otherwise we are already waiting and DrainInbox will flush.
+  if (to.overflow.size() == 1) {
+    ++blocked_links_;
+    FlushOverflow(to);
+  }
+  to.peer_ready.Mark(index_);
 }
 
-void IoThread::Emit(const OutboxMsg& msg) {
-  // outbox_ is fixed-capacity. A failed Push consumes its argument, so we copy
-  // `msg` on each attempt to preserve it for retry. The common (uncontended)
-  // path performs one copy and one Notify.
-  // TODO(v2): proper backpressure (pause EPOLLIN on our connections while the
-  // queue is full) and avoid the per-message copy.
-  while (!outbox_.Push(msg)) {
-    command_event_.Notify();  // nudge the main thread to drain
-    std::this_thread::yield();
+bool IoThread::FlushOverflow(Link& link) {
+  std::deque<OutboxMsg>& overflow = link.overflow;
+  std::size_t flushed = link.outbox.PushBatch(overflow.begin(), overflow.end());
+  if (flushed < overflow.size()) {
+    // Full. Ask the peer to signal the inbox once it has emptied the outbox,
+    // then look once more in case it emptied it just before it could see the
+    // request (pairs with the fence in OnOutboxDrained).
+    link.awaiting_outbox_room.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    flushed +=
+        link.outbox.PushBatch(overflow.begin() + flushed, overflow.end());
   }
-  command_event_.Notify();
+  overflow.erase(overflow.begin(), overflow.begin() + flushed);
+  if (flushed > 0) link.peer_ready.Mark(index_);
+  if (!overflow.empty()) return false;
+  --blocked_links_;
+  return true;
 }
 
-void IoThread::UpdateEpoll(int client_fd, bool writable) const {
-  epoll_event ev{};
-  ev.events = EPOLLIN | (writable ? EPOLLOUT : 0);
-  ev.data.fd = client_fd;
-  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, client_fd, &ev);
+bool IoThread::CheckOutputBuffer(Connection& conn,
+                                 const std::size_t buffered_bytes) {
+  const OutputBufferLimits& limits = output_limits_;
+  if (limits.hard_bytes > 0 && buffered_bytes > limits.hard_bytes) {
+    return false;
+  }
+  if (limits.soft_bytes == 0 || buffered_bytes <= limits.soft_bytes) {
+    conn.throttled = false;
+    conn.over_soft_limit_since.reset();
+    return true;
+  }
+  const auto now = std::chrono::steady_clock::now();
+  if (!conn.over_soft_limit_since.has_value()) {
+    conn.over_soft_limit_since = now;
+  } else if (limits.soft_duration.count() > 0 &&
+             now - *conn.over_soft_limit_since > limits.soft_duration) {
+    return false;
+  }
+  conn.throttled = true;
+  return true;
+}
+
+std::vector<int> IoThread::TakeStalledClients() {
+  std::uint64_t expirations;
+  [[maybe_unused]] const ssize_t size =
+      read(soft_limit_timer_fd_, &expirations, sizeof(expirations));
+  std::vector<int> stalled;
+  const auto now = std::chrono::steady_clock::now();
+  for (const auto& [client_fd, conn] : connections_) {
+    if (conn.over_soft_limit_since.has_value() &&
+        now - *conn.over_soft_limit_since > output_limits_.soft_duration) {
+      stalled.push_back(client_fd);
+    }
+  }
+  return stalled;
 }
 
 }  // namespace myredis
@@ -2,96 +2,442 @@
 #define MYREDIS_SERVER_IO_THREAD_H_
 
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
-#include "concurrent/event_fd.h"
+#include "concurrent/ready_set.h"
 #include "concurrent/single_consumer_producer_queue.h"
+#include "concurrent/waker.h"
+#include "network/recv_buffer.h"
 #include "server/connection.h"
+#include "resp_value/reply_builder.h"
+#include "server/handler/read_dispatcher.h"
+#include "server/handler/request_dispatcher.h"
+#include "server/handler/stateless_dispatcher.h"
 #include "server/messages.h"
+#include "store/store.h"
 
 namespace myredis {
 
-// One IO thread of the server. It owns a set of client connections and does
-// only socket IO and RESP parsing: it reads bytes, parses them into RESP
-// requests that it hands to the main thread, and writes back the response
-// bytes the main thread produces. Command execution happens on the main thread.
+// The event-notification mechanism an IoThread drives its sockets with.
+enum class IoEngine : std::uint8_t {
+  kEpoll,    // readiness: epoll_wait, then recv/send syscalls per socket
+  kIoUring,  // completion: multishot recv into provided buffers, linked sends
+};
+
+// Per-client caps on replies buffered but not yet written, in the manner of
+// Redis' client-output-buffer-limit. A limit of 0 is disabled.
+struct OutputBufferLimits {
+  // Going over this closes the client at once.
+  std::size_t hard_bytes = 0;
+  // Over this the client is throttled (no more of its requests are read), and
+  // closed if it stays over for longer than `soft_duration` (when non-zero).
+  std::size_t soft_bytes = 0;
+  std::chrono::seconds soft_duration{0};
+};
+
+// Cumulative work counters of one IoThread, plus its current outbox depth.
+// Sampled by the main thread to place and rebalance clients.
+struct IoThreadLoad {
+  std::uint64_t bytes_read = 0;
+  std::uint64_t commands_parsed = 0;
+  std::size_t outbox_depth = 0;
+};
+
+// How often the queues between one IoThread and the main thread ran full, and
+// how much work the IoThread saved the main thread.
+struct IoThreadStats {
+  // Messages to this thread that found its inbox from the main thread (or
+  // an executor) full and waited in that thread's backlog instead.
+  std::uint64_t inbox_overflows = 0;
+  // IO -> main messages that found the outbox full and waited in this
+  // thread's overflow list instead.
+  std::uint64_t outbox_overflows = 0;
+  // Main -> IO messages waiting in the main thread's backlog right now.
+  std::size_t inbox_backlog = 0;
+  // Commands this thread executed itself.
+  std::uint64_t commands_processed = 0;
+};
+
+// One IO thread of the server. It owns a set of client connections: it reads
+// their bytes, parses them into RESP requests and writes back the replies.
+// Where each request is executed depends on the mode:
+//   - by default, the main thread executes it and sends the reply back;
+//   - with executors (see Executor), one on a key goes to the executor that
+//     owns the key, which replies to this thread directly;
+//   - with a read-concurrent store (see SetReadStore), a read is answered
+//     here unless the client still has earlier requests executing;
+//   - with a striped store (see SetExecutionStore), every command on a key is
+//     executed here.
+// Stateless commands (see StatelessDispatcher) and requests for no command at
+// all are always answered here.
+//
+// Clients are assigned by the main thread. A thread given a listen socket of
+// its own (SO_REUSEPORT sharding) accepts its clients directly instead.
+//
+// This base class owns everything that is independent of how the sockets are
+// driven (the main <-> IO queues, per-client parse state, batching of parsed
+// requests); EpollIoThread and UringIoThread supply the event loop.
 //
-// Concurrency contract:
-//   - inbox_  is SPSC: the main thread is the sole producer (via PostAssign /
+// This thread exchanges messages with each of its peers (the main thread, and
+// every executor) over a Link of its own, a pair of queues. Concurrency
+// contract, for each link:
+//   - the inbox is SPSC: the peer is the sole producer (via PostAssign /
 //     PostResponse), this IO thread is the sole consumer.
-//   - outbox_ is SPSC: this IO thread is the sole producer, the main thread is
-//     the sole consumer (via GetOutboxMsg).
-//   - command_event (owned by the server, shared by all IO threads) is signalled
-//     after pushing to outbox_ to wake the main thread.
+//   - the outbox is SPSC: this IO thread is the sole producer, the peer is the
+//     sole consumer (via DrainOutbox).
+//   - the peer's ReadySet (shared by all IO threads) has this thread's index
+//     marked after pushing to the outbox, waking the peer and telling it
+//     which outboxes to look at.
+//
+// Backpressure: when an outbox is full, outgoing messages wait (in order) in
+// a local overflow list and the thread stops reading from any client it would
+// otherwise parse more requests from. Once the peer has emptied the outbox it
+// signals the inbox, the overflow is flushed and reads resume. The other way
+// round, a peer never waits on a full inbox either: its messages queue in a
+// backlog (see FlushBacklog) that it flushes once this thread has drained the
+// inbox and marked itself in the peer's ReadySet.
 class IoThread {
  public:
   static constexpr std::size_t kQueueCapacity = 1024;
+  // The link to the main thread; executor i's is kMainLink + 1 + i.
+  static constexpr std::size_t kMainLink = 0;
 
-  // `command_event` is the main thread's wakeup; it is signalled whenever this
-  // thread enqueues an OutboxMsg. It must outlive this IoThread.
-  explicit IoThread(const EventFd& command_event);
-  ~IoThread();
+  // `main_ready` is the main thread's wakeup; this thread marks `index` in it
+  // whenever it has something for the main thread. It must outlive this
+  // IoThread. `listen_fd`, if not -1, is a non-blocking listen socket this
+  // thread takes ownership of and accepts its own clients from.
+  IoThread(ReadySet& main_ready, std::size_t index, int listen_fd,
+           OutputBufferLimits output_limits);
+  // Derived engines must call Stop() in their own destructor, so the worker
+  // thread is joined before the engine state it runs on is destroyed.
+  virtual ~IoThread();
 
   IoThread(const IoThread&) = delete;
   IoThread& operator=(const IoThread&) = delete;
 
-  // Spawn the worker thread running the epoll loop.
+  // Adds a link to another executor, which marks this thread's index in
+  // `ready` (which must outlive this IoThread) to look at its outbox.
+  // Requests on keys are then spread over the executors by hash slot (see
+  // ExecutorForKey), in the order added. Returns the link's number. Only
+  // before Start.
+  std::size_t AddExecutorLink(ReadySet& ready);
+
+  // Lets this thread answer the read-only commands (see ReadDispatcher) on
+  // the keys the peer at the other end of `link` executes itself, from
+  // `store`: that peer's, read-concurrent with a reader number for every IO
+  // thread (its index), and outliving this IoThread. Only before Start.
+  void SetReadStore(std::size_t link, const Store& store);
+
+  // Lets this thread execute every command on a key itself, on the store
+  // `store` holds: a striped one (see StoreConcurrency), which other threads
+  // execute on at the same time, and which must outlive this IoThread. Only
+  // before Start.
+  void SetExecutionStore(const std::unique_ptr<Store>& store);
+
+  // Spawn the worker thread running the engine's event loop.
   void Start();
   // Signal the worker to stop and join it.
   void Stop();
 
+  // --- Called from the peer at the other end of `link` only ----------------
+
+  // Hand the response to a CommandBatch to this thread, which owns its client,
+  // along with the spent requests of the batch (if any) for this thread to
+  // recycle, and any replies left for this thread to encode.
+  void PostResponse(WriteResponse response, std::size_t link = kMainLink);
+
+  // Moves backlogged messages into the inbox as far as they fit. Called when
+  // this thread is drained from the peer's ReadySet; cheap when there is no
+  // backlog.
+  void FlushBacklog(std::size_t link = kMainLink);
+
+  // Calls `visit(OutboxMsg&)` on every pending IO -> peer message, in order,
+  // a whole batch at a time, until the outbox is empty. The peer (the sole
+  // consumer) calls this when its ReadySet reports this thread. Emptying the
+  // outbox wakes this thread if it was waiting for room.
+  template <typename Visit>
+  void DrainOutbox(Visit&& visit, const std::size_t link = kMainLink) {
+    Link& drained = *links_[link];
+    while (drained.outbox.PopBatch(visit) > 0) {
+    }
+    OnOutboxDrained(drained);
+  }
+
   // --- Called from the main thread only -------------------------------------
 
   // Hand a freshly accepted client fd to this thread.
   void PostAssign(int client_fd);
-  // Hand response bytes destined for `client_fd` (owned by this thread).
-  void PostResponse(int client_fd, std::string bytes);
+  // Ask this thread to give up `client_fd`; it answers with a
+  // ConnectionDetached (or a Disconnect if the client went away first).
+  void PostMigrate(int client_fd);
+  // Hand over a client detached from another IO thread.
+  void PostAdopt(Connection connection);
+  // Ask this thread for a ClientLoads.
+  void PostSampleClientLoads();
 
-  // Pop the next IO -> main message, or std::nullopt if none are pending. The
-  // main thread (the sole consumer) calls this in a loop when command_event
-  // fires.
-  std::optional<OutboxMsg> GetOutboxMsg() { return outbox_.Pop(); }
+  // Momentary snapshot of this thread's load. Safe to call from any thread.
+  [[nodiscard]] IoThreadLoad Load() const;
+  // Overflow and command counters. Main thread only.
+  [[nodiscard]] IoThreadStats Stats() const;
 
- private:
-  void Run();
+ protected:
+  // The engine's event loop. Runs on the worker thread until IsRunning()
+  // turns false; Stop() notifies InboxWaker() to wake it. Engines follow the
+  // Waker protocol through PrepareToPark/FinishPark, call DrainInbox on every
+  // pass of the loop, and InboxWaker().Drain() when its fd is readable.
+  virtual void Run() = 0;
 
-  // Inbox handling (main -> this thread).
+  // Inbox handlers, called from DrainInbox on the worker thread.
+  virtual void HandleAssign(int client_fd) = 0;
+  virtual void HandleWriteResponse(WriteResponse& response) = 0;
+  // Stops serving the client and eventually calls EmitDetached with its state.
+  virtual void HandleMigrate(int client_fd) = 0;
+  virtual void HandleAdopt(Connection& connection) = 0;
+  // Called once the outbox has room again: start reading from every client
+  // the engine stopped reading while it was full (unless still throttled).
+  virtual void ResumeReads() = 0;
+
+  // Flushes any outbox overflow, then pops and dispatches every pending
+  // message from each peer.
   void DrainInbox();
-  void HandleAssign(int client_fd);
-  void HandleWriteResponse(const WriteResponse& response);
-
-  // Client socket handling.
-  void HandleReadable(int client_fd);
-  void HandleWritable(int client_fd);
-  // Reads until the socket would block. Returns false if the connection should
-  // be closed (peer shutdown or fatal error), true if it is still alive.
-  bool ReadIntoParseQueue(Connection& conn);
-  // Hands every fully-parsed request drained from one read to the main thread
-  // as a single coalesced CommandBatch.
-  void EmitParsedCommands(Connection& conn);
-  // Writes as much of conn.out_buffer as the socket accepts, then (de)registers
-  // EPOLLOUT for whatever remains.
-  void FlushOutBuffer(Connection& conn);
-
-  void CloseConnection(int client_fd, bool notify_main);
-  // Push to outbox_ and wake the main thread (spin-retries if outbox_ is full).
-  void Emit(const OutboxMsg& msg);
-  // Set epoll interest for a client fd: EPOLLIN, plus EPOLLOUT iff `writable`.
-  void UpdateEpoll(int client_fd, bool writable) const;
-
-  int epoll_fd_ = -1;
-  EventFd inbox_event_;           // main -> this thread wakeup
-  const EventFd& command_event_;  // this thread -> main wakeup (server-owned)
-
-  SingleConsumerProducerQueue<InboxMsg, kQueueCapacity> inbox_;
-  SingleConsumerProducerQueue<OutboxMsg, kQueueCapacity> outbox_;
 
+  // Takes on clients accepted from ListenFd(): registers all of them with the
+  // main thread in a single ConnectionsAccepted, then HandleAssigns each.
+  void RegisterAccepted(const std::vector<int>& client_fds);
+
+  // Parses the requests in conn.recv_buffer in place and hands every complete
+  // one to the main thread as a single coalesced CommandBatch (see
+  // RouteRequests). `received` is
+  // optional extra input in memory the engine must reclaim right away (an
+  // io_uring provided buffer): since the requests go on pointing into the
+  // memory they were parsed from, it is copied into conn.recv_buffer first,
+  // unless it is the payload of a large bulk string, which goes straight into
+  // its value. Returns false on a protocol error (malformed RESP framing), in
+  // which case the caller should close the connection.
+  bool EmitParsedCommands(Connection& conn, std::string_view received = {});
+
+  // Hands a migrating client's state back to the main thread.
+  void EmitDetached(Connection connection);
+
+  // A reply buffer from this thread's pool (empty, possibly with capacity),
+  // and a way to hand one back once its bytes have been written. Buffers go
+  // out in every CommandBatch and return in the WriteResponse, so in steady
+  // state neither reply buffers nor request batches are allocated or freed.
+  std::string AcquireReplyBuffer();
+  void ReleaseReplyBuffer(std::string buffer);
+  // ReleaseReplyBuffer as the recycle callback OutputBuffer takes.
+  [[nodiscard]] auto Recycler() {
+    return [this](std::string&& buffer) {
+      ReleaseReplyBuffer(std::move(buffer));
+    };
+  }
+
+  // Push to the outbox of `link` and wake its peer. If the outbox is full the
+  // message waits in the link's overflow list and OutboxBlocked() turns true
+  // until the peer has caught up.
+  void Emit(OutboxMsg&& msg, std::size_t link = kMainLink);
+
+  // True while messages are waiting for room in an outbox. Engines stop
+  // reading (lazily, as each client next becomes readable) for as long as it
+  // holds.
+  [[nodiscard]] bool OutboxBlocked() const { return blocked_links_ != 0; }
+  // Whether the engine should read more requests from `conn` right now.
+  [[nodiscard]] bool ReadsPaused(const Connection& conn) const {
+    return conn.throttled || OutboxBlocked();
+  }
+
+  // Checks a client's unwritten reply bytes against the output-buffer limits,
+  // updating conn.throttled. Returns false if the client must be closed.
+  bool CheckOutputBuffer(Connection& conn, std::size_t buffered_bytes);
+
+  // CheckOutputBuffer only runs when a client's replies are written to, so a
+  // client that stops reading altogether would stay over the soft limit for
+  // good. Engines therefore watch this timer (-1 unless the soft limit has a
+  // duration), which fires every kSoftLimitCheckInterval, and close the
+  // clients TakeStalledClients then returns.
+  [[nodiscard]] int SoftLimitTimerFd() const { return soft_limit_timer_fd_; }
+  // Resets SoftLimitTimerFd and returns the clients that have been over the
+  // soft limit for longer than its duration.
+  std::vector<int> TakeStalledClients();
+
+  // Where engines recv() into conn.recv_buffer from.
+  RecvBufferPool& RecvPool() { return recv_pool_; }
+
+  // Counts bytes received from clients towards Load().
+  void RecordBytesRead(const std::size_t bytes) {
+    bytes_read_.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] bool IsRunning() const {
+    return running_.load(std::memory_order_relaxed);
+  }
+  [[nodiscard]] const Waker& InboxWaker() const { return inbox_waker_; }
+
+  // Spins briefly for inbox work, then parks; see Waker::PrepareToPark.
+  // `engine_has_work` reports work the engine can see without blocking (e.g.
+  // completions already in its queue). Returns true if the engine must now
+  // block until one of its events (the inbox wakeup among them) fires, and
+  // then call FinishPark.
+  template <typename EngineHasWork>
+  bool PrepareToPark(const EngineHasWork& engine_has_work) {
+    return inbox_waker_.PrepareToPark([&] {
+      return HasInboxWork() || engine_has_work();
+    });
+  }
+  bool PrepareToPark() {
+    return PrepareToPark([] { return false; });
+  }
+  void FinishPark() { inbox_waker_.Unpark(); }
+  // This thread's own listen socket, or -1 if the main thread accepts for it.
+  [[nodiscard]] int ListenFd() const { return listen_fd_; }
+
+  // Per-client state for every connection this thread owns, keyed by fd.
   std::unordered_map<int, Connection> connections_;
+
+ private:
+  Waker inbox_waker_;  // peers -> this thread wakeup
+  const std::size_t index_;
+  int listen_fd_ = -1;
+
+  // The queues between this thread and one peer, and the state of the
+  // backpressure on each side.
+  struct Link {
+    explicit Link(ReadySet& peer_ready) : peer_ready(peer_ready) {}
+
+    ReadySet& peer_ready;  // this thread -> peer wakeup
+    SingleConsumerProducerQueue<InboxMsg, kQueueCapacity> inbox;
+    SingleConsumerProducerQueue<OutboxMsg, kQueueCapacity> outbox;
+
+    // Messages the peer could not fit in the inbox, oldest first. Only the
+    // peer touches it.
+    std::deque<InboxMsg> backlog;
+    std::atomic<std::uint64_t> inbox_overflows{0};
+    // Set (by the peer) while `backlog` is non-empty; this thread clears it
+    // and marks itself in peer_ready once it has emptied the inbox.
+    std::atomic<bool> awaiting_inbox_room{false};
+
+    // Messages that found the outbox full, oldest first. Only this thread
+    // touches it; every Emit queues behind it while it is non-empty,
+    // preserving order.
+    std::deque<OutboxMsg> overflow;
+    // Set (by this thread) while `overflow` is non-empty; the peer clears it
+    // and signals the inbox once it has emptied the outbox.
+    std::atomic<bool> awaiting_outbox_room{false};
+  };
+  // By link number: the main thread's, then each executor's.
+  std::vector<std::unique_ptr<Link>> links_;
+  // Links whose overflow is non-empty.
+  std::size_t blocked_links_ = 0;
+
+  // Push to the inbox of `link` and wake this thread, or append to its
+  // backlog if the inbox is full (or already backlogged, to preserve order).
+  void Post(InboxMsg&& msg, Link& link);
+  void FlushBacklog(Link& link);
+
+  // Moves overflow into the outbox of `link` as far as it fits. Returns true
+  // if that emptied the overflow.
+  bool FlushOverflow(Link& link);
+
+  // Wakes this thread if it is waiting for room in the outbox of `link` (its
+  // peer only).
+  void OnOutboxDrained(Link& link);
+
+  // Whether DrainInbox has anything to do: messages in an inbox, room made in
+  // an outbox for a blocked thread, replies of our own due, or a Stop() to
+  // observe.
+  [[nodiscard]] bool HasInboxWork() const;
+
+  // Resolves every request in `requests` (see ResolveCommand) and hands them
+  // to the thread that executes them (see LinkFor), except those answered
+  // right here: stateless commands, and requests that do not resolve, with
+  // an error. A batch that is not all for one thread is split into runs that
+  // are, each run for another thread becoming a CommandBatch of its own, and
+  // the replies are written in request order all the same (see DeliverReply).
+  void RouteRequests(Connection& conn, RespFrames requests);
+  // The link to the thread that executes the resolved `frame`, or
+  // kAnsweredHere if this thread answers it.
+  [[nodiscard]] std::size_t LinkFor(const RespFrame& frame) const;
+  static constexpr std::size_t kAnsweredHere = SIZE_MAX;
+  // Executes `requests` request `index`, which LinkFor has this thread
+  // answer, writing its reply to `reply`. Returns whether it was a command
+  // executed (rather than an error for an unknown or malformed one).
+  bool AnswerHere(RespFrames& requests, std::size_t index,
+                  ReplyBuilder& reply);
+  // LinkFor, except that a read this thread can serve from a read store is
+  // answered here too, unless `behind`: the client has earlier requests
+  // executing elsewhere. Sets `behind` once a request goes elsewhere.
+  [[nodiscard]] std::size_t RouteFor(const RespFrame& frame,
+                                     bool& behind) const;
+  // Hands `requests` to the peer at the other end of `link` as one
+  // CommandBatch.
+  void EmitBatch(Connection& conn, std::size_t link, RespFrames requests);
+  // Numbers reply `bytes` produced on this thread, to be written to `conn` in
+  // its place (see DeliverReply).
+  void QueueLocalReply(Connection& conn, std::string bytes);
+  // Writes the response to one of its client's CommandBatches, if it is the
+  // reply due next; otherwise keeps it until it is.
+  void DeliverReply(WriteResponse& response);
+  // Writes the replies kept for `client_fd` that are now due.
+  void FlushEarlyReplies(int client_fd);
+  // Answers SampleClientLoads, resetting every client's count.
+  void EmitClientLoads();
+  // Clients that have replies kept that fell due outside DrainInbox.
+  std::vector<int> local_ready_;
+  // Executes the stateless commands in RouteRequests.
+  StatelessDispatcher stateless_;
+  // Executes the read-only commands in RouteRequests, on read_stores_.
+  ReadDispatcher reads_;
+  // By link number: the store reads for that peer are served from, if any.
+  std::vector<const Store*> read_stores_;
+  // Executes the commands on keys in RouteRequests, if SetExecutionStore.
+  std::unique_ptr<RequestDispatcher> dispatcher_;
+
+  const OutputBufferLimits output_limits_;
+  static constexpr std::chrono::milliseconds kSoftLimitCheckInterval{100};
+  int soft_limit_timer_fd_ = -1;
+
+  RecvBufferPool recv_pool_;
+
+  // Request batches for EmitParsedCommands, returned empty.
+  RespFrames AcquireBatch();
+  // Clears `batch` (releasing its receive blocks to recv_pool_ and freeing
+  // any strings it owns on the thread that parsed them) and pools it.
+  void ReleaseBatch(RespFrames batch);
+
+  // Encodes the replies the main thread deferred into response.bytes, doing
+  // the copying of large values here rather than on the main thread. Lets go
+  // of the values, and pools the emptied list for the next CommandBatch.
+  void EncodeDeferred(WriteResponse& response);
+
+  // Pools of containers recycled through the queues (see AcquireReplyBuffer).
+  // Only this thread touches them. Oversized containers are not kept, so one
+  // huge pipeline or reply does not pin its memory for good.
+  static constexpr std::size_t kMaxPooled = kQueueCapacity;
+  static constexpr std::size_t kMaxPooledBatch = 1024;       // requests
+  static constexpr std::size_t kMaxPooledArgs = 8 * 1024;    // arguments
+  static constexpr std::size_t kMaxPooledReply = 64 * 1024;  // bytes
+  std::vector<RespFrames> batch_pool_;
+  std::vector<std::string> reply_pool_;
+  std::vector<std::vector<DeferredBulk>> deferred_pool_;
+
   std::thread thread_;
   std::atomic<bool> running_{false};
+
+  // Written by this thread only; read by the main thread through Load().
+  std::atomic<std::uint64_t> bytes_read_{0};
+  std::atomic<std::uint64_t> commands_parsed_{0};
+  std::atomic<std::uint64_t> outbox_overflows_{0};
+  std::atomic<std::uint64_t> commands_processed_{0};
 };
 
 }  // namespace myredis
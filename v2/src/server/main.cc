@@ -1,4 +1,8 @@
+#include <chrono>
+#include <cstddef>
 #include <cxxopts.hpp>
+#include <iostream>
+#include <string>
 
 #include "server/server.h"
 
@@ -12,11 +16,100 @@ int main(const int argc, const char* argv[]) {
                         cxxopts::value<int>()->default_value("6379"));
   options.add_options()("s,snapshot", "Interval between snapshots",
                         cxxopts::value<int>()->default_value("0"));
+  options.add_options()("io-engine",
+                        "How IO threads drive sockets: epoll or io_uring",
+                        cxxopts::value<std::string>()->default_value("epoll"));
+  options.add_options()("io-threads",
+                        "Number of IO threads (0: one per core, less a core "
+                        "for each thread executing commands: the main thread, "
+                        "or else each of the executors)",
+                        cxxopts::value<int>()->default_value("0"));
+  options.add_options()("executors",
+                        "Number of command executors, each owning the keys in "
+                        "a range of hash slots (1: the main thread executes "
+                        "every command)",
+                        cxxopts::value<int>()->default_value("1"));
+  options.add_options()("backlog", "Accept queue length of the listen socket(s)",
+                        cxxopts::value<int>()->default_value("511"));
+  options.add_options()("reuseport",
+                        "Let each IO thread accept its own clients on an "
+                        "SO_REUSEPORT listen socket",
+                        cxxopts::value<bool>()->default_value("false"));
+  options.add_options()("rebalance-interval",
+                        "Milliseconds between IO thread load samples, each of "
+                        "which may migrate a client off the busiest thread "
+                        "(0 disables)",
+                        cxxopts::value<int>()->default_value("1000"));
+  options.add_options()("output-buffer-hard-limit",
+                        "Close a client whose unwritten replies exceed this "
+                        "many bytes (0 disables)",
+                        cxxopts::value<std::size_t>()->default_value("0"));
+  options.add_options()("output-buffer-soft-limit",
+                        "Stop reading from a client whose unwritten replies "
+                        "exceed this many bytes (0 disables)",
+                        cxxopts::value<std::size_t>()->default_value("0"));
+  options.add_options()("output-buffer-soft-seconds",
+                        "Close a client that stays over the soft limit this "
+                        "long (0: never)",
+                        cxxopts::value<int>()->default_value("0"));
+  options.add_options()("io-encode-replies",
+                        "Let IO threads, not the main thread, copy large "
+                        "values into replies",
+                        cxxopts::value<bool>()->default_value("false"));
+  options.add_options()("io-reads",
+                        "Let IO threads execute GET, TTL and PTTL themselves, "
+                        "reading the store concurrently with its writer",
+                        cxxopts::value<bool>()->default_value("false"));
+  options.add_options()("io-execute",
+                        "Let IO threads execute every command on a key "
+                        "themselves, on a shared lock-striped store "
+                        "(overrides --executors and --io-reads)",
+                        cxxopts::value<bool>()->default_value("false"));
+  options.add_options()("command-budget",
+                        "Commands a client's pipeline may run before the next "
+                        "client with commands queued gets a turn (0: no limit)",
+                        cxxopts::value<std::size_t>()->default_value("64"));
 
   const auto result = options.parse(argc, argv);
   const int port = result["port"].as<int>();
   const int snapshot_interval = result["snapshot"].as<int>();
+  const std::string io_engine_name = result["io-engine"].as<std::string>();
+  const int io_threads = result["io-threads"].as<int>();
+  const int executors = result["executors"].as<int>();
+  const int listen_backlog = result["backlog"].as<int>();
+  const bool reuse_port = result["reuseport"].as<bool>();
+  const int rebalance_interval = result["rebalance-interval"].as<int>();
+  const myredis::OutputBufferLimits output_buffer_limits{
+      .hard_bytes = result["output-buffer-hard-limit"].as<std::size_t>(),
+      .soft_bytes = result["output-buffer-soft-limit"].as<std::size_t>(),
+      .soft_duration = std::chrono::seconds(
+          result["output-buffer-soft-seconds"].as<int>())};
+  const bool io_encode_replies = result["io-encode-replies"].as<bool>();
+  const bool io_reads = result["io-reads"].as<bool>();
+  const bool io_execute = result["io-execute"].as<bool>();
+  const std::size_t command_budget = result["command-budget"].as<std::size_t>();
+
+  myredis::IoEngine io_engine = myredis::IoEngine::kEpoll;
+  if (io_engine_name == "io_uring") {
+    io_engine = myredis::IoEngine::kIoUring;
+  } else if (io_engine_name != "epoll") {
+    std::cerr << "Unknown --io-engine '" << io_engine_name
+              << "' (expected epoll or io_uring)\n";
+    return 1;
+  }
 
-  myredis::Server server({.port = port, .snapshot_interval_ms = snapshot_interval});
+  myredis::Server server({.port = port,
+                          .snapshot_interval_ms = snapshot_interval,
+                          .io_engine = io_engine,
+                          .io_threads = io_threads,
+                          .executors = executors,
+                          .listen_backlog = listen_backlog,
+                          .reuse_port = reuse_port,
+                          .rebalance_interval_ms = rebalance_interval,
+                          .output_buffer_limits = output_buffer_limits,
+                          .io_encode_replies = io_encode_replies,
+                          .io_reads = io_reads,
+                          .io_execute = io_execute,
+                          .command_budget = command_budget});
   return server.Run();
 }
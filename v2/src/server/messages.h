@@ -1,15 +1,22 @@
 #ifndef MYREDIS_SERVER_MESSAGES_H_
 #define MYREDIS_SERVER_MESSAGES_H_
 
+#include <cstdint>
 #include <string>
+#include <type_traits>
+#include <utility>
 #include <variant>
 #include <vector>
 
-#include "resp_value/resp_value.h"
+#include "resp_value/reply_builder.h"
+#include "resp_value/resp_frame.h"
+#include "server/connection.h"
 
 namespace myredis {
 
-// Messages flowing main -> IO thread (carried on the IO thread's `inbox_`).
+// Messages flowing main (or executor) -> IO thread, carried on the IO thread's
+// inbox from that thread (see IoThread). Executors only ever send
+// WriteResponse.
 
 // The main thread accepted a new client and assigned it to this IO thread,
 // which should take ownership of the fd (epoll ADD + create Connection state).
@@ -18,34 +25,102 @@ struct AssignConnection {
 };
 
 // The main thread produced a response for a client owned by this IO thread,
-// which should buffer and write `bytes` to `fd`.
+// which should buffer and write `bytes` to `fd`, once it has encoded the
+// `deferred` replies into them (see ReplyBuilder). `bytes` is the reply buffer
+// the IO thread lent out in the CommandBatch, and `spent_requests` that
+// batch's requests: both go back into the IO thread's pools, along with the
+// receive block the requests pinned. `client_id` and `seq` are the batch's
+// (see CommandBatch), for the IO thread to write it in its place.
 struct WriteResponse {
   int fd = -1;
-  std::string bytes;
+  std::uint64_t client_id = 0;
+  std::uint64_t seq = 0;
+  std::string bytes{};
+  RespFrames spent_requests{};
+  std::vector<DeferredBulk> deferred{};
 };
 
-using InboxMsg = std::variant<AssignConnection, WriteResponse>;
+// The main thread is moving this client to another IO thread. Stop reading
+// from it, let any sends already under way finish, then hand its state back in
+// a ConnectionDetached. Every WriteResponse for it was posted before this.
+struct MigrateConnection {
+  int fd = -1;
+};
+
+// A client migrated from another IO thread. `connection` carries its partially
+// parsed input and any replies not yet written, which go out first.
+struct AdoptConnection {
+  Connection connection;
+};
+
+// The main thread is sampling load: report how busy each client has been in a
+// ClientLoads.
+struct SampleClientLoads {};
+
+using InboxMsg = std::variant<AssignConnection, WriteResponse,
+                              MigrateConnection, AdoptConnection,
+                              SampleClientLoads>;
+// Messages cross between threads by moving exactly once: a copy of one
+// anywhere on the way (e.g. in Post) fails to compile rather than silently
+// deep-copying its payload. Connection being move-only makes the variant so.
+static_assert(!std::is_copy_constructible_v<InboxMsg>);
 
-// Messages flowing IO thread -> main thread (carried on the IO thread's
-// `outbox_`).
+// Messages flowing IO thread -> main thread (or executor), carried on the IO
+// thread's outbox to that thread. Executors only ever get CommandBatch.
 
 // A batch of fully-parsed RESP requests from a single client, all drained from
 // one read. The main thread executes them in order and returns one coalesced
 // response. Batching amortises the cross-thread handoff: a pipelined burst of N
 // commands costs one outbox push + wakeup instead of N (and one PostResponse
 // back instead of N), which is what makes single-connection pipelining fast.
+//
+// `requests` view the receive block they were parsed from, which they keep
+// alive. `reply` is an empty buffer, from the IO thread's pool, for the main
+// thread to build the response in, and `deferred` an empty list for any
+// replies it leaves the IO thread to encode. `client_id` (Connection::id) and
+// `seq`, the batch's place among the client's replies, go back in the
+// WriteResponse unchanged.
 struct CommandBatch {
   int fd = -1;
-  std::vector<RespValue> values;
+  std::uint64_t client_id = 0;
+  std::uint64_t seq = 0;
+  RespFrames requests{};
+  std::string reply{};
+  std::vector<DeferredBulk> deferred{};
 };
 
-// The client closed (or errored) and the IO thread has already closed the fd;
-// the main thread should drop its fd -> thread routing entry.
+// The client closed (or errored) and the IO thread has let go of the fd; the
+// main thread should drop its fd -> thread routing entry and then close it.
+// Closing on the main thread means accept() cannot hand out the same fd number
+// again while a stale routing entry for it still exists.
 struct Disconnect {
   int fd = -1;
 };
 
-using OutboxMsg = std::variant<CommandBatch, Disconnect>;
+// Clients this IO thread accepted on its own SO_REUSEPORT listen socket, all
+// from one drain of its accept queue. Sent before any CommandBatch from those
+// clients, so the main thread can record their fd -> thread routing in one go.
+struct ConnectionsAccepted {
+  std::vector<int> fds{};
+};
+
+// Reply to MigrateConnection: this thread has let go of the client. Every
+// CommandBatch it parsed from the client precedes this message.
+struct ConnectionDetached {
+  Connection connection;
+};
+
+// Reply to SampleClientLoads: the requests parsed from each client since the
+// last sample, for the clients that sent any, as (fd, count) pairs. Counted
+// here rather than where the requests execute, which may be anywhere.
+struct ClientLoads {
+  std::vector<std::pair<int, std::uint64_t>> commands{};
+};
+
+using OutboxMsg = std::variant<CommandBatch, Disconnect, ConnectionsAccepted,
+                               ConnectionDetached, ClientLoads>;
+// As for InboxMsg, e.g. in Emit.
+static_assert(!std::is_copy_constructible_v<OutboxMsg>);
 
 }  // namespace myredis
 
@@ -0,0 +1,106 @@
+#ifndef MYREDIS_SERVER_OUTPUT_BUFFER_H_
+#define MYREDIS_SERVER_OUTPUT_BUFFER_H_
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <utility>
+
+namespace myredis {
+
+// A client's unwritten reply bytes, kept as a queue of chunks rather than one
+// contiguous string. Reply buffers are appended by moving them in, so a large
+// reply is never copied; small ones are copied into the spare capacity of the
+// last chunk, so a burst of tiny replies does not become as many chunks.
+// Gather() exposes the bytes as an iovec array for a single writev/sendmsg.
+// Consume() drops written chunks whole and keeps an offset into the first,
+// so a partial write never moves the remainder.
+//
+// The storage of chunks that are no longer needed (written, or copied from) is
+// handed to a `recycle(std::string&&)` callback, which returns it to the
+// thread's reply-buffer pool.
+class OutputBuffer {
+ public:
+  // Replies up to this size are copied into the last chunk if it has room.
+  static constexpr std::size_t kCoalesceBytes = 512;
+
+  [[nodiscard]] bool Empty() const { return size_ == 0; }
+  // Unwritten bytes.
+  [[nodiscard]] std::size_t Size() const { return size_; }
+
+  template <typename Recycle>
+  void Append(std::string&& bytes, Recycle&& recycle) {
+    if (bytes.empty()) {
+      recycle(std::move(bytes));
+      return;
+    }
+    size_ += bytes.size();
+    if (!chunks_.empty() && bytes.size() <= kCoalesceBytes) {
+      std::string& last = chunks_.back();
+      if (last.capacity() - last.size() >= bytes.size()) {
+        last.append(bytes);
+        recycle(std::move(bytes));
+        return;
+      }
+    }
+    chunks_.push_back(std::move(bytes));
+  }
+
+  // Fills up to `max` iovecs with the unwritten bytes, in order, and returns
+  // how many it filled. They stay valid until the next Append or Consume.
+  std::size_t Gather(iovec* iov, const std::size_t max) const {
+    std::size_t count = 0;
+    for (auto it = chunks_.begin(); it != chunks_.end() && count < max;
+         ++it, ++count) {
+      const std::size_t skip = it == chunks_.begin() ? offset_ : 0;
+      iov[count].iov_base = const_cast<char*>(it->data()) + skip;
+      iov[count].iov_len = it->size() - skip;
+    }
+    return count;
+  }
+
+  // Marks the first `n` unwritten bytes as written.
+  template <typename Recycle>
+  void Consume(std::size_t n, Recycle&& recycle) {
+    size_ -= n;
+    while (n > 0) {
+      std::string& front = chunks_.front();
+      const std::size_t left = front.size() - offset_;
+      if (n < left) {
+        offset_ += n;
+        return;
+      }
+      n -= left;
+      offset_ = 0;
+      recycle(std::move(front));
+      chunks_.pop_front();
+    }
+  }
+
+  // Hands every unwritten chunk, in order, to `take(std::string&&)` and
+  // empties the buffer. Used when another send path takes over the bytes.
+  template <typename Take>
+  void TakeChunks(Take&& take) {
+    if (!chunks_.empty()) chunks_.front().erase(0, offset_);
+    for (std::string& chunk : chunks_) take(std::move(chunk));
+    Clear();
+  }
+
+  void Clear() {
+    chunks_.clear();
+    offset_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  std::deque<std::string> chunks_;
+  // Bytes of chunks_.front() already written.
+  std::size_t offset_ = 0;
+  std::size_t size_ = 0;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_SERVER_OUTPUT_BUFFER_H_
@@ -10,6 +10,7 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cerrno>
@@ -17,22 +18,35 @@
 #include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <thread>
 #include <utility>
 #include <variant>
 
+#include "network/io_uring.h"
+#include "server/epoll_io_thread.h"
+#include "server/hash_slot.h"
+#include "server/uring_io_thread.h"
 #include "time/timenow.h"
 
 namespace myredis {
 
 namespace {
 constexpr std::size_t kMaxEvents = 64;
-constexpr int kConnectionBacklog = 16;
 constexpr long millisecondsInSecond = 1000;
 constexpr long nanosecondsInMillisecond = 1000000;
 
+// Rebalancing weighs a thread's work as commands parsed, plus bytes read in
+// units of one read buffer (so a few huge values count too), plus whatever is
+// queued in its outbox. A thread is only relieved of a client once it does
+// more than kRebalanceRatio times the work of the idlest thread and at least
+// kMinRebalanceWork per interval, so a lightly loaded server never churns.
+constexpr std::uint64_t kBytesPerWorkUnit = 4096;
+constexpr std::uint64_t kRebalanceRatio = 2;
+constexpr std::uint64_t kMinRebalanceWork = 1024;
+
 // Directory snapshots are written to and restored from, and the prefix the
 // Snapshotter gives each file. Used to construct the Snapshotter; it owns the
 // restore logic from there.
@@ -40,8 +54,11 @@ constexpr const char* kSnapshotDir = ".";
 constexpr const char* kSnapshotPrefix = "dump-";
 
 // Creates a non-blocking TCP socket bound to `port` and listening on all
-// interfaces. Returns the fd, or -1 on failure (with a message on std::cerr).
-int CreateListenSocket(const int port) {
+// interfaces with an accept queue of `backlog`. With `reuse_port` several such
+// sockets can share the port, the kernel spreading new connections over them.
+// Returns the fd, or -1 on failure (with a message on std::cerr).
+int CreateListenSocket(const int port, const int backlog,
+                       const bool reuse_port) {
   const int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
   if (listen_fd < 0) {
     std::perror("socket");
@@ -50,6 +67,13 @@ int CreateListenSocket(const int port) {
 
   constexpr int enable = 1;
   setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  if (reuse_port &&
+      setsockopt(listen_fd, SOL_SOCKET, SO_REUSEPORT, &enable,
+                 sizeof(enable)) != 0) {
+    std::perror("setsockopt(SO_REUSEPORT)");
+    close(listen_fd);
+    return -1;
+  }
 
   const int flags = fcntl(listen_fd, F_GETFL, 0);
   fcntl(listen_fd, F_SETFL, flags | O_NONBLOCK);
@@ -64,7 +88,7 @@ int CreateListenSocket(const int port) {
     return -1;
   }
 
-  if (listen(listen_fd, kConnectionBacklog) != 0) {
+  if (listen(listen_fd, backlog) != 0) {
     std::perror("listen");
     close(listen_fd);
     return -1;
@@ -79,9 +103,11 @@ std::pair<long, long> ConvertMills(int mills) {
       (mills % millisecondsInSecond) * nanosecondsInMillisecond);
 }
 
-int CreateTimerIntervalFd(const int snapshot_interval) {
-  if (snapshot_interval <= 0) {
-    return snapshot_interval;
+// Returns a timerfd firing every `interval` milliseconds, or -1 if `interval`
+// is <= 0.
+int CreateTimerIntervalFd(const int interval) {
+  if (interval <= 0) {
+    return -1;
   }
 
   const int timer_fd =
@@ -91,7 +117,7 @@ int CreateTimerIntervalFd(const int snapshot_interval) {
     exit(1);
   }
 
-  const auto [seconds, nanoseconds] = ConvertMills(snapshot_interval);
+  const auto [seconds, nanoseconds] = ConvertMills(interval);
 
   itimerspec its{};
   its.it_value.tv_sec = seconds;
@@ -107,31 +133,113 @@ int CreateTimerIntervalFd(const int snapshot_interval) {
   return timer_fd;
 }
 
-unsigned NumIoThreads() {
-  // Reserve one core for the main (command-executing) thread.
+// Resolves the configured engine against what this kernel supports.
+IoEngine ResolveIoEngine(const IoEngine requested) {
+  if (requested == IoEngine::kIoUring && !IoUring::IsSupported()) {
+    std::cerr << "io_uring is unavailable on this kernel; using epoll\n";
+    return IoEngine::kEpoll;
+  }
+  return requested;
+}
+
+std::unique_ptr<IoThread> MakeIoThread(const IoEngine engine,
+                                       ReadySet& main_ready,
+                                       const std::size_t index,
+                                       const int listen_fd,
+                                       const OutputBufferLimits& limits) {
+  switch (engine) {
+    case IoEngine::kIoUring:
+      return std::make_unique<UringIoThread>(main_ready, index, listen_fd,
+                                             limits);
+    case IoEngine::kEpoll:
+      break;
+  }
+  return std::make_unique<EpollIoThread>(main_ready, index, listen_fd, limits);
+}
+
+unsigned NumExecutors(const ServerConfig& config) {
+  if (config.io_execute) return 1;
+  return config.executors > 1 ? static_cast<unsigned>(config.executors) : 1;
+}
+
+unsigned NumIoThreads(const int configured, const unsigned executors) {
+  if (configured > 0) return static_cast<unsigned>(configured);
+  // Reserve a core for each command-executing thread (the main thread, or
+  // the executors).
   const unsigned hardware = std::thread::hardware_concurrency();
-  return hardware > 1 ? hardware - 1 : 1;
+  return hardware > executors ? hardware - executors : 1;
+}
+
+// How the main thread's store is shared with the IO threads: striped if they
+// execute commands on it (ServerConfig::io_execute), read by every one of
+// them if they serve reads from it (ServerConfig::io_reads, unless executors
+// have stores of their own).
+StoreConcurrency MainStoreConcurrency(const ServerConfig& config) {
+  if (config.io_execute) return {.striped = true};
+  const unsigned executors = NumExecutors(config);
+  return {.readers = config.io_reads && executors <= 1
+                         ? NumIoThreads(config.io_threads, executors)
+                         : 0};
 }
 }  // namespace
 
 Server::Server(ServerConfig config)
-    : store_(std::make_unique<Store>(std::make_unique<TimeNow>())),
-      dispatcher_(store_),
+    : Server(config, NumIoThreads(config.io_threads, NumExecutors(config))) {}
+
+Server::Server(ServerConfig config, const unsigned num_io_threads)
+    : store_(std::make_unique<Store>(std::make_unique<TimeNow>(),
+                                     MainStoreConcurrency(config))),
+      dispatcher_(store_, [this] { return Stats(); }),
       snapshotter_(kSnapshotDir, kSnapshotPrefix),
+      io_encode_replies_(config.io_encode_replies),
       epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
-      listen_fd_(CreateListenSocket(config.port)),
-      snapshot_fd_(CreateTimerIntervalFd(config.snapshot_interval_ms)) {
-  const unsigned num_io_threads = NumIoThreads();
+      listen_fd_(config.reuse_port
+                     ? -1
+                     : CreateListenSocket(config.port, config.listen_backlog,
+                                          /*reuse_port=*/false)),
+      listening_(config.reuse_port || listen_fd_ >= 0),
+      snapshot_fd_(CreateTimerIntervalFd(config.snapshot_interval_ms)),
+      // Executors reply to the IO thread a request came from, so clients do
+      // not migrate while there are any.
+      rebalance_fd_(CreateTimerIntervalFd(
+          NumExecutors(config) > 1 ? 0 : config.rebalance_interval_ms)),
+      ready_threads_(num_io_threads),
+      scheduler_(config.command_budget, num_io_threads) {
+  const IoEngine io_engine = ResolveIoEngine(config.io_engine);
+  const unsigned num_executors = NumExecutors(config);
   io_threads_.reserve(num_io_threads);
   for (unsigned i = 0; i < num_io_threads; ++i) {
-    io_threads_.push_back(std::make_unique<IoThread>(command_event_));
+    int thread_listen_fd = -1;
+    if (config.reuse_port) {
+      thread_listen_fd = CreateListenSocket(
+          config.port, config.listen_backlog, /*reuse_port=*/true);
+      listening_ = listening_ && thread_listen_fd >= 0;
+    }
+    io_threads_.push_back(
+        MakeIoThread(io_engine, ready_threads_, i, thread_listen_fd,
+                     config.output_buffer_limits));
+    if (config.io_execute) {
+      io_threads_.back()->SetExecutionStore(store_);
+    } else if (MainStoreConcurrency(config).readers > 0) {
+      io_threads_.back()->SetReadStore(IoThread::kMainLink, *store_);
+    }
+  }
+  thread_loads_.resize(io_threads_.size());
+  if (num_executors > 1) {
+    executors_.reserve(num_executors);
+    for (unsigned i = 0; i < num_executors; ++i) {
+      executors_.push_back(std::make_unique<Executor>(
+          io_threads_, config.io_encode_replies, config.io_reads,
+          config.command_budget));
+    }
   }
 
-  if (epoll_fd_ < 0 || listen_fd_ < 0) return;
+  if (epoll_fd_ < 0 || !listening_) return;
 
-  // Watch the listen socket (new connections) and the command eventfd
-  // (IO threads have parsed requests to execute).
-  for (const int watched_fd : {listen_fd_, command_event_.Fd(), snapshot_fd_}) {
+  // Watch the listen socket (new connections), the ready set (IO threads have
+  // parsed requests to execute) and the snapshot and rebalance timers.
+  for (const int watched_fd :
+       {listen_fd_, ready_threads_.Fd(), snapshot_fd_, rebalance_fd_}) {
     if (watched_fd != -1) {
       epoll_event event{};
       event.events = EPOLLIN;
@@ -142,13 +250,14 @@ Server::Server(ServerConfig config)
 }
 
 Server::~Server() {
+  for (const auto& executor : executors_) executor->Stop();
   for (const auto& io_thread : io_threads_) io_thread->Stop();
   if (listen_fd_ >= 0) close(listen_fd_);
   if (epoll_fd_ >= 0) close(epoll_fd_);
 }
 
 int Server::Run() {
-  if (epoll_fd_ < 0 || listen_fd_ < 0) {
+  if (epoll_fd_ < 0 || !listening_) {
     std::cerr << "Server failed to initialise\n";
     return EXIT_FAILURE;
   }
@@ -157,18 +266,40 @@ int Server::Run() {
   // thread is the sole mutator of the store and no commands are executing yet,
   // so this needs no locking. Refuse to start on a corrupt snapshot rather than
   // silently come up empty and overwrite good data with the next snapshot.
-  if (!snapshotter_.Restore(store_)) {
+  // Likewise for the executors' shards, which are not running yet either.
+  const bool restored =
+      executors_.empty()
+          ? snapshotter_.Restore(store_)
+          : snapshotter_.Restore(Shards(),
+                                 [executors = executors_.size()](
+                                     const std::size_t hash) {
+                                   return ExecutorForKey(hash, executors);
+                                 });
+  if (!restored) {
     std::cerr << "Server failed to restore snapshot\n";
     return EXIT_FAILURE;
   }
 
+  for (const auto& executor : executors_) executor->Start();
   for (const auto& io_thread : io_threads_) io_thread->Start();
   std::cout << "Server listening with " << io_threads_.size()
-            << " IO thread(s)\n";
+            << " IO thread(s)";
+  if (!executors_.empty()) {
+    std::cout << " and " << executors_.size() << " executor(s)";
+  }
+  std::cout << "\n";
 
   std::array<epoll_event, kMaxEvents> events{};
   while (true) {
-    const int nfds = epoll_wait(epoll_fd_, events.data(), events.size(), -1);
+    ProcessCommands();
+    // Only block once neither our own fds nor the IO threads have anything for
+    // us, and no client has commands waiting for their turn; while we are
+    // awake the IO threads mark ready_threads_ without waking us.
+    int nfds = epoll_wait(epoll_fd_, events.data(), events.size(), 0);
+    if (nfds == 0 && scheduler_.Empty() && ready_threads_.PrepareToPark()) {
+      nfds = epoll_wait(epoll_fd_, events.data(), events.size(), -1);
+      ready_threads_.Unpark();
+    }
     if (nfds < 0) {
       if (errno == EINTR) continue;  // interrupted; just re-arm
       std::perror("epoll_wait");
@@ -179,14 +310,19 @@ int Server::Run() {
       const epoll_event& event = events[i];
       if (event.data.fd == listen_fd_) {
         AcceptConnections();
-      } else if (event.data.fd == command_event_.Fd()) {
-        command_event_.Drain();
-        ProcessCommands();
+      } else if (event.data.fd == ready_threads_.Fd()) {
+        // The ready set itself is drained every pass.
+        ready_threads_.ResetWakeup();
       } else if (event.data.fd == snapshot_fd_) {
         uint64_t expirations;
         ssize_t size = read(event.data.fd, &expirations, sizeof(expirations));
         assert(size == sizeof(expirations));
         CreateSnapshot();
+      } else if (event.data.fd == rebalance_fd_) {
+        uint64_t expirations;
+        ssize_t size = read(event.data.fd, &expirations, sizeof(expirations));
+        assert(size == sizeof(expirations));
+        Rebalance();
       } else {
         // A snapshot child's pidfd became readable: the child has exited.
         ReapSnapshot(event.data.fd);
@@ -205,52 +341,289 @@ void Server::AcceptConnections() {
 }
 
 void Server::AssignToIoThread(int client_fd) {
-  const std::size_t thread_index = next_thread_;
-  next_thread_ = (next_thread_ + 1) % io_threads_.size();
-
-  fd_to_thread_[client_fd] = static_cast<int>(thread_index);
+  const std::size_t thread_index = PickIoThread();
+  AddRoute(client_fd, thread_index);
   io_threads_[thread_index]->PostAssign(client_fd);
 }
 
+std::size_t Server::PickIoThread() const {
+  // Each client counts as one unit of work on top of what its thread did in
+  // the last interval, so clients placed since the last sample still spread
+  // out, and an idle server degenerates to balancing client counts.
+  std::size_t best = 0;
+  std::uint64_t best_load = UINT64_MAX;
+  for (std::size_t i = 0; i < io_threads_.size(); ++i) {
+    const ThreadLoad& load = thread_loads_[i];
+    const std::uint64_t total = load.recent_work + load.clients +
+                                io_threads_[i]->Load().outbox_depth;
+    if (total < best_load) {
+      best = i;
+      best_load = total;
+    }
+  }
+  return best;
+}
+
+void Server::AddRoute(int client_fd, std::size_t thread_index) {
+  routes_[client_fd] = ClientRoute{.thread = thread_index};
+  ++thread_loads_[thread_index].clients;
+}
+
 void Server::ProcessCommands() {
-  // Drain every IO thread's outbox. (A single shared command eventfd wakes
-  // us; we do not know which thread signalled, so we check them all.)
-  for (const auto& io_thread : io_threads_) {
-    while (std::optional<OutboxMsg> msg = io_thread->GetOutboxMsg()) {
-      if (const auto* batch = std::get_if<CommandBatch>(&*msg)) {
-        ExecuteAndRespond(*batch);
-      } else if (const auto* disconnect = std::get_if<Disconnect>(&*msg)) {
-        fd_to_thread_.erase(disconnect->fd);
+  // Only the threads that marked themselves since the last pass have anything
+  // queued, so the others are not even looked at.
+  ready_threads_.Drain(
+      [this](const std::size_t thread_index) { ProcessOutbox(thread_index); });
+  scheduler_.RunRound(
+      [this](CommandBatch& batch, const std::size_t begin,
+             const std::size_t end) { ExecuteSlice(batch, begin, end); },
+      [this](CommandBatch& batch, const std::size_t thread_index) {
+        Respond(batch, thread_index);
+      });
+}
+
+void Server::ProcessOutbox(const std::size_t thread_index) {
+  IoThread& io_thread = *io_threads_[thread_index];
+  // Whatever did not fit in its inbox last time goes first.
+  io_thread.FlushBacklog();
+  if (scheduler_.Queued(thread_index) >= IoThread::kQueueCapacity) {
+    // As many batches from it wait here as its outbox holds: leave the rest
+    // there, which stops it reading more, until we have caught up. Marking it
+    // again keeps us from parking meanwhile.
+    ready_threads_.Mark(thread_index);
+    return;
+  }
+  io_thread.DrainOutbox([this, thread_index](OutboxMsg& msg) {
+    if (auto* batch = std::get_if<CommandBatch>(&msg)) {
+      scheduler_.Add(std::move(*batch), thread_index);
+    } else if (const auto* disconnect = std::get_if<Disconnect>(&msg)) {
+      HandleDisconnect(disconnect->fd);
+    } else if (const auto* accepted = std::get_if<ConnectionsAccepted>(&msg)) {
+      for (const int client_fd : accepted->fds) {
+        AddRoute(client_fd, thread_index);
+      }
+    } else if (auto* detached = std::get_if<ConnectionDetached>(&msg)) {
+      HandleDetached(detached->connection);
+    } else if (const auto* loads = std::get_if<ClientLoads>(&msg)) {
+      for (const auto& [client_fd, commands] : loads->commands) {
+        const auto iter = routes_.find(client_fd);
+        if (iter != routes_.end() && iter->second.thread == thread_index) {
+          iter->second.recent_commands += commands;
+        }
       }
     }
+  });
+}
+
+void Server::ExecuteSlice(CommandBatch& batch, const std::size_t begin,
+                          const std::size_t end) {
+  // The replies go into the buffer the IO thread lent us, and the requests
+  // travel back with it, so neither is allocated or freed here (nor is the
+  // receive block the requests point into). With io_encode_replies_, large
+  // values are not even copied here: their replies are left in `deferred` for
+  // the IO thread to encode.
+  ReplyBuilder reply(batch.reply,
+                     io_encode_replies_ ? &batch.deferred : nullptr);
+  for (std::size_t i = begin; i < end; ++i) {
+    Command command = CommandAt(batch.requests, i);
+    Execute(command, reply);
   }
+  total_commands_processed_ += end - begin;
 }
 
-void Server::ExecuteAndRespond(const CommandBatch& batch) {
-  // Execute the whole pipelined batch and concatenate the replies, then hand
-  // them back in a single PostResponse. Commands still run even if the client
-  // has since disconnected (their store side effects must persist); we only
-  // skip the write-back in that case.
-  std::string response;
-  for (const RespValue& value : batch.values) {
-    response += Execute(value);
+void Server::Respond(CommandBatch& batch, const std::size_t thread_index) {
+  // However many slices the pipelined batch was executed in, its replies go
+  // back in a single PostResponse. Commands still run even if the client has
+  // since disconnected (their store side effects must persist); we only skip
+  // the write-back in that case. Either way the requests go back to an IO
+  // thread to be released: they pin receive blocks, which must only be let
+  // go of where the blocks are reused.
+  const auto iter = routes_.find(batch.fd);
+  if (iter == routes_.end()) {
+    // Client disconnected meanwhile: the thread that parsed the requests
+    // drops the reply along with them.
+    io_threads_[thread_index]->PostResponse(
+        WriteResponse{.fd = batch.fd,
+                      .client_id = batch.client_id,
+                      .spent_requests = std::move(batch.requests)});
+    return;
+  }
+  ClientRoute& route = iter->second;
+  WriteResponse response{.fd = batch.fd,
+                         .client_id = batch.client_id,
+                         .seq = batch.seq,
+                         .bytes = std::move(batch.reply),
+                         .spent_requests = std::move(batch.requests),
+                         .deferred = std::move(batch.deferred)};
+  if (route.migrating_to.has_value()) {
+    // Held whole, deferred values and all, for the adopting thread to encode
+    // and release like any other reply.
+    route.held_responses.push_back(std::move(response));
+    return;
   }
+  io_threads_[route.thread]->PostResponse(std::move(response));
+}
 
-  const auto iter = fd_to_thread_.find(batch.fd);
-  if (iter == fd_to_thread_.end()) return;  // client disconnected meanwhile
-  io_threads_[iter->second]->PostResponse(batch.fd, std::move(response));
+void Server::HandleDisconnect(int client_fd) {
+  // The IO thread has let go of the fd; drop the route before closing it so a
+  // new client reusing the number starts afresh. A migration in progress just
+  // ends here, its held replies having nowhere to go. What the client still
+  // has queued runs first, as it would have before the IO thread let go.
+  scheduler_.Finish(
+      client_fd,
+      [this](CommandBatch& batch, const std::size_t begin,
+             const std::size_t end) { ExecuteSlice(batch, begin, end); },
+      [this](CommandBatch& batch, const std::size_t thread_index) {
+        Respond(batch, thread_index);
+      });
+  if (const auto iter = routes_.find(client_fd); iter != routes_.end()) {
+    ClientRoute& route = iter->second;
+    --thread_loads_[route.thread].clients;
+    // The client is gone from its thread too, which just releases the
+    // requests of the held replies.
+    for (WriteResponse& response : route.held_responses) {
+      io_threads_[route.thread]->PostResponse(std::move(response));
+    }
+    routes_.erase(iter);
+  }
+  close(client_fd);
 }
 
-std::string Server::Execute(const RespValue& request) {
-  return dispatcher_.Dispatch(request).Serialize();
+void Server::HandleDetached(Connection& connection) {
+  const int client_fd = connection.fd;
+  const auto iter = routes_.find(client_fd);
+  if (iter == routes_.end() || !iter->second.migrating_to.has_value()) {
+    close(client_fd);  // not expected: nobody is waiting for this client
+    return;
+  }
+  ClientRoute& route = iter->second;
+  --thread_loads_[route.thread].clients;
+  route.thread = *route.migrating_to;
+  route.migrating_to.reset();
+  ++thread_loads_[route.thread].clients;
+  ++client_migrations_;
+
+  // The adopting thread sees the Connection (with the replies the old thread
+  // had not written) before the replies held here, which came after them.
+  IoThread& target = *io_threads_[route.thread];
+  target.PostAdopt(std::move(connection));
+  for (WriteResponse& response : route.held_responses) {
+    target.PostResponse(std::move(response));
+  }
+  route.held_responses.clear();
+}
+
+void Server::Rebalance() {
+  for (std::size_t i = 0; i < io_threads_.size(); ++i) {
+    ThreadLoad& load = thread_loads_[i];
+    const IoThreadLoad sample = io_threads_[i]->Load();
+    load.recent_work =
+        (sample.commands_parsed - load.last_sample.commands_parsed) +
+        ((sample.bytes_read - load.last_sample.bytes_read) /
+         kBytesPerWorkUnit) +
+        sample.outbox_depth;
+    load.last_sample = sample;
+  }
+
+  std::size_t busiest = 0;
+  std::size_t idlest = 0;
+  for (std::size_t i = 1; i < io_threads_.size(); ++i) {
+    if (thread_loads_[i].recent_work > thread_loads_[busiest].recent_work) {
+      busiest = i;
+    }
+    if (thread_loads_[i].recent_work < thread_loads_[idlest].recent_work) {
+      idlest = i;
+    }
+  }
+  const std::uint64_t high = thread_loads_[busiest].recent_work;
+  const std::uint64_t low = thread_loads_[idlest].recent_work;
+
+  // Moving a client with load c narrows the gap iff c < gap, and narrows it
+  // most for c = gap / 2: take the busiest client on the busiest thread that
+  // does not exceed that, so a single dominant client is never bounced back
+  // and forth.
+  int candidate = -1;
+  std::uint64_t candidate_load = 0;
+  const bool imbalanced =
+      high >= kMinRebalanceWork && high > kRebalanceRatio * low;
+  for (auto& [client_fd, route] : routes_) {
+    if (imbalanced && route.thread == busiest &&
+        !route.migrating_to.has_value() &&
+        route.recent_commands > candidate_load &&
+        route.recent_commands <= (high - low) / 2) {
+      candidate = client_fd;
+      candidate_load = route.recent_commands;
+    }
+    route.recent_commands = 0;
+  }
+  // The clients' counts for the next round come from the IO threads, which
+  // see every request, wherever it then runs.
+  for (const auto& io_thread : io_threads_) io_thread->PostSampleClientLoads();
+  if (candidate < 0) return;
+
+  // From here until the ConnectionDetached arrives, replies are held rather
+  // than posted: the old thread must not get more, and the new one must not
+  // get them before the Connection itself.
+  routes_.at(candidate).migrating_to = idlest;
+  io_threads_[busiest]->PostMigrate(candidate);
+}
+
+ServerStats Server::Stats() const {
+  ServerStats stats{.io_threads = io_threads_.size(),
+                    .executors = std::max<std::size_t>(executors_.size(), 1),
+                    .connected_clients = routes_.size(),
+                    .total_commands_processed = total_commands_processed_,
+                    .client_migrations = client_migrations_};
+  for (const auto& executor : executors_) {
+    stats.total_commands_processed += executor->CommandsProcessed();
+  }
+  for (const auto& io_thread : io_threads_) {
+    const IoThreadStats thread_stats = io_thread->Stats();
+    stats.total_commands_processed += thread_stats.commands_processed;
+    stats.io_commands_processed += thread_stats.commands_processed;
+    stats.io_inbox_overflows += thread_stats.inbox_overflows;
+    stats.io_inbox_backlog += thread_stats.inbox_backlog;
+    stats.io_outbox_overflows += thread_stats.outbox_overflows;
+  }
+  return stats;
+}
+
+void Server::Execute(Command& command, ReplyBuilder& reply) {
+  dispatcher_.Dispatch(command, reply);
+}
+
+std::vector<Store*> Server::Shards() const {
+  std::vector<Store*> shards;
+  shards.reserve(executors_.size());
+  for (const auto& executor : executors_) {
+    shards.push_back(&executor->GetStore());
+  }
+  return shards;
 }
 
 void Server::CreateSnapshot() {
-  const int pid = fork();
+  // The child gets a copy of the shards as they are between two batches: the
+  // executors are paused just for the fork, as the main thread's own store
+  // is by the main thread being busy forking, or if the IO threads execute
+  // on it, by holding all of its stripes.
+  for (const auto& executor : executors_) executor->Pause();
+  int pid = 0;
+  {
+    // Released on both sides of the fork.
+    const std::vector<std::unique_lock<std::mutex>> stripes = store_->LockAll();
+    pid = fork();
+  }
   if (pid == 0) {
-    snapshotter_.Snapshot(store_);
+    if (executors_.empty()) {
+      snapshotter_.Snapshot(store_);
+    } else {
+      const std::vector<Store*> shards = Shards();
+      snapshotter_.Snapshot(std::vector<const Store*>(shards.begin(),
+                                                      shards.end()));
+    }
     _exit(0);
   }
+  for (const auto& executor : executors_) executor->Resume();
   if (pid == -1) {
     perror("fork");
     return;
@@ -1,15 +1,24 @@
 #ifndef MYREDIS_SERVER_SERVER_H_
 #define MYREDIS_SERVER_SERVER_H_
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
-#include "concurrent/event_fd.h"
+#include "concurrent/ready_set.h"
+#include "resp_value/reply_builder.h"
+#include "server/batch_scheduler.h"
+#include "server/connection.h"
+#include "server/executor.h"
+#include "server/handler/command.h"
 #include "server/handler/request_dispatcher.h"
 #include "server/io_thread.h"
 #include "server/messages.h"
+#include "server/server_stats.h"
 #include "snapshot/snapshotter.h"
 #include "store/store.h"
 
@@ -19,17 +28,61 @@ struct ServerConfig {
   int port;
   // Milliseconds between snapshots; <= 0 disables snapshotting.
   int snapshot_interval_ms;
+  // How the IO threads drive their sockets. kIoUring falls back to kEpoll (with
+  // a warning) on kernels that lack the io_uring features it needs.
+  IoEngine io_engine = IoEngine::kEpoll;
+  // Number of IO threads; 0 means one per core, less the executors'.
+  int io_threads = 0;
+  // Number of command executors. With more than one, the keyspace is split
+  // among Executor threads by hash slot, each executing the commands on its
+  // own keys, and the main thread executes only commands without a key.
+  // Clients then stay on the IO thread they were first placed on.
+  int executors = 1;
+  // Length of each listen socket's accept queue. Large enough by default to
+  // absorb a reconnect storm without the kernel dropping SYNs.
+  int listen_backlog = 511;
+  // Give every IO thread its own SO_REUSEPORT listen socket to accept from,
+  // instead of accepting on the main thread and handing clients over.
+  bool reuse_port = false;
+  // Milliseconds between samples of IO thread load, each of which may migrate
+  // one busy client off the busiest thread; <= 0 disables both, leaving
+  // placement to balance client counts and outbox depth alone.
+  int rebalance_interval_ms = 1000;
+  // Caps on each client's unwritten replies; all disabled by default, as for
+  // Redis' normal clients.
+  OutputBufferLimits output_buffer_limits;
+  // Leave copying large values into replies (see Store::kShareBytes) to the
+  // IO threads, which do it in parallel, rather than the main thread.
+  bool io_encode_replies = false;
+  // Let IO threads execute read-only commands (GET, TTL, PTTL) themselves,
+  // from stores made read-concurrent (see Store) for them, unless the client
+  // still has earlier requests executing. The executing threads stay the
+  // stores' only writers.
+  bool io_reads = false;
+  // Let IO threads execute every command on a key themselves, on one store
+  // they all share, striped (see StoreConcurrency) so that commands on keys
+  // of different stripes run in parallel. The main thread is then left with
+  // accepting clients and INFO. Overrides `executors` and `io_reads`.
+  bool io_execute = false;
+  // How many commands of one client's pipeline run before the next client
+  // with requests queued gets a turn (see BatchScheduler); 0 runs all that a
+  // client has queued in one go. Applies to the main thread and executors.
+  std::size_t command_budget = 64;
 };
 
 // The server's main thread. It owns the listening socket and is the single
 // command executor: IO threads parse client bytes into RESP requests and hand
 // them here, the main thread executes each one (single-threaded, so the store
 // needs no locking) and routes the response bytes back to the IO thread that
-// owns the client.
+// owns the client. With ServerConfig::executors > 1 it hands that job over to
+// the Executors, for all but the commands without a key, and with
+// ServerConfig::io_execute to the IO threads themselves.
 //
 // The main thread runs one epoll loop watching the listen socket (for new
-// connections) and a shared command eventfd (signalled by the IO threads when
-// they enqueue work).
+// connections) and a ready set shared by the IO threads, in which they mark
+// themselves when they enqueue work. With ServerConfig::reuse_port the IO
+// threads each own a listen socket instead and only report the clients they
+// accepted.
 class Server {
  public:
   explicit Server(ServerConfig config);
@@ -42,18 +95,41 @@ class Server {
   int Run();
 
  private:
+  // `num_io_threads` is how many IO threads `config` asks for, worked out once.
+  Server(ServerConfig config, unsigned num_io_threads);
+
   void AcceptConnections();
   void AssignToIoThread(int client_fd);
+  // The least-loaded IO thread, to place a new client on.
+  std::size_t PickIoThread() const;
+  void AddRoute(int client_fd, std::size_t thread_index);
+  // Handles every message queued by the IO threads marked in ready_threads_,
+  // then gives every client with commands queued a turn at executing them.
   void ProcessCommands();
-  void ExecuteAndRespond(const CommandBatch& batch);
+  void ProcessOutbox(std::size_t thread_index);
+  // Executes requests [begin, end) of `batch`, appending to its reply.
+  void ExecuteSlice(CommandBatch& batch, std::size_t begin, std::size_t end);
+  // Hands the replies to a batch executed to its end back to the client's IO
+  // thread, or, if the client is gone, its requests to `thread_index`, the
+  // IO thread they came from.
+  void Respond(CommandBatch& batch, std::size_t thread_index);
+  void HandleDisconnect(int client_fd);
+  void HandleDetached(Connection& connection);
+  // Samples every IO thread's load and, if one is doing far more work than
+  // another, migrates one of its clients across.
+  void Rebalance();
+  // Gathers the counters INFO reports.
+  ServerStats Stats() const;
+  // The executors' stores, in executor order.
+  std::vector<Store*> Shards() const;
   void CreateSnapshot();
   // Reaps a finished snapshot child (identified by its pidfd) and stops
   // watching it.
   void ReapSnapshot(int pidfd);
 
-  // Executes a single request via the dispatcher and returns the serialized
-  // response bytes.
-  std::string Execute(const RespValue& request);
+  // Executes a single request via the dispatcher, appending its reply to
+  // `reply`. Arguments may be moved out of `command`.
+  void Execute(Command& command, ReplyBuilder& reply);
 
   // The store the dispatcher and its handlers reference. Declared before
   // `dispatcher_` so it is constructed first: the dispatcher binds a reference
@@ -67,19 +143,57 @@ class Server {
   // Periodically forks to write the store to disk; see CreateSnapshot.
   Snapshotter snapshotter_;
 
+  // See ServerConfig::io_encode_replies.
+  const bool io_encode_replies_;
+
   int epoll_fd_ = -1;
+  // -1 when the IO threads accept on their own sockets.
   int listen_fd_ = -1;
+  // Whether every socket clients can connect to was set up.
+  bool listening_ = false;
   int snapshot_fd_ = -1;
-  // IO threads -> main wakeup; shared by all IO threads
-  EventFd command_event_;
+  int rebalance_fd_ = -1;
+  // IO threads -> main wakeup, and which of them have work; shared by all IO
+  // threads. Indexed like io_threads_.
+  ReadySet ready_threads_;
+  // The CommandBatches drained from the IO threads, waiting for their turn.
+  BatchScheduler scheduler_;
 
   std::vector<std::unique_ptr<IoThread>> io_threads_;
-  // Maps a client fd to the index of the IO thread that owns it. Touched only
-  // by the main thread (populated on accept, erased on Disconnect). Needed to
-  // route a response to the owning thread even when the executed command
-  // targets a different client.
-  std::unordered_map<int, int> fd_to_thread_;
-  std::size_t next_thread_ = 0;  // round-robin assignment cursor
+  // Empty unless ServerConfig::executors > 1. Executor i owns the keys for
+  // which ExecutorForKey(hash, executors_.size()) is i.
+  std::vector<std::unique_ptr<Executor>> executors_;
+
+  // Where a client's replies go, and how busy it has been.
+  struct ClientRoute {
+    std::size_t thread = 0;  // index of the owning IO thread
+    // Requests the client sent in the interval before the last Rebalance, as
+    // reported by its IO thread (see ClientLoads).
+    std::uint64_t recent_commands = 0;
+    // While the client is migrating (from PostMigrate until its
+    // ConnectionDetached arrives), the thread it is moving to, and the replies
+    // held back until it gets there.
+    std::optional<std::size_t> migrating_to{};
+    std::vector<WriteResponse> held_responses{};
+  };
+  // Maps a client fd to its route. Touched only by the main thread (populated
+  // on accept or ConnectionsAccepted, erased on Disconnect). Needed to route a
+  // response to the owning thread even when the executed command targets a
+  // different client.
+  std::unordered_map<int, ClientRoute> routes_;
+
+  // The main thread's view of one IO thread's load.
+  struct ThreadLoad {
+    IoThreadLoad last_sample;
+    // Work done between the last two samples (see Rebalance).
+    std::uint64_t recent_work = 0;
+    std::size_t clients = 0;
+  };
+  // Indexed like io_threads_.
+  std::vector<ThreadLoad> thread_loads_;
+
+  std::uint64_t total_commands_processed_ = 0;
+  std::uint64_t client_migrations_ = 0;
 
   // Maps a snapshot child's pidfd to its pid so the main thread can reap the
   // child (and remove the pidfd from epoll) once it exits.
@@ -0,0 +1,28 @@
+#ifndef MYREDIS_SERVER_SERVER_STATS_H_
+#define MYREDIS_SERVER_SERVER_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace myredis {
+
+// Counters INFO reports, gathered by the main thread when it is run.
+struct ServerStats {
+  std::size_t io_threads = 0;
+  std::size_t executors = 1;
+  std::size_t connected_clients = 0;
+  // Including those the IO threads executed themselves, also counted in
+  // io_commands_processed.
+  std::uint64_t total_commands_processed = 0;
+  std::uint64_t io_commands_processed = 0;
+  // Summed over the IO threads; see IoThreadStats.
+  std::uint64_t io_inbox_overflows = 0;
+  std::size_t io_inbox_backlog = 0;
+  std::uint64_t io_outbox_overflows = 0;
+  // Clients Rebalance moved to another IO thread.
+  std::uint64_t client_migrations = 0;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_SERVER_SERVER_STATS_H_
@@ -0,0 +1,645 @@
+#include "uring_io_thread.h"
+
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <string_view>
+#include <utility>
+
+namespace myredis {
+
+namespace {
+constexpr unsigned kRingEntries = 1024;
+// Multishot recvs can each post many completions per submit, so give the CQ
+// plenty of headroom over the SQ.
+constexpr unsigned kCqEntries = 4 * kRingEntries;
+
+constexpr std::uint16_t kBufferGroup = 0;
+constexpr unsigned kBufferCount = 512;  // power of two, as the kernel requires
+constexpr std::size_t kBufferSize = 4096;
+
+constexpr unsigned kMaxRegisteredFiles = 4096;
+// Longest linked send chain we submit. A chain must be queued in one submit,
+// so this keeps it well inside the SQ; any responses beyond it wait for the
+// next chain.
+constexpr std::size_t kMaxSendChain = 16;
+// Largest single send SQE. Bounding it gives a slow reader's replies a
+// completion (and an output-buffer limit check) every so often instead of one
+// only once the whole reply is out.
+constexpr std::size_t kMaxSendBytes = 256 * 1024;
+
+constexpr int kUserDataOpShift = 56;
+constexpr int kUserDataIndexShift = 32;
+constexpr std::uint64_t kUserDataIndexMask = 0xFFFF;
+constexpr std::uint64_t kUserDataFdMask = 0xFFFFFFFF;
+
+template <typename Op>
+std::uint64_t PackUserData(const Op op, const int fd,
+                           const std::size_t index = 0) {
+  return (static_cast<std::uint64_t>(op) << kUserDataOpShift) |
+         ((static_cast<std::uint64_t>(index) & kUserDataIndexMask)
+          << kUserDataIndexShift) |
+         (static_cast<std::uint64_t>(static_cast<std::uint32_t>(fd)) &
+          kUserDataFdMask);
+}
+
+int UserDataFd(const std::uint64_t user_data) {
+  return static_cast<int>(static_cast<std::uint32_t>(user_data));
+}
+
+std::size_t UserDataIndex(const std::uint64_t user_data) {
+  return (user_data >> kUserDataIndexShift) & kUserDataIndexMask;
+}
+
+// Results that mean "try again" rather than a broken socket.
+bool IsTransient(const int result) {
+  return result == -EAGAIN || result == -EINTR || result == -ENOBUFS;
+}
+
+unsigned RegisteredFileCount() {
+  // Registering more slots than RLIMIT_NOFILE is refused by the kernel.
+  rlimit limit{};
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) return 0;
+  return static_cast<unsigned>(
+      std::min<rlim_t>(kMaxRegisteredFiles, limit.rlim_cur));
+}
+}  // namespace
+
+UringIoThread::UringIoThread(ReadySet& main_ready,
+                             const std::size_t index, const int listen_fd,
+                             const OutputBufferLimits output_limits)
+    : IoThread(main_ready, index, listen_fd, output_limits) {}
+
+UringIoThread::~UringIoThread() { Stop(); }
+
+void UringIoThread::Run() {
+  ring_ = std::make_unique<IoUring>(kRingEntries, kCqEntries);
+  if (ring_->Valid()) {
+    buffers_ = std::make_unique<BufferRing>(*ring_, kBufferGroup, kBufferCount,
+                                            kBufferSize);
+  }
+  if (!ring_->Valid() || !buffers_->Valid()) {
+    std::cerr << "io_uring IO thread failed to initialise\n";
+    return;
+  }
+
+  // Fixed files are an optimisation: without them every SQE just names the
+  // raw fd.
+  const unsigned file_count = RegisteredFileCount();
+  if (file_count > 0 && ring_->RegisterSparseFiles(file_count)) {
+    free_slots_.reserve(file_count);
+    for (unsigned slot = file_count; slot > 0; --slot) {
+      free_slots_.push_back(slot - 1);
+    }
+  }
+
+  ArmInboxPoll();
+  if (SoftLimitTimerFd() >= 0) ArmSoftLimitPoll();
+  if (ListenFd() >= 0) ArmAccept();
+  while (IsRunning()) {
+    DrainInbox();
+    SubmitPendingSends();
+    // Only wait for a completion once the inbox has nothing for us either;
+    // while we are awake the main thread posts without waking us.
+    const bool park = !ring_->CqReady() &&
+                      PrepareToPark([this] { return ring_->CqReady(); });
+    const int result = ring_->SubmitAndWait(park ? 1 : 0);
+    if (park) FinishPark();
+    if (result < 0 && result != -EINTR && result != -EBUSY) {
+      std::cerr << "io_uring_enter failed: " << -result << "\n";
+      break;
+    }
+    ring_->ForEachCqe(
+        [this](const io_uring_cqe& cqe) { HandleCompletion(cqe); });
+    if (!accepted_.empty()) {
+      RegisterAccepted(accepted_);
+      accepted_.clear();
+    }
+  }
+
+  Shutdown();
+}
+
+void UringIoThread::HandleAssign(int client_fd) {
+  connections_.try_emplace(client_fd, client_fd);
+  Watch(client_fd);
+}
+
+void UringIoThread::HandleWriteResponse(WriteResponse& response) {
+  const auto it = ring_connections_.find(response.fd);
+  if (it == ring_connections_.end() || it->second.closing) {
+    ReleaseReplyBuffer(std::move(response.bytes));  // client already gone
+    return;
+  }
+  QueueSend(response.fd, it->second, std::move(response.bytes));
+  ApplyOutputLimits(response.fd, it->second);
+}
+
+void UringIoThread::HandleMigrate(int client_fd) {
+  const auto it = ring_connections_.find(client_fd);
+  if (it == ring_connections_.end()) return;  // already disconnected
+  RingConnection& ring_conn = it->second;
+  if (ring_conn.closing || ring_conn.detaching) return;
+  ring_conn.detaching = true;
+  // Only the recv is cancelled: a send chain already submitted is left to
+  // finish, so no reply is cut off half-written.
+  CancelRecv(client_fd, ring_conn);
+  FinishDetachIfIdle(client_fd);
+}
+
+void UringIoThread::HandleAdopt(Connection& connection) {
+  const int client_fd = connection.fd;
+  Connection& conn =
+      connections_.insert_or_assign(client_fd, std::move(connection))
+          .first->second;
+  Watch(client_fd);
+  // Replies the previous thread had not written yet go out before anything
+  // the main thread sends us for this client.
+  RingConnection& ring_conn = ring_connections_.at(client_fd);
+  conn.out_buffer.TakeChunks(
+      [this, client_fd, &ring_conn](std::string&& bytes) {
+        QueueSend(client_fd, ring_conn, std::move(bytes));
+      });
+}
+
+void UringIoThread::ResumeReads() {
+  for (const int client_fd : read_paused_) {
+    const auto it = ring_connections_.find(client_fd);
+    if (it == ring_connections_.end()) continue;
+    it->second.read_paused = false;
+    UpdateReading(client_fd, it->second);
+  }
+  read_paused_.clear();
+}
+
+void UringIoThread::Watch(int client_fd) {
+  RingConnection& ring_conn = ring_connections_[client_fd];
+  if (!free_slots_.empty() && ring_->UpdateFile(free_slots_.back(), client_fd)) {
+    ring_conn.slot = static_cast<int>(free_slots_.back());
+    free_slots_.pop_back();
+  }
+  ArmRecv(client_fd, ring_conn);
+}
+
+void UringIoThread::QueueSend(int client_fd, RingConnection& ring_conn,
+                              std::string bytes) {
+  // Keep each response as its own buffer (no append copy); the whole list is
+  // submitted as one linked chain once this pass over the CQ is done.
+  ring_conn.unsent_bytes += bytes.size();
+  ring_conn.pending.push_back({std::move(bytes), 0});
+  if (!ring_conn.dirty) {
+    ring_conn.dirty = true;
+    dirty_.push_back(client_fd);
+  }
+}
+
+void UringIoThread::HandleCompletion(const io_uring_cqe& cqe) {
+  const auto op = static_cast<Op>(cqe.user_data >> kUserDataOpShift);
+  const int client_fd = UserDataFd(cqe.user_data);
+  switch (op) {
+    case Op::kInboxPoll:
+      HandleInboxPoll(cqe);
+      break;
+    case Op::kSoftLimitPoll:
+      HandleSoftLimitPoll(cqe);
+      break;
+    case Op::kAccept:
+      HandleAccept(cqe);
+      break;
+    case Op::kRecv:
+      HandleRecv(client_fd, cqe);
+      break;
+    case Op::kSend:
+      HandleSend(client_fd, UserDataIndex(cqe.user_data), cqe.res);
+      break;
+    case Op::kCancel:
+      // The cancelled SQEs report their own completions; nothing to do.
+      break;
+  }
+}
+
+void UringIoThread::HandleInboxPoll(const io_uring_cqe& cqe) {
+  if ((cqe.flags & IORING_CQE_F_MORE) == 0) inbox_armed_ = false;
+  if (!IsRunning()) return;
+  if (!inbox_armed_) ArmInboxPoll();
+  InboxWaker().Drain();  // the inbox itself is drained every pass of Run
+}
+
+void UringIoThread::HandleSoftLimitPoll(const io_uring_cqe& cqe) {
+  if ((cqe.flags & IORING_CQE_F_MORE) == 0) soft_limit_armed_ = false;
+  if (!IsRunning()) return;
+  if (!soft_limit_armed_) ArmSoftLimitPoll();
+  for (const int client_fd : TakeStalledClients()) {
+    CloseConnection(client_fd, /*notify_main=*/true);
+  }
+}
+
+void UringIoThread::HandleAccept(const io_uring_cqe& cqe) {
+  if ((cqe.flags & IORING_CQE_F_MORE) == 0) accept_armed_ = false;
+  if (cqe.res >= 0) {
+    if (IsRunning()) {
+      accepted_.push_back(cqe.res);
+    } else {
+      close(cqe.res);  // raced with shutdown; nobody will serve it
+    }
+  }
+  // A failed accept (e.g. EMFILE) ends the multishot; re-arm to keep going.
+  if (!accept_armed_ && IsRunning()) ArmAccept();
+}
+
+void UringIoThread::HandleRecv(int client_fd, const io_uring_cqe& cqe) {
+  const auto it = ring_connections_.find(client_fd);
+  if (it == ring_connections_.end()) return;
+  RingConnection& ring_conn = it->second;
+  if ((cqe.flags & IORING_CQE_F_MORE) == 0) {
+    // The multishot recv has terminated and will post nothing further.
+    ring_conn.recv_armed = false;
+    --ring_conn.inflight;
+  }
+
+  const int result = cqe.res;
+  bool well_formed = true;
+  if ((cqe.flags & IORING_CQE_F_BUFFER) != 0) {
+    const std::uint16_t bid = BufferRing::Bid(cqe);
+    if (result > 0 && !ring_conn.closing) {
+      RecordBytesRead(static_cast<std::size_t>(result));
+      // Parsed in place in the provided buffer, which goes straight back to
+      // the kernel; only an incomplete trailing request is copied out.
+      well_formed = EmitParsedCommands(
+          connections_.at(client_fd),
+          std::string_view(buffers_->Data(bid),
+                           static_cast<std::size_t>(result)));
+    }
+    buffers_->Recycle(bid);
+  }
+
+  if (ring_conn.closing) {
+    FinishCloseIfIdle(client_fd);
+    return;
+  }
+  if (ring_conn.detaching && result < 0) {
+    // Our cancellation (or an error the adopting thread will see again).
+    FinishDetachIfIdle(client_fd);
+    return;
+  }
+  if (result == 0 ||
+      (result < 0 && result != -ECANCELED && !IsTransient(result))) {
+    // Orderly shutdown by the peer, or a fatal socket error. (-ECANCELED is
+    // UpdateReading pausing us.)
+    CloseConnection(client_fd, /*notify_main=*/true);
+    return;
+  }
+  if (!well_formed) {
+    CloseConnection(client_fd, /*notify_main=*/true);  // protocol error
+    return;
+  }
+  if (ring_conn.detaching) {
+    FinishDetachIfIdle(client_fd);
+    return;
+  }
+  // -ENOBUFS (the buffer ring ran dry) also ends the multishot; buffers have
+  // been recycled by now, so re-arming is enough to resume.
+  UpdateReading(client_fd, ring_conn);
+}
+
+void UringIoThread::HandleSend(int client_fd, const std::size_t index,
+                               const int result) {
+  const auto it = ring_connections_.find(client_fd);
+  if (it == ring_connections_.end()) return;
+  RingConnection& ring_conn = it->second;
+  --ring_conn.inflight;
+  --ring_conn.sends_outstanding;
+
+  if (result > 0 && index < ring_conn.sending.size()) {
+    ring_conn.sending[index].sent += static_cast<std::size_t>(result);
+    ring_conn.unsent_bytes -= static_cast<std::size_t>(result);
+  } else if (result < 0 && result != -ECANCELED && !IsTransient(result)) {
+    // -ECANCELED only means an earlier link in the chain came up short; the
+    // unsent remainder is resubmitted below.
+    ring_conn.send_failed = true;
+  }
+
+  if (ring_conn.closing) {
+    FinishCloseIfIdle(client_fd);
+    return;
+  }
+  // A stream send completes only once the socket has taken all of it, so a
+  // slow reader's chain can stay in flight for long: re-check the limits on
+  // every completion rather than once per chain.
+  if (!ring_conn.detaching && !ApplyOutputLimits(client_fd, ring_conn)) return;
+  if (ring_conn.sends_outstanding > 0) return;  // chain still in flight
+
+  if (ring_conn.send_failed) {
+    CloseConnection(client_fd, /*notify_main=*/true);  // fatal write error
+    return;
+  }
+
+  // The chain is done. Whatever the socket did not take goes back in front of
+  // the responses that queued up meanwhile, preserving reply order.
+  std::vector<SendChunk> unsent;
+  for (SendChunk& chunk : ring_conn.sending) {
+    if (chunk.sent < chunk.bytes.size()) {
+      unsent.push_back(std::move(chunk));
+    } else {
+      ReleaseReplyBuffer(std::move(chunk.bytes));
+    }
+  }
+  ring_conn.sending.clear();
+  ring_conn.pending.insert(ring_conn.pending.begin(),
+                           std::make_move_iterator(unsent.begin()),
+                           std::make_move_iterator(unsent.end()));
+  if (ring_conn.detaching) {
+    FinishDetachIfIdle(client_fd);
+    return;
+  }
+  if (ring_conn.pending.empty()) return;
+  if (!ring_conn.dirty) {
+    ring_conn.dirty = true;
+    dirty_.push_back(client_fd);
+  }
+}
+
+void UringIoThread::ArmInboxPoll() {
+  io_uring_sqe* sqe = NextSqe();
+  if (sqe == nullptr) return;
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = InboxWaker().Fd();
+  sqe->poll32_events = POLLIN;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = PackUserData(Op::kInboxPoll, InboxWaker().Fd());
+  inbox_armed_ = true;
+}
+
+void UringIoThread::ArmSoftLimitPoll() {
+  io_uring_sqe* sqe = NextSqe();
+  if (sqe == nullptr) return;
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = SoftLimitTimerFd();
+  sqe->poll32_events = POLLIN;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->user_data = PackUserData(Op::kSoftLimitPoll, SoftLimitTimerFd());
+  soft_limit_armed_ = true;
+}
+
+void UringIoThread::ArmAccept() {
+  io_uring_sqe* sqe = NextSqe();
+  if (sqe == nullptr) return;
+  sqe->opcode = IORING_OP_ACCEPT;
+  sqe->fd = ListenFd();
+  sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+  sqe->user_data = PackUserData(Op::kAccept, ListenFd());
+  accept_armed_ = true;
+}
+
+void UringIoThread::ArmRecv(int client_fd, RingConnection& ring_conn) {
+  io_uring_sqe* sqe = NextSqe();
+  if (sqe == nullptr) {
+    CloseConnection(client_fd, /*notify_main=*/true);
+    return;
+  }
+  sqe->opcode = IORING_OP_RECV;
+  SetTarget(sqe, client_fd, ring_conn);
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags |= IOSQE_BUFFER_SELECT;
+  sqe->buf_group = buffers_->GroupId();
+  sqe->user_data = PackUserData(Op::kRecv, client_fd);
+  ring_conn.recv_armed = true;
+  ring_conn.recv_cancel_submitted = false;
+  ++ring_conn.inflight;
+}
+
+void UringIoThread::CancelRecv(int client_fd, RingConnection& ring_conn) {
+  if (!ring_conn.recv_armed || ring_conn.recv_cancel_submitted) return;
+  io_uring_sqe* sqe = NextSqe();
+  if (sqe == nullptr) return;
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->addr = PackUserData(Op::kRecv, client_fd);
+  sqe->user_data = PackUserData(Op::kCancel, client_fd);
+  ring_conn.recv_cancel_submitted = true;
+}
+
+void UringIoThread::UpdateReading(int client_fd, RingConnection& ring_conn) {
+  if (ring_conn.closing || ring_conn.detaching) return;
+  if (!ReadsPaused(connections_.at(client_fd))) {
+    // A cancel may still be on its way; HandleRecv re-arms once it lands.
+    if (!ring_conn.recv_armed) ArmRecv(client_fd, ring_conn);
+    return;
+  }
+  if (OutboxBlocked() && !ring_conn.read_paused) {
+    ring_conn.read_paused = true;
+    read_paused_.push_back(client_fd);
+  }
+  CancelRecv(client_fd, ring_conn);
+}
+
+bool UringIoThread::ApplyOutputLimits(int client_fd,
+                                      RingConnection& ring_conn) {
+  if (!CheckOutputBuffer(connections_.at(client_fd), ring_conn.unsent_bytes)) {
+    CloseConnection(client_fd, /*notify_main=*/true);  // over its output limit
+    return false;
+  }
+  UpdateReading(client_fd, ring_conn);
+  return true;
+}
+
+void UringIoThread::SubmitPendingSends() {
+  // SubmitSendChain may close (and erase) a connection, so iterate a snapshot.
+  std::vector<int> dirty;
+  dirty.swap(dirty_);
+  for (const int client_fd : dirty) {
+    const auto it = ring_connections_.find(client_fd);
+    if (it == ring_connections_.end()) continue;
+    it->second.dirty = false;
+    SubmitSendChain(client_fd, it->second);
+  }
+}
+
+void UringIoThread::SubmitSendChain(int client_fd, RingConnection& ring_conn) {
+  // At most one chain per connection is in flight: a second chain could run
+  // concurrently with the first and reorder bytes on the wire. Responses that
+  // arrive meanwhile wait in `pending` for HandleSend to resubmit them.
+  if (ring_conn.closing || ring_conn.detaching ||
+      ring_conn.sends_outstanding > 0 || ring_conn.pending.empty()) {
+    return;
+  }
+
+  // Responses beyond the first kMaxSendChain stay in `pending`, for
+  // HandleSend to submit once this chain is done.
+  std::vector<SendChunk>& pending = ring_conn.pending;
+  const std::size_t chain = std::min(pending.size(), kMaxSendChain);
+  // A chain must not straddle two submits, or the kernel ends the link at the
+  // boundary. If the SQ has no room for all of it even after a submit (which
+  // fails with -EBUSY while the CQ is backed up), leave `pending` be and try
+  // again on the next pass, once completions have been reaped.
+  if (ring_->SqSpaceLeft() < chain &&
+      (ring_->Submit() < 0 || ring_->SqSpaceLeft() < chain)) {
+    ring_conn.dirty = true;
+    dirty_.push_back(client_fd);
+    return;
+  }
+
+  const auto chain_end = pending.begin() + static_cast<std::ptrdiff_t>(chain);
+  ring_conn.sending.assign(std::make_move_iterator(pending.begin()),
+                           std::make_move_iterator(chain_end));
+  pending.erase(pending.begin(), chain_end);
+  ring_conn.send_failed = false;
+  std::size_t length = 0;
+  for (const SendChunk& chunk : ring_conn.sending) {
+    // Cannot fail: the room for the whole chain was checked above.
+    io_uring_sqe* sqe = ring_->GetSqe();
+    assert(sqe != nullptr);
+    sqe->opcode = IORING_OP_SEND;
+    SetTarget(sqe, client_fd, ring_conn);
+    sqe->addr =
+        reinterpret_cast<std::uint64_t>(chunk.bytes.data() + chunk.sent);
+    const std::size_t remaining = chunk.bytes.size() - chunk.sent;
+    const bool capped = remaining > kMaxSendBytes;
+    sqe->len = static_cast<std::uint32_t>(capped ? kMaxSendBytes : remaining);
+    // MSG_WAITALL makes a short send fail the link, so the next response in
+    // the chain can never overtake the unsent tail of this one.
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->user_data = PackUserData(Op::kSend, client_fd, length);
+    ++length;
+    // A capped send ends the chain; the rest of it goes in the next one.
+    if (capped || length == ring_conn.sending.size()) break;
+    sqe->flags |= IOSQE_IO_LINK;
+  }
+  ring_conn.inflight += length;
+  ring_conn.sends_outstanding = length;
+}
+
+void UringIoThread::CloseConnection(int client_fd, bool notify_main) {
+  const auto it = ring_connections_.find(client_fd);
+  if (it == ring_connections_.end()) return;
+  RingConnection& ring_conn = it->second;
+  ring_conn.closing = true;
+  ring_conn.notify_main = ring_conn.notify_main || notify_main;
+  ring_conn.pending.clear();
+
+  if (ring_conn.inflight > 0 && !ring_conn.cancel_submitted) {
+    if (io_uring_sqe* sqe = NextSqe(); sqe != nullptr) {
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = ring_conn.slot >= 0 ? ring_conn.slot : client_fd;
+      sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL |
+                          (ring_conn.slot >= 0 ? IORING_ASYNC_CANCEL_FD_FIXED : 0);
+      sqe->user_data = PackUserData(Op::kCancel, client_fd);
+      ring_conn.cancel_submitted = true;
+    }
+  }
+  FinishCloseIfIdle(client_fd);
+}
+
+void UringIoThread::FinishCloseIfIdle(int client_fd) {
+  const auto it = ring_connections_.find(client_fd);
+  if (it == ring_connections_.end()) return;
+  RingConnection& ring_conn = it->second;
+  if (!ring_conn.closing || ring_conn.inflight > 0) return;
+
+  ReleaseSlot(ring_conn);
+  const bool notify_main = ring_conn.notify_main;
+  ring_connections_.erase(it);
+  connections_.erase(client_fd);
+  // The main thread closes the fd once it has dropped its routing entry.
+  if (notify_main) {
+    Emit(Disconnect{client_fd});
+  } else {
+    close(client_fd);
+  }
+}
+
+void UringIoThread::FinishDetachIfIdle(int client_fd) {
+  const auto it = ring_connections_.find(client_fd);
+  if (it == ring_connections_.end()) return;
+  RingConnection& ring_conn = it->second;
+  if (!ring_conn.detaching || ring_conn.closing || ring_conn.inflight > 0) {
+    return;
+  }
+
+  ReleaseSlot(ring_conn);
+  Connection conn = std::move(connections_.at(client_fd));
+  for (SendChunk& chunk : ring_conn.pending) {
+    chunk.bytes.erase(0, chunk.sent);
+    conn.out_buffer.Append(std::move(chunk.bytes), Recycler());
+  }
+  ring_connections_.erase(it);
+  connections_.erase(client_fd);
+  EmitDetached(std::move(conn));
+}
+
+void UringIoThread::ReleaseSlot(RingConnection& ring_conn) {
+  if (ring_conn.slot < 0) return;
+  ring_->UpdateFile(static_cast<unsigned>(ring_conn.slot), -1);
+  free_slots_.push_back(static_cast<unsigned>(ring_conn.slot));
+  ring_conn.slot = -1;
+}
+
+void UringIoThread::Shutdown() {
+  std::vector<int> client_fds;
+  client_fds.reserve(ring_connections_.size());
+  for (const auto& [client_fd, ring_conn] : ring_connections_) {
+    client_fds.push_back(client_fd);
+  }
+  for (const int client_fd : client_fds) {
+    CloseConnection(client_fd, /*notify_main=*/false);
+  }
+  if (inbox_armed_) {
+    if (io_uring_sqe* sqe = NextSqe(); sqe != nullptr) {
+      sqe->opcode = IORING_OP_POLL_REMOVE;
+      sqe->addr = PackUserData(Op::kInboxPoll, InboxWaker().Fd());
+      sqe->user_data = PackUserData(Op::kCancel, InboxWaker().Fd());
+    }
+  }
+  if (soft_limit_armed_) {
+    if (io_uring_sqe* sqe = NextSqe(); sqe != nullptr) {
+      sqe->opcode = IORING_OP_POLL_REMOVE;
+      sqe->addr = PackUserData(Op::kSoftLimitPoll, SoftLimitTimerFd());
+      sqe->user_data = PackUserData(Op::kCancel, SoftLimitTimerFd());
+    }
+  }
+  if (accept_armed_) {
+    if (io_uring_sqe* sqe = NextSqe(); sqe != nullptr) {
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->addr = PackUserData(Op::kAccept, ListenFd());
+      sqe->user_data = PackUserData(Op::kCancel, ListenFd());
+    }
+  }
+  // Accepted but never registered with the main thread.
+  for (const int client_fd : accepted_) close(client_fd);
+  accepted_.clear();
+
+  while ((inbox_armed_ || soft_limit_armed_ || accept_armed_ ||
+          !ring_connections_.empty()) &&
+         ring_->SubmitAndWait(1) >= 0) {
+    ring_->ForEachCqe(
+        [this](const io_uring_cqe& cqe) { HandleCompletion(cqe); });
+  }
+  buffers_.reset();
+  ring_.reset();
+}
+
+io_uring_sqe* UringIoThread::NextSqe() {
+  io_uring_sqe* sqe = ring_->GetSqe();
+  if (sqe != nullptr) return sqe;
+  ring_->Submit();
+  return ring_->GetSqe();
+}
+
+void UringIoThread::SetTarget(io_uring_sqe* sqe, const int client_fd,
+                              const RingConnection& ring_conn) {
+  if (ring_conn.slot >= 0) {
+    sqe->fd = ring_conn.slot;
+    sqe->flags |= IOSQE_FIXED_FILE;
+  } else {
+    sqe->fd = client_fd;
+  }
+}
+
+}  // namespace myredis
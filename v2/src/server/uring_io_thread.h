@@ -0,0 +1,171 @@
+#ifndef MYREDIS_SERVER_URING_IO_THREAD_H_
+#define MYREDIS_SERVER_URING_IO_THREAD_H_
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "concurrent/ready_set.h"
+#include "network/io_uring.h"
+#include "server/io_thread.h"
+#include "server/messages.h"
+
+namespace myredis {
+
+// IoThread driven by io_uring completions instead of epoll readiness. Each
+// client has one multishot recv armed that the kernel completes straight into
+// a provided buffer ring, so steady-state reads cost no syscalls of their own;
+// responses go out as a chain of linked send SQEs; and client sockets sit in a
+// registered file table so SQEs skip the per-op fd lookup. Everything queued
+// during one pass over the completion queue is handed to the kernel with a
+// single io_uring_enter, which also waits for the next completions.
+//
+// The ring is single-issuer, so it is created, fed and torn down by the worker
+// thread inside Run().
+class UringIoThread final : public IoThread {
+ public:
+  UringIoThread(ReadySet& main_ready, std::size_t index, int listen_fd,
+                OutputBufferLimits output_limits);
+  ~UringIoThread() override;
+
+  UringIoThread(const UringIoThread&) = delete;
+  UringIoThread& operator=(const UringIoThread&) = delete;
+
+ private:
+  // What an SQE was submitted for; packed into its user_data with the client
+  // fd (and, for sends, the chunk's index in the chain).
+  enum class Op : std::uint8_t {
+    kInboxPoll,
+    kSoftLimitPoll,
+    kAccept,
+    kRecv,
+    kSend,
+    kCancel
+  };
+
+  // One response queued for (or in) a send chain, with how much of it the
+  // socket has already accepted.
+  struct SendChunk {
+    std::string bytes;
+    std::size_t sent = 0;
+  };
+
+  // io_uring bookkeeping for a connection, kept alongside its Connection.
+  struct RingConnection {
+    // Index into the registered file table, or -1 to use the raw fd.
+    int slot = -1;
+    bool recv_armed = false;
+    bool recv_cancel_submitted = false;
+    // On read_paused_, waiting for the outbox to have room.
+    bool read_paused = false;
+    // Set once the connection is being torn down. The fd stays open (so its
+    // number cannot be reused) until every SQE referencing it has completed.
+    bool closing = false;
+    // Set while the connection is being handed to another IO thread: reads
+    // are cancelled and no new send chain starts, and once nothing is in flight
+    // the Connection (with unsent replies) goes back to the main thread.
+    bool detaching = false;
+    bool cancel_submitted = false;
+    bool notify_main = false;
+    // Queued for the next send chain while this connection's pending list has
+    // not yet been submitted.
+    bool dirty = false;
+    // SQEs whose final completion has not arrived yet.
+    unsigned inflight = 0;
+    // Responses waiting for the current chain to finish.
+    std::vector<SendChunk> pending;
+    // The linked send chain in flight. Its buffers must stay put until every
+    // one of its completions has been reaped.
+    std::vector<SendChunk> sending;
+    unsigned sends_outstanding = 0;
+    // Reply bytes queued or in flight that the socket has not yet taken.
+    std::size_t unsent_bytes = 0;
+    bool send_failed = false;
+  };
+
+  void Run() override;
+
+  void HandleAssign(int client_fd) override;
+  void HandleWriteResponse(WriteResponse& response) override;
+  void HandleMigrate(int client_fd) override;
+  void HandleAdopt(Connection& connection) override;
+  void ResumeReads() override;
+
+  // Starts serving a client whose Connection is already in connections_:
+  // gives it a registered file slot and arms its recv.
+  void Watch(int client_fd);
+  // Queues `bytes` for the connection's next send chain.
+  void QueueSend(int client_fd, RingConnection& ring_conn, std::string bytes);
+
+  void HandleCompletion(const io_uring_cqe& cqe);
+  void HandleInboxPoll(const io_uring_cqe& cqe);
+  // Closes the clients stalled over the soft output limit.
+  void HandleSoftLimitPoll(const io_uring_cqe& cqe);
+  void HandleAccept(const io_uring_cqe& cqe);
+  void HandleRecv(int client_fd, const io_uring_cqe& cqe);
+  void HandleSend(int client_fd, std::size_t index, int result);
+
+  void ArmInboxPoll();
+  // Arms a multishot poll on SoftLimitTimerFd().
+  void ArmSoftLimitPoll();
+  // Arms a multishot accept on ListenFd().
+  void ArmAccept();
+  void ArmRecv(int client_fd, RingConnection& ring_conn);
+  void CancelRecv(int client_fd, RingConnection& ring_conn);
+  // Arms or cancels the connection's recv according to ReadsPaused.
+  void UpdateReading(int client_fd, RingConnection& ring_conn);
+  // Applies the output-buffer limits to the connection's unsent replies.
+  // Returns false if that closed it.
+  bool ApplyOutputLimits(int client_fd, RingConnection& ring_conn);
+  // Submits every dirty connection's pending responses as one linked chain.
+  void SubmitPendingSends();
+  // Leaves the connection dirty for the next pass if the SQ cannot take the
+  // whole chain.
+  void SubmitSendChain(int client_fd, RingConnection& ring_conn);
+
+  // Starts tearing down a connection: cancels its in-flight SQEs and finishes
+  // (handing the fd to the main thread to close, or closing it here when the
+  // main thread is not told) once they have completed.
+  void CloseConnection(int client_fd, bool notify_main);
+  void FinishCloseIfIdle(int client_fd);
+  // Emits the ConnectionDetached for a detaching connection once nothing of
+  // it is in flight.
+  void FinishDetachIfIdle(int client_fd);
+  // Returns the connection's registered file slot to the free list.
+  void ReleaseSlot(RingConnection& ring_conn);
+  // Cancels every in-flight SQE and reaps until none are left, so no late
+  // completion can touch a buffer after the ring is destroyed.
+  void Shutdown();
+
+  // Next free SQE, flushing the submission queue to the kernel if it is full.
+  // Returns nullptr only if that submit failed.
+  io_uring_sqe* NextSqe();
+  // Points `sqe` at the client socket, through the registered file table when
+  // the connection has a slot.
+  static void SetTarget(io_uring_sqe* sqe, int client_fd,
+                        const RingConnection& ring_conn);
+
+  std::unique_ptr<IoUring> ring_;
+  std::unique_ptr<BufferRing> buffers_;
+  std::unordered_map<int, RingConnection> ring_connections_;
+  std::vector<unsigned> free_slots_;
+  // Connections with responses queued since the last submit.
+  std::vector<int> dirty_;
+  // Clients accepted during the current pass over the CQ, registered with the
+  // main thread as one batch once the pass is done.
+  std::vector<int> accepted_;
+  // Connections whose recv was stopped because the outbox was full.
+  std::vector<int> read_paused_;
+  bool inbox_armed_ = false;
+  bool soft_limit_armed_ = false;
+  bool accept_armed_ = false;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_SERVER_URING_IO_THREAD_H_
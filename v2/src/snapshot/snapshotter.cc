@@ -112,8 +112,23 @@ void DurableWrite(const std::filesystem::path& output_path,
 }  // namespace
 
 void Snapshotter::Snapshot(const std::unique_ptr<Store>& store) {
-  const std::string store_json = store->SerialiseToJson();
+  Write(store->SerialiseToJson());
+}
+
+void Snapshotter::Snapshot(const std::span<const Store* const> shards) {
+  // Each shard's object, less its braces, is a list of members of the whole.
+  std::string store_json = "{";
+  for (const Store* shard : shards) {
+    const std::string shard_json = shard->SerialiseToJson();
+    if (shard_json.size() <= 2) continue;  // "{}"
+    if (store_json.size() > 1) store_json.push_back(',');
+    store_json.append(shard_json, 1, shard_json.size() - 2);
+  }
+  store_json.push_back('}');
+  Write(store_json);
+}
 
+void Snapshotter::Write(const std::string& store_json) {
   auto timestamp = duration_cast<std::chrono::milliseconds>(
                        std::chrono::system_clock::now().time_since_epoch())
                        .count();
@@ -125,6 +140,20 @@ void Snapshotter::Snapshot(const std::unique_ptr<Store>& store) {
 }
 
 bool Snapshotter::Restore(const std::unique_ptr<Store>& store) const {
+  return RestoreWith(
+      [&store](const std::string& json) { store->DeserialiseFromJson(json); });
+}
+
+bool Snapshotter::Restore(
+    const std::span<Store* const> shards,
+    const std::function<std::size_t(std::size_t hash)>& shard_of) const {
+  return RestoreWith([&](const std::string& json) {
+    Store::DeserialiseFromJson(json, shards, shard_of);
+  });
+}
+
+bool Snapshotter::RestoreWith(
+    const std::function<void(const std::string& json)>& load) const {
   const std::optional<std::filesystem::path> path =
       LatestSnapshot(output_dir_, snapshot_file_prefix_);
   if (!path) return true;
@@ -138,7 +167,7 @@ bool Snapshotter::Restore(const std::unique_ptr<Store>& store) const {
   buffer << stream.rdbuf();
 
   try {
-    store->DeserialiseFromJson(buffer.str());
+    load(buffer.str());
   } catch (const std::exception& e) {
     std::cerr << "Could not parse snapshot " << *path << ": " << e.what()
               << "\n";
@@ -1,8 +1,11 @@
 #ifndef MY_REDIS_SNAPSHOT_SNAPSHOTTER_H_
 #define MY_REDIS_SNAPSHOT_SNAPSHOTTER_H_
 
+#include <cstddef>
 #include <filesystem>
+#include <functional>
 #include <memory>
+#include <span>
 #include <string>
 #include <utility>
 
@@ -18,6 +21,9 @@ class Snapshotter {
         snapshot_file_prefix_(std::move(snapshot_file_prefix)) {}
 
   void Snapshot(const std::unique_ptr<Store>& store);
+  // Writes the union of `shards`, disjoint stores, as one snapshot, in the
+  // same format as a single store's.
+  void Snapshot(std::span<const Store* const> shards);
 
   // Restores `store` from the newest snapshot this Snapshotter would have
   // written: the file in output_dir_ named "<prefix><timestamp>.snapshot.json"
@@ -25,8 +31,19 @@ class Snapshotter {
   // but cannot be read or parsed; a missing snapshot is a normal first run and
   // returns true (leaving `store` untouched).
   bool Restore(const std::unique_ptr<Store>& store) const;
+  // Restores into `shards` as Store::DeserialiseFromJson does, from whichever
+  // snapshot Restore would use.
+  bool Restore(std::span<Store* const> shards,
+               const std::function<std::size_t(std::size_t hash)>& shard_of)
+      const;
 
  private:
+  void Write(const std::string& store_json);
+  // Reads the newest snapshot and hands it to `load`, which throws on bad
+  // data; see Restore.
+  bool RestoreWith(
+      const std::function<void(const std::string& json)>& load) const;
+
   const std::filesystem::path output_dir_;
   const std::string snapshot_file_prefix_;
 };
@@ -4,8 +4,8 @@
 
 namespace myredis {
 
-size_t StringHash(const std::string& key) {
-  constexpr std::hash<std::string> hasher;
+size_t StringHash(const std::string_view key) {
+  constexpr std::hash<std::string_view> hasher;
   return hasher(key);
 }
 
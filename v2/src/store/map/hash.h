@@ -2,11 +2,12 @@
 #define MYREDIS_STORE_HASH_H_
 
 #include <cstddef>
-#include <string>
+#include <string_view>
 
 namespace myredis {
 
-size_t StringHash(const std::string& key);
+// Equal to std::hash<std::string> of the same bytes.
+size_t StringHash(std::string_view key);
 size_t IntHash(int key);
 
 }  // namespace myredis
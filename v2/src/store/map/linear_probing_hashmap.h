@@ -80,7 +80,19 @@ class LinearProbingHashmap final : public Map<K, V> {
   }
 
   std::optional<std::reference_wrapper<V>> LookUp(const K& key) override {
-    const int value_bucket_index = InternalFind(key);
+    return LookUp(key, hash_(key));
+  }
+
+  void Insert(K key, V value) override {
+    const size_t hash = hash_(key);
+    Insert(std::move(key), std::move(value), hash);
+  }
+
+  void Remove(const K& key) override { Remove(key, hash_(key)); }
+
+  std::optional<std::reference_wrapper<V>> LookUp(const K& key,
+                                                  const size_t hash) override {
+    const int value_bucket_index = InternalFind(key, hash);
 
     if (value_bucket_index != -1) {
       assert(entries_[value_bucket_index].value.has_value());
@@ -91,13 +103,16 @@ class LinearProbingHashmap final : public Map<K, V> {
     return std::nullopt;
   }
 
-  void Insert(K key, V value) override {
-    InsertWithoutSize(std::move(key), std::move(value));
+  void Insert(K key, V value, const size_t hash) override {
+    if (size_ > load_factor_ * entries_.size()) {
+      Resize();
+    }
+    InsertWithoutSize(std::move(key), std::move(value), hash);
     size_++;
   }
 
-  void Remove(const K& key) override {
-    const int bucket_index = InternalFind(key);
+  void Remove(const K& key, const size_t hash) override {
+    const int bucket_index = InternalFind(key, hash);
     if (bucket_index != -1) {
       entries_[bucket_index].state = DELETED;
     }
@@ -113,12 +128,8 @@ class LinearProbingHashmap final : public Map<K, V> {
   }
 
  private:
-  void InsertWithoutSize(K key, V value) {
-    if (size_ > load_factor_ * entries_.size()) {
-      Resize();
-    }
-
-    size_t bucket_index = hash_(key) % entries_.size();
+  void InsertWithoutSize(K key, V value, const size_t hash) {
+    size_t bucket_index = hash % entries_.size();
     while (entries_[bucket_index].state == ELEMENT &&
            entries_[bucket_index].key.has_value() &&
            entries_[bucket_index].key.value() != key) {
@@ -140,14 +151,15 @@ class LinearProbingHashmap final : public Map<K, V> {
       if (entry.state != ELEMENT) continue;
 
       assert(entry.key.has_value() && entry.value.has_value());
+      const size_t hash = hash_(entry.key.value());
       InsertWithoutSize(std::move(entry.key.value()),
-                        std::move(entry.value.value()));
+                        std::move(entry.value.value()), hash);
     }
   }
 
   // Returns -1 if key cannot be found
-  int InternalFind(const K& key) {
-    size_t bucket_index = hash_(key) % entries_.size();
+  int InternalFind(const K& key, const size_t hash) {
+    size_t bucket_index = hash % entries_.size();
     const size_t initial_bucket_index = bucket_index;
 
     while (entries_[bucket_index].state == DELETED ||
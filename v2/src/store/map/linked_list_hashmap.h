@@ -27,8 +27,8 @@ class LinkedListHashmap final : public Map<K, V> {
   std::vector<std::unique_ptr<Entry>> entries_;
   double load_factor_;
 
-  void InsertWithoutResize(K key, V value) {
-    const size_t bucket_index = hash_(key) % entries_.size();
+  void InsertWithoutResize(K key, V value, const size_t hash) {
+    const size_t bucket_index = hash % entries_.size();
     if (entries_[bucket_index] == nullptr) {
       entries_[bucket_index] =
           std::make_unique<Entry>(std::move(key), std::move(value));
@@ -62,7 +62,8 @@ class LinkedListHashmap final : public Map<K, V> {
     entries_.resize(std::max(static_cast<size_t>(2), size_ * 2));
     size_ = 0;
     for (auto& [key, value] : flat_entries) {
-      InsertWithoutResize(std::move(key), std::move(value));
+      const size_t hash = hash_(key);
+      InsertWithoutResize(std::move(key), std::move(value), hash);
     }
   }
 
@@ -96,8 +97,20 @@ class LinkedListHashmap final : public Map<K, V> {
   }
 
   std::optional<std::reference_wrapper<V>> LookUp(const K& key) override {
+    return LookUp(key, hash_(key));
+  }
+
+  void Insert(K key, V value) override {
+    const size_t hash = hash_(key);
+    Insert(std::move(key), std::move(value), hash);
+  }
+
+  void Remove(const K& key) override { Remove(key, hash_(key)); }
+
+  std::optional<std::reference_wrapper<V>> LookUp(const K& key,
+                                                  const size_t hash) override {
     if (entries_.empty()) return std::nullopt;
-    Entry* curr_entry = entries_[hash_(key) % entries_.size()].get();
+    Entry* curr_entry = entries_[hash % entries_.size()].get();
     while (curr_entry != nullptr && curr_entry->key != key) {
       curr_entry = curr_entry->next.get();
     }
@@ -108,16 +121,16 @@ class LinkedListHashmap final : public Map<K, V> {
     return std::nullopt;
   }
 
-  void Insert(K key, V value) override {
+  void Insert(K key, V value, const size_t hash) override {
     if (entries_.empty() || size_ > entries_.size() * load_factor_) {
       Resize();
     }
-    InsertWithoutResize(std::move(key), std::move(value));
+    InsertWithoutResize(std::move(key), std::move(value), hash);
   }
 
-  void Remove(const K& key) override {
+  void Remove(const K& key, const size_t hash) override {
     if (entries_.empty()) return;
-    const size_t bucket_index = hash_(key) % entries_.size();
+    const size_t bucket_index = hash % entries_.size();
     if (entries_[bucket_index] == nullptr) return;
     if (entries_[bucket_index]->key == key) {
       entries_[bucket_index] = std::move(entries_[bucket_index]->next);
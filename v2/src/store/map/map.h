@@ -1,6 +1,7 @@
 #ifndef MYREDIS_STORE_MAP_H_
 #define MYREDIS_STORE_MAP_H_
 
+#include <cstddef>
 #include <functional>
 #include <optional>
 
@@ -20,6 +21,14 @@ class Map {
 
   virtual void Remove(const K& key) = 0;
 
+  // The same, given `hash`: what the map's hash function gives for `key`,
+  // computed ahead of time (e.g. on another thread) so that it is not hashed
+  // again here.
+  virtual std::optional<std::reference_wrapper<V>> LookUp(const K& key,
+                                                          size_t hash) = 0;
+  virtual void Insert(K key, V value, size_t hash) = 0;
+  virtual void Remove(const K& key, size_t hash) = 0;
+
   virtual void ForEach(std::function<void(const K&, V&)> action) = 0;
 };
 
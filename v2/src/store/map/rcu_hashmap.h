@@ -0,0 +1,210 @@
+#ifndef MYREDIS_STORE_RCU_HASHMAP_H_
+#define MYREDIS_STORE_RCU_HASHMAP_H_
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "concurrent/epoch_domain.h"
+#include "store/map/map.h"
+
+namespace myredis {
+
+// A chained hashmap that one thread writes (through the Map interface) while
+// others Read it at the same time, without locks: read-copy-update, with
+// epoch-based reclamation (see EpochDomain).
+//
+// A published item (key and value) is never modified: Insert over an
+// existing key publishes a new item in its place, and the old one is retired
+// along with anything Remove unlinks. Growing builds a new bucket array over
+// the same items and publishes it whole. Readers therefore always see one
+// complete item or another, and the writer never waits for them.
+//
+// The writer may read items in place through LookUp and ForEach, but not
+// modify them while readers may be about: Insert a changed copy instead.
+template <typename K, typename V>
+class RcuHashmap final : public Map<K, V> {
+ public:
+  // `readers` is how many threads may Read at once, each with a reader number
+  // of its own below it.
+  RcuHashmap(const double load_factor, std::function<size_t(const K&)> hash,
+             const std::size_t readers)
+      : hash_(std::move(hash)),
+        load_factor_(load_factor),
+        epochs_(readers),
+        table_(new Table(kDefaultCapacity)) {}
+
+  ~RcuHashmap() override {
+    Table* table = table_.load(std::memory_order_relaxed);
+    for (const auto& bucket : table->buckets) {
+      Node* node = bucket.load(std::memory_order_relaxed);
+      while (node != nullptr) {
+        Node* next = node->next.load(std::memory_order_relaxed);
+        delete node->item.load(std::memory_order_relaxed);
+        delete node;
+        node = next;
+      }
+    }
+    delete table;
+  }
+
+  RcuHashmap(const RcuHashmap&) = delete;
+  RcuHashmap& operator=(const RcuHashmap&) = delete;
+
+  // Calls `visit(const V&)` with the value of `key` (anything comparable with
+  // K), if present, and returns whether it was. The value is only valid
+  // during the call. Safe to call concurrently with the writer and other
+  // readers, each with its own `reader` number.
+  template <typename Probe, typename Visit>
+  bool Read(const std::size_t reader, const Probe& key, const size_t hash,
+            Visit&& visit) {
+    const EpochDomain::Guard guard = epochs_.Pin(reader);
+    const Table* table = table_.load(std::memory_order_acquire);
+    const Node* node =
+        table->buckets[hash & table->mask].load(std::memory_order_acquire);
+    for (; node != nullptr; node = node->next.load(std::memory_order_acquire)) {
+      if (node->hash != hash) continue;
+      const Item* item = node->item.load(std::memory_order_acquire);
+      if (item->key == key) {
+        visit(std::as_const(item->value));
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::optional<std::reference_wrapper<V>> LookUp(const K& key) override {
+    return LookUp(key, hash_(key));
+  }
+
+  void Insert(K key, V value) override {
+    const size_t hash = hash_(key);
+    Insert(std::move(key), std::move(value), hash);
+  }
+
+  void Remove(const K& key) override { Remove(key, hash_(key)); }
+
+  std::optional<std::reference_wrapper<V>> LookUp(const K& key,
+                                                  const size_t hash) override {
+    Node* node = Find(key, hash, nullptr);
+    if (node == nullptr) return std::nullopt;
+    return std::ref(node->item.load(std::memory_order_relaxed)->value);
+  }
+
+  void Insert(K key, V value, const size_t hash) override {
+    auto* item = new Item{std::move(key), std::move(value)};
+    if (Node* node = Find(item->key, hash, nullptr)) {
+      epochs_.Retire(node->item.exchange(item, std::memory_order_acq_rel));
+      return;
+    }
+    Table* table = table_.load(std::memory_order_relaxed);
+    if (size_ + 1 > static_cast<double>(table->buckets.size()) * load_factor_) {
+      table = Grow(table);
+    }
+    std::atomic<Node*>& head = table->buckets[hash & table->mask];
+    head.store(new Node(hash, item, head.load(std::memory_order_relaxed)),
+               std::memory_order_release);
+    ++size_;
+  }
+
+  void Remove(const K& key, const size_t hash) override {
+    std::atomic<Node*>* link = nullptr;
+    Node* node = Find(key, hash, &link);
+    if (node == nullptr) return;
+    link->store(node->next.load(std::memory_order_relaxed),
+                std::memory_order_release);
+    epochs_.Retire(node->item.load(std::memory_order_relaxed));
+    epochs_.Retire(node);
+    --size_;
+  }
+
+  void ForEach(std::function<void(const K&, V&)> action) override {
+    for (const auto& bucket : table_.load(std::memory_order_relaxed)->buckets) {
+      for (Node* node = bucket.load(std::memory_order_relaxed); node != nullptr;
+           node = node->next.load(std::memory_order_relaxed)) {
+        Item* item = node->item.load(std::memory_order_relaxed);
+        action(item->key, item->value);
+      }
+    }
+  }
+
+ private:
+  struct Item {
+    K key;
+    V value;
+  };
+  struct Node {
+    Node(const size_t hash, Item* item, Node* next)
+        : hash(hash), item(item), next(next) {}
+
+    const size_t hash;
+    std::atomic<Item*> item;
+    std::atomic<Node*> next;
+  };
+  // A power of two buckets, so that a hash is reduced with a mask.
+  struct Table {
+    explicit Table(const size_t size) : mask(size - 1), buckets(size) {}
+
+    const size_t mask;
+    std::vector<std::atomic<Node*>> buckets;
+  };
+
+  // The node holding `key`, or nullptr. If `link` is given, it is set to the
+  // pointer to that node (the bucket's, or the previous node's `next`).
+  // Writer only.
+  Node* Find(const K& key, const size_t hash, std::atomic<Node*>** link) {
+    Table* table = table_.load(std::memory_order_relaxed);
+    std::atomic<Node*>* to = &table->buckets[hash & table->mask];
+    for (Node* node = to->load(std::memory_order_relaxed); node != nullptr;
+         node = to->load(std::memory_order_relaxed)) {
+      if (node->hash == hash &&
+          node->item.load(std::memory_order_relaxed)->key == key) {
+        if (link != nullptr) *link = to;
+        return node;
+      }
+      to = &node->next;
+    }
+    return nullptr;
+  }
+
+  // Publishes a table twice the size of `table`, with new nodes over the
+  // same items, and retires `table` and its nodes (but not the items).
+  Table* Grow(Table* table) {
+    auto* grown = new Table(table->buckets.size() * 2);
+    for (const auto& bucket : table->buckets) {
+      for (Node* node = bucket.load(std::memory_order_relaxed); node != nullptr;
+           node = node->next.load(std::memory_order_relaxed)) {
+        std::atomic<Node*>& head = grown->buckets[node->hash & grown->mask];
+        head.store(new Node(node->hash,
+                            node->item.load(std::memory_order_relaxed),
+                            head.load(std::memory_order_relaxed)),
+                   std::memory_order_relaxed);
+      }
+    }
+    table_.store(grown, std::memory_order_release);
+    for (const auto& bucket : table->buckets) {
+      Node* node = bucket.load(std::memory_order_relaxed);
+      while (node != nullptr) {
+        Node* next = node->next.load(std::memory_order_relaxed);
+        epochs_.Retire(node);
+        node = next;
+      }
+    }
+    epochs_.Retire(table);
+    return grown;
+  }
+
+  std::function<size_t(const K&)> hash_;
+  const double load_factor_;
+  EpochDomain epochs_;
+  std::atomic<Table*> table_;
+  size_t size_ = 0;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_STORE_RCU_HASHMAP_H_
@@ -1,6 +1,7 @@
 #ifndef MYREDIS_STORE_STANDARD_MAP_H_
 #define MYREDIS_STORE_STANDARD_MAP_H_
 
+#include <cstddef>
 #include <functional>
 #include <optional>
 #include <unordered_map>
@@ -33,9 +34,7 @@ class StandardMap final : public Map<K, V> {
   }
 
   std::optional<std::reference_wrapper<V>> LookUp(const K& key) override {
-    const auto iter = data_.find(key);
-    if (iter == data_.end()) return std::nullopt;
-    return std::optional<std::reference_wrapper<V>>(std::ref(iter->second));
+    return Found(data_.find(key));
   }
 
   void Insert(K key, V value) override {
@@ -44,6 +43,27 @@ class StandardMap final : public Map<K, V> {
 
   void Remove(const K& key) override { data_.erase(key); }
 
+  std::optional<std::reference_wrapper<V>> LookUp(const K& key,
+                                                  const size_t hash) override {
+    return Found(data_.find(Prehashed{key, hash}));
+  }
+
+  // std::unordered_map cannot be told the hash of a key it inserts, so only
+  // replacing an existing key's value avoids hashing it again.
+  void Insert(K key, V value, const size_t hash) override {
+    const auto iter = data_.find(Prehashed{key, hash});
+    if (iter != data_.end()) {
+      iter->second = std::move(value);
+      return;
+    }
+    data_.emplace(std::move(key), std::move(value));
+  }
+
+  void Remove(const K& key, const size_t hash) override {
+    const auto iter = data_.find(Prehashed{key, hash});
+    if (iter != data_.end()) data_.erase(iter);
+  }
+
   void ForEach(std::function<void(const K&, V&)> action) override {
     for (auto& [key, value] : data_) {
       action(key, value);
@@ -51,7 +71,38 @@ class StandardMap final : public Map<K, V> {
   }
 
  private:
-  std::unordered_map<K, V> data_;
+  // A key to look up along with its hash (see the hash-taking overloads).
+  struct Prehashed {
+    const K& key;
+    size_t hash;
+  };
+  // std::hash, except that a Prehashed key brings its own; transparent, so
+  // that find() takes a Prehashed as it is.
+  struct Hash {
+    using is_transparent = void;
+    size_t operator()(const K& key) const { return std::hash<K>{}(key); }
+    size_t operator()(const Prehashed& key) const { return key.hash; }
+  };
+  struct Equal {
+    using is_transparent = void;
+    bool operator()(const K& lhs, const K& rhs) const { return lhs == rhs; }
+    bool operator()(const Prehashed& lhs, const K& rhs) const {
+      return lhs.key == rhs;
+    }
+    bool operator()(const K& lhs, const Prehashed& rhs) const {
+      return lhs == rhs.key;
+    }
+  };
+
+  using Data = std::unordered_map<K, V, Hash, Equal>;
+
+  std::optional<std::reference_wrapper<V>> Found(
+      const typename Data::iterator iter) {
+    if (iter == data_.end()) return std::nullopt;
+    return std::optional<std::reference_wrapper<V>>(std::ref(iter->second));
+  }
+
+  Data data_;
 };
 
 }  // namespace myredis
@@ -0,0 +1,175 @@
+#ifndef MYREDIS_STORE_STRIPED_HASHMAP_H_
+#define MYREDIS_STORE_STRIPED_HASHMAP_H_
+
+#include <bit>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "store/map/map.h"
+
+namespace myredis {
+
+// A chained hashmap split into stripes, each a table of its own behind a lock
+// of its own, so that threads using keys of different stripes never contend.
+// A key's stripe is picked by its hash.
+//
+// Locking is left to the caller, so that it can make several operations on a
+// key atomic (e.g. look an entry up, then change it): the Map operations on a
+// key are only safe while holding Lock(hash of that key), and ForEach while
+// holding LockAll. Unlocked, it is a plain single-threaded map.
+//
+// A stripe grows on its own, under its own lock: a resize holds up the keys
+// of that stripe only, never the whole map.
+template <typename K, typename V>
+class StripedHashmap final : public Map<K, V> {
+ public:
+  static constexpr size_t kDefaultStripes = 64;
+
+  // `stripes` must be a power of two.
+  StripedHashmap(const double load_factor, std::function<size_t(const K&)> hash,
+                 const size_t stripes = kDefaultStripes)
+      : hash_(std::move(hash)),
+        load_factor_(load_factor),
+        stripe_mask_(stripes - 1),
+        stripe_bits_(std::countr_zero(stripes)),
+        stripes_(stripes) {}
+
+  StripedHashmap(const StripedHashmap&) = delete;
+  StripedHashmap& operator=(const StripedHashmap&) = delete;
+
+  // The lock of the stripe of the key hashing to `hash`.
+  [[nodiscard]] std::unique_lock<std::mutex> Lock(const size_t hash) {
+    return std::unique_lock(StripeOf(hash).mutex);
+  }
+  // Every stripe's lock, always taken in the same order.
+  [[nodiscard]] std::vector<std::unique_lock<std::mutex>> LockAll() {
+    std::vector<std::unique_lock<std::mutex>> locks;
+    locks.reserve(stripes_.size());
+    for (Stripe& stripe : stripes_) locks.emplace_back(stripe.mutex);
+    return locks;
+  }
+
+  std::optional<std::reference_wrapper<V>> LookUp(const K& key) override {
+    return LookUp(key, hash_(key));
+  }
+
+  void Insert(K key, V value) override {
+    const size_t hash = hash_(key);
+    Insert(std::move(key), std::move(value), hash);
+  }
+
+  void Remove(const K& key) override { Remove(key, hash_(key)); }
+
+  std::optional<std::reference_wrapper<V>> LookUp(const K& key,
+                                                  const size_t hash) override {
+    Stripe& stripe = StripeOf(hash);
+    for (Entry* entry = stripe.buckets[BucketOf(stripe, hash)].get();
+         entry != nullptr; entry = entry->next.get()) {
+      if (entry->hash == hash && entry->key == key) return std::ref(entry->value);
+    }
+    return std::nullopt;
+  }
+
+  void Insert(K key, V value, const size_t hash) override {
+    if (auto found = LookUp(key, hash)) {
+      found->get() = std::move(value);
+      return;
+    }
+    Stripe& stripe = StripeOf(hash);
+    if (stripe.size + 1 >
+        static_cast<double>(stripe.buckets.size()) * load_factor_) {
+      Grow(stripe);
+    }
+    std::unique_ptr<Entry>& head = stripe.buckets[BucketOf(stripe, hash)];
+    head = std::make_unique<Entry>(std::move(key), std::move(value), hash,
+                                   std::move(head));
+    ++stripe.size;
+  }
+
+  void Remove(const K& key, const size_t hash) override {
+    Stripe& stripe = StripeOf(hash);
+    std::unique_ptr<Entry>* link = &stripe.buckets[BucketOf(stripe, hash)];
+    while (*link != nullptr) {
+      if ((*link)->hash == hash && (*link)->key == key) {
+        *link = std::move((*link)->next);
+        --stripe.size;
+        return;
+      }
+      link = &(*link)->next;
+    }
+  }
+
+  void ForEach(std::function<void(const K&, V&)> action) override {
+    for (Stripe& stripe : stripes_) {
+      for (const auto& bucket : stripe.buckets) {
+        for (Entry* entry = bucket.get(); entry != nullptr;
+             entry = entry->next.get()) {
+          action(entry->key, entry->value);
+        }
+      }
+    }
+  }
+
+ private:
+  struct Entry {
+    Entry(K key, V value, const size_t hash, std::unique_ptr<Entry> next)
+        : key(std::move(key)),
+          value(std::move(value)),
+          hash(hash),
+          next(std::move(next)) {}
+
+    K key;
+    V value;
+    size_t hash;
+    std::unique_ptr<Entry> next;
+  };
+
+  // On a cache line of its own, so that threads locking neighbouring stripes
+  // do not contend for one.
+  struct alignas(64) Stripe {
+    std::mutex mutex;
+    // A power of two of them.
+    std::vector<std::unique_ptr<Entry>> buckets =
+        std::vector<std::unique_ptr<Entry>>(kDefaultCapacity);
+    size_t size = 0;
+  };
+
+  Stripe& StripeOf(const size_t hash) { return stripes_[hash & stripe_mask_]; }
+  // From the bits above those that picked the stripe, which are the same for
+  // all of its keys.
+  size_t BucketOf(const Stripe& stripe, const size_t hash) const {
+    return (hash >> stripe_bits_) & (stripe.buckets.size() - 1);
+  }
+
+  // Doubles the buckets of `stripe`, relinking its entries rather than
+  // moving them.
+  void Grow(Stripe& stripe) {
+    std::vector<std::unique_ptr<Entry>> buckets(stripe.buckets.size() * 2);
+    stripe.buckets.swap(buckets);
+    for (std::unique_ptr<Entry>& bucket : buckets) {
+      while (bucket != nullptr) {
+        std::unique_ptr<Entry> entry = std::move(bucket);
+        bucket = std::move(entry->next);
+        std::unique_ptr<Entry>& head =
+            stripe.buckets[BucketOf(stripe, entry->hash)];
+        entry->next = std::move(head);
+        head = std::move(entry);
+      }
+    }
+  }
+
+  std::function<size_t(const K&)> hash_;
+  const double load_factor_;
+  const size_t stripe_mask_;
+  const int stripe_bits_;
+  std::vector<Stripe> stripes_;
+};
+
+}  // namespace myredis
+
+#endif  // MYREDIS_STORE_STRIPED_HASHMAP_H_
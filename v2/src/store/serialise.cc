@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <stdexcept>
 #include <string>
+#include <string_view>
 
 namespace myredis {
 
@@ -17,7 +18,7 @@ constexpr uint8_t kNibbleMask = 0xf;
 
 }  // namespace
 
-void AppendJsonString(const std::string& value, std::string& out) {
+void AppendJsonString(std::string_view value, std::string& out) {
   out.push_back('"');
   for (const char character : value) {
     switch (character) {
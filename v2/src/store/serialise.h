@@ -4,12 +4,13 @@
 #include <cstddef>
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace myredis {
 
 // Appends value as a JSON string literal (surrounded by quotes, with the
 // characters required by RFC 8259 escaped) to out.
-void AppendJsonString(const std::string& value, std::string& out);
+void AppendJsonString(std::string_view value, std::string& out);
 
 // Skips JSON insignificant whitespace starting at pos.
 void SkipWhitespace(const std::string& data, size_t& pos);
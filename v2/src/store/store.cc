@@ -2,43 +2,92 @@
 
 #include <cstdint>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <stdexcept>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "store/map/hash.h"
 #include "store/map/standard_map.h"
 #include "store/serialise.h"
 
 namespace myredis {
 
-Store::Store(std::unique_ptr<Time> time)
-    : data_(std::make_unique<StandardMap<std::string, Entry>>()),
-      time_(std::move(time)) {}
+Store::Store(std::unique_ptr<Time> time, const StoreConcurrency concurrency)
+    : time_(std::move(time)) {
+  // Hashed with StringHash, so that the hashes computed for requests are the
+  // map's own.
+  const auto hash = [](const std::string& key) { return StringHash(key); };
+  if (concurrency.striped) {
+    auto map = std::make_unique<StripedHashmap<std::string, Entry>>(
+        kDefaultLoadFactor, hash);
+    striped_ = map.get();
+    data_ = std::move(map);
+  } else if (concurrency.readers > 0) {
+    auto map = std::make_unique<RcuHashmap<std::string, Entry>>(
+        kDefaultLoadFactor, hash, concurrency.readers);
+    concurrent_ = map.get();
+    data_ = std::move(map);
+  } else {
+    data_ = std::make_unique<StandardMap<std::string, Entry>>();
+  }
+}
+
+Store::Value::Value(std::string bytes) {
+  if (bytes.size() >= kShareBytes) {
+    // Moved, not copied, so a large value still reaches the store without
+    // ever being copied.
+    bytes_ = std::make_shared<const std::string>(std::move(bytes));
+  } else {
+    bytes_ = std::move(bytes);
+  }
+}
+
+std::string_view Store::Value::Bytes() const {
+  if (const auto* shared = Shared()) return **shared;
+  return std::get<std::string>(bytes_);
+}
 
 [[nodiscard]] std::optional<std::string> Store::Get(
     const std::string& key) const {
-  const auto found = data_->LookUp(key);
-  if (!found.has_value()) return std::nullopt;
-  if (found->get().expiry_ != NO_EXPIRY &&
-      found->get().expiry_ < time_->NowMs())
-    return std::nullopt;
-  return found->get().value_;
+  std::optional<std::string> copy;
+  VisitValue(key, StringHash(key), [&copy](const Value& value) {
+    copy.emplace(value.Bytes());
+  });
+  return copy;
 }
 
-void Store::Set(std::string key, std::optional<std::string> value) {
-  data_->Insert(std::move(key), Entry(std::move(value)));
+const Store::Value* Store::Peek(const std::string& key,
+                                const std::size_t hash) const {
+  const auto found = data_->LookUp(key, hash);
+  if (!found.has_value()) return nullptr;
+  const Entry& entry = found->get();
+  if (Expired(entry)) return nullptr;
+  return entry.value_.has_value() ? &*entry.value_ : nullptr;
 }
 
-void Store::Del(const std::string& key) { data_->Remove(key); }
+void Store::Set(std::string key, const std::size_t hash,
+                std::optional<std::string> value) {
+  const std::unique_lock<std::mutex> lock = LockKey(hash);
+  data_->Insert(std::move(key), Entry(std::move(value)), hash);
+}
 
-bool Store::ExpireAt(const std::string& key, int64_t timestamp_ms) {
-  return ExpireAt(key, timestamp_ms, ExpireOption::NA);
+void Store::Del(const std::string& key, const std::size_t hash) {
+  const std::unique_lock<std::mutex> lock = LockKey(hash);
+  data_->Remove(key, hash);
 }
 
-bool Store::ExpireAt(const std::string& key, int64_t timestamp_ms,
-                      ExpireOption option) {
-  const auto found = data_->LookUp(key);
+bool Store::ExpireAt(const std::string& key, const std::size_t hash,
+                     int64_t timestamp_ms) {
+  return ExpireAt(key, hash, timestamp_ms, ExpireOption::NA);
+}
+
+bool Store::ExpireAt(const std::string& key, const std::size_t hash,
+                     int64_t timestamp_ms, ExpireOption option) {
+  const std::unique_lock<std::mutex> lock = LockKey(hash);
+  const auto found = data_->LookUp(key, hash);
   if (!found.has_value()) return false;
   Entry& entry = *found;
 
@@ -66,13 +115,15 @@ bool Store::ExpireAt(const std::string& key, int64_t timestamp_ms,
       break;
   }
 
-  entry.expiry_ = timestamp_ms;
+  SetExpiry(key, hash, entry, timestamp_ms);
 
   return true;
 }
 
-[[nodiscard]] std::int64_t Store::Ttl(const std::string& key) {
-  const auto found = data_->LookUp(key);
+[[nodiscard]] std::int64_t Store::Ttl(const std::string& key,
+                                      const std::size_t hash) {
+  const std::unique_lock<std::mutex> lock = LockKey(hash);
+  const auto found = data_->LookUp(key, hash);
   if (!found.has_value()) return -2;  // Key does not exist
   Entry& entry = *found;
   if (entry.expiry_ == NO_EXPIRY) return -1;  // Key exists but has no TTL
@@ -83,17 +134,54 @@ bool Store::ExpireAt(const std::string& key, int64_t timestamp_ms,
 
 [[nodiscard]] std::int64_t Store::NowMs() const { return time_->NowMs(); }
 
-bool Store::Persist(const std::string& key) {
-  const auto found = data_->LookUp(key);
+bool Store::Persist(const std::string& key, const std::size_t hash) {
+  const std::unique_lock<std::mutex> lock = LockKey(hash);
+  const auto found = data_->LookUp(key, hash);
   if (!found.has_value()) return false;
   Entry& entry = *found;
   if (entry.expiry_ == NO_EXPIRY) return false;
   if (entry.expiry_ < time_->NowMs()) return false;  // Key has expired
-  entry.expiry_ = NO_EXPIRY;
+  SetExpiry(key, hash, entry, NO_EXPIRY);
   return true;
 }
 
+std::int64_t Store::ReadTtl(const std::size_t reader, const std::string_view key,
+                            const std::size_t hash) const {
+  std::int64_t ttl = -2;  // Key does not exist
+  concurrent_->Read(reader, key, hash, [&](const Entry& entry) {
+    if (entry.expiry_ == NO_EXPIRY) {
+      ttl = -1;
+      return;
+    }
+    const std::int64_t remaining_ms = entry.expiry_ - time_->NowMs();
+    if (remaining_ms > 0) ttl = remaining_ms;
+  });
+  return ttl;
+}
+
+std::unique_lock<std::mutex> Store::LockKey(const std::size_t hash) const {
+  if (striped_ == nullptr) return {};
+  return striped_->Lock(hash);
+}
+
+std::vector<std::unique_lock<std::mutex>> Store::LockAll() const {
+  if (striped_ == nullptr) return {};
+  return striped_->LockAll();
+}
+
+void Store::SetExpiry(const std::string& key, const std::size_t hash,
+                      Entry& entry, const int64_t expiry) {
+  if (concurrent_ == nullptr) {
+    entry.expiry_ = expiry;
+    return;
+  }
+  Entry updated = entry;
+  updated.expiry_ = expiry;
+  concurrent_->Insert(key, std::move(updated), hash);
+}
+
 [[nodiscard]] std::string Store::SerialiseToJson() const {
+  const std::vector<std::unique_lock<std::mutex>> locks = LockAll();
   std::string out = "{";
   bool first = true;
 
@@ -104,7 +192,7 @@ bool Store::Persist(const std::string& key) {
     AppendJsonString(key, out);
     out += ":{\"value\":";
     if (entry.value_.has_value()) {
-      AppendJsonString(*entry.value_, out);
+      AppendJsonString(entry.value_->Bytes(), out);
     } else {
       out += "null";
     }
@@ -170,6 +258,24 @@ Store::Entry Store::ParseEntryJson(const std::string& json_data, size_t& pos) {
 }
 
 void Store::DeserialiseFromJson(const std::string& json_data) {
+  ParseJson(json_data, [this](std::string key, Entry entry) {
+    data_->Insert(std::move(key), std::move(entry));
+  });
+}
+
+void Store::DeserialiseFromJson(
+    const std::string& json_data, const std::span<Store* const> shards,
+    const std::function<std::size_t(std::size_t hash)>& shard_of) {
+  ParseJson(json_data, [&](std::string key, Entry entry) {
+    const std::size_t hash = StringHash(key);
+    shards[shard_of(hash)]->data_->Insert(std::move(key), std::move(entry),
+                                          hash);
+  });
+}
+
+void Store::ParseJson(
+    const std::string& json_data,
+    const std::function<void(std::string key, Entry entry)>& insert) {
   size_t pos = 0;
   SkipWhitespace(json_data, pos);
   if (pos >= json_data.size() || json_data[pos] != '{') {
@@ -192,7 +298,7 @@ void Store::DeserialiseFromJson(const std::string& json_data) {
       pos++;
 
       SkipWhitespace(json_data, pos);
-      data_->Insert(std::move(key), ParseEntryJson(json_data, pos));
+      insert(std::move(key), ParseEntryJson(json_data, pos));
 
       SkipWhitespace(json_data, pos);
       if (pos >= json_data.size()) {
@@ -1,36 +1,103 @@
 #ifndef MYREDIS_STORE_STORE_H_
 #define MYREDIS_STORE_STORE_H_
 
+#include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
 
 #include "store/map/map.h"
+#include "store/map/rcu_hashmap.h"
+#include "store/map/striped_hashmap.h"
 #include "time/time.h"
 
 namespace myredis {
 
+// How a Store may be shared between threads.
+struct StoreConcurrency {
+  // Read-concurrent: up to this many other threads may read the store through
+  // ReadValue and ReadTtl while its one thread writes it, and never block or
+  // slow that writer down (the map is then an RcuHashmap).
+  std::size_t readers = 0;
+  // Striped: any number of threads may use every operation at once, each
+  // one atomic under a lock on its key's stripe (the map is then a
+  // StripedHashmap). Operations on one key are applied in the order they
+  // take its lock; on keys of different stripes, in parallel.
+  bool striped = false;
+};
+
 // The server's key/value store. Facade over a Map<string, optional<string>>:
 // callers (handlers, snapshotting) work with Get/Set/Del/SerialiseToJson
 // rather than the generic Map interface, so the concrete map implementation
 // stays an implementation detail of Store.
+//
+// A store is used by one thread, unless made otherwise (see
+// StoreConcurrency).
 class Store {
  public:
-  explicit Store(std::unique_ptr<Time> time);
+  explicit Store(std::unique_ptr<Time> time,
+                 StoreConcurrency concurrency = {});
 
   Store(const Store&) = delete;
   Store& operator=(const Store&) = delete;
 
+  // Values of this many bytes or more are stored shared, so that a reply can
+  // hold on to one (see Value::Shared) and leave copying it out to an IO
+  // thread. Smaller ones are cheaper to copy than to share, whose reference
+  // count both threads would then touch.
+  static constexpr std::size_t kShareBytes = 512;
+
+  // A stored, non-null value. It is never modified in place, only replaced,
+  // so its shared bytes stay valid and unchanged for whoever holds them.
+  class Value {
+   public:
+    explicit Value(std::string bytes);
+
+    [[nodiscard]] std::string_view Bytes() const;
+    // The value's bytes as shared, or nullptr for one under kShareBytes.
+    [[nodiscard]] const std::shared_ptr<const std::string>* Shared() const {
+      return std::get_if<std::shared_ptr<const std::string>>(&bytes_);
+    }
+
+   private:
+    std::variant<std::string, std::shared_ptr<const std::string>> bytes_;
+  };
+
+  // The operations below that take a key's `hash` as well expect
+  // StringHash(key), typically computed by the IO thread that parsed the
+  // request, so that the executor does not hash the key again.
+
   [[nodiscard]] std::optional<std::string> Get(const std::string& key) const;
 
-  void Set(std::string key, std::optional<std::string> value);
+  // Like Get without the copy: calls `visit(const Value&)` with the stored
+  // value, only valid during the call, and returns whether it did: not if
+  // the key is absent, expired or holds a null value.
+  template <typename Visit>
+  bool VisitValue(const std::string& key, const std::size_t hash,
+                  Visit&& visit) const {
+    const std::unique_lock<std::mutex> lock = LockKey(hash);
+    const Value* value = Peek(key, hash);
+    if (value == nullptr) return false;
+    visit(*value);
+    return true;
+  }
+
+  void Set(std::string key, std::size_t hash,
+           std::optional<std::string> value);
 
-  void Del(const std::string& key);
+  void Del(const std::string& key, std::size_t hash);
 
   // Follows the standard redis except NA means not applicable
   enum ExpireOption : std::uint8_t { NX, XX, GT, LT, NA };
-  static std::optional<ExpireOption> ToExpireOption(const std::string& option) {
+  static std::optional<ExpireOption> ToExpireOption(std::string_view option) {
     if (option == "NX") return ExpireOption::NX;
     if (option == "XX") return ExpireOption::XX;
     if (option == "GT") return ExpireOption::GT;
@@ -41,21 +108,47 @@ class Store {
   // timestamp is an absolute unix time in milliseconds (essentially
   // pexpireat) — callers compute it from whatever relative/absolute unit
   // their command takes.
-  bool ExpireAt(const std::string& key, int64_t timestamp_ms);
-  bool ExpireAt(const std::string& key, int64_t timestamp_ms,
+  bool ExpireAt(const std::string& key, std::size_t hash,
+                int64_t timestamp_ms);
+  bool ExpireAt(const std::string& key, std::size_t hash, int64_t timestamp_ms,
                 ExpireOption option);
 
-  std::int64_t Ttl(const std::string& key);
+  std::int64_t Ttl(const std::string& key, std::size_t hash);
+
+  // Reads for other threads than the writer, in read-concurrent stores only.
+  // `reader` is the calling thread's own number, below concurrent_readers.
+  //
+  // ReadValue calls `visit(std::string_view)` with the bytes of the value of
+  // `key`, only valid during the call, and returns whether it did: not if the
+  // key is absent, expired or holds a null value. ReadTtl is Ttl.
+  template <typename Visit>
+  bool ReadValue(std::size_t reader, std::string_view key, std::size_t hash,
+                 Visit&& visit) const {
+    bool found = false;
+    concurrent_->Read(reader, key, hash, [&](const Entry& entry) {
+      if (!entry.value_.has_value() || Expired(entry)) return;
+      found = true;
+      visit(entry.value_->Bytes());
+    });
+    return found;
+  }
+  [[nodiscard]] std::int64_t ReadTtl(std::size_t reader, std::string_view key,
+                                     std::size_t hash) const;
 
   // Removes key's TTL. Returns false if the key doesn't exist (or has
   // already expired) or has no TTL to remove.
-  bool Persist(const std::string& key);
+  bool Persist(const std::string& key, std::size_t hash);
 
   // Current store-observed time in milliseconds, for callers (e.g. the
   // EXPIRE/PEXPIRE handlers) that need to turn a relative TTL into the
   // absolute timestamp ExpireAt expects.
   [[nodiscard]] std::int64_t NowMs() const;
 
+  // Every stripe's lock, if the store is striped: no other thread is in the
+  // middle of an operation on it while they are held (e.g. across a fork).
+  // Not to be held while calling the operations above.
+  [[nodiscard]] std::vector<std::unique_lock<std::mutex>> LockAll() const;
+
   // Serialises the store to a JSON object mapping each key to its value. A
   // key whose value is absent (std::nullopt) is serialised as JSON null.
   [[nodiscard]] std::string SerialiseToJson() const;
@@ -63,25 +156,55 @@ class Store {
   // Populates the store from JSON produced by SerialiseToJson. Throws
   // std::invalid_argument if json_data is malformed.
   void DeserialiseFromJson(const std::string& json_data);
+  // Like DeserialiseFromJson, but spreads the keys over `shards`: each goes
+  // to shards[shard_of(StringHash(key))].
+  static void DeserialiseFromJson(
+      const std::string& json_data, std::span<Store* const> shards,
+      const std::function<std::size_t(std::size_t hash)>& shard_of);
 
  private:
   static constexpr int64_t NO_EXPIRY = -1;
 
   struct Entry {
     int64_t expiry_ = NO_EXPIRY;
-    std::optional<std::string> value_;
+    std::optional<Value> value_;
     explicit Entry(std::optional<std::string> value)
-        : value_(std::move(value)) {}
-    Entry(std::optional<std::string> value, int64_t expiry)
-        : expiry_(expiry), value_(std::move(value)) {}
+        : Entry(std::move(value), NO_EXPIRY) {}
+    Entry(std::optional<std::string> value, int64_t expiry) : expiry_(expiry) {
+      if (value.has_value()) value_.emplace(std::move(*value));
+    }
   };
 
+  // The stored value, or nullptr if the key is absent, expired or holds a
+  // null value. Valid until the store next changes.
+  [[nodiscard]] const Value* Peek(const std::string& key,
+                                  std::size_t hash) const;
+  // The lock on the key hashing to `hash`, if the store is striped.
+  [[nodiscard]] std::unique_lock<std::mutex> LockKey(std::size_t hash) const;
+
+  [[nodiscard]] bool Expired(const Entry& entry) const {
+    return entry.expiry_ != NO_EXPIRY && entry.expiry_ < time_->NowMs();
+  }
+  // Sets the expiry of `entry`, the value of `key`: in place, unless the
+  // store is read-concurrent, where it is replaced with a copy instead.
+  void SetExpiry(const std::string& key, std::size_t hash, Entry& entry,
+                 int64_t expiry);
+
   // Parses one {"value":...,"expiry":...} entry object at json_data[pos],
   // advancing pos past its closing '}'. Throws std::invalid_argument if
   // json_data is malformed.
   static Entry ParseEntryJson(const std::string& json_data, size_t& pos);
+  // Parses a whole SerialiseToJson object, calling `insert` with each entry.
+  // Throws std::invalid_argument if json_data is malformed.
+  static void ParseJson(
+      const std::string& json_data,
+      const std::function<void(std::string key, Entry entry)>& insert);
 
   std::unique_ptr<Map<std::string, Entry>> data_;
+  // data_, if the store is read-concurrent; otherwise nullptr.
+  RcuHashmap<std::string, Entry>* concurrent_ = nullptr;
+  // data_, if the store is striped; otherwise nullptr.
+  StripedHashmap<std::string, Entry>* striped_ = nullptr;
   std::unique_ptr<Time> time_;
 };
 
@@ -0,0 +1,419 @@
+#include <gtest/gtest.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "concurrent/epoch_domain.h"
+#include "concurrent/ready_set.h"
+#include "concurrent/single_consumer_producer_queue.h"
+#include "concurrent/waker.h"
+#include "server/connection.h"
+#include "server/epoll_io_thread.h"
+#include "server/io_thread.h"
+#include "server/messages.h"
+
+using myredis::Connection;
+using myredis::EpochDomain;
+using myredis::EpollIoThread;
+using myredis::IoThread;
+using myredis::OutputBufferLimits;
+using myredis::ReadySet;
+using myredis::SingleConsumerProducerQueue;
+using myredis::Waker;
+using myredis::WriteResponse;
+
+namespace {
+
+// Drains `ready` and returns the indices it visited, in visiting order.
+std::vector<std::size_t> DrainAll(ReadySet& ready) {
+  std::vector<std::size_t> visited;
+  ready.Drain(
+      [&visited](const std::size_t index) { visited.push_back(index); });
+  return visited;
+}
+
+// Whether `fd` is readable right now.
+bool Readable(const int fd) {
+  pollfd pfd{.fd = fd, .events = POLLIN, .revents = 0};
+  return poll(&pfd, 1, 0) == 1;
+}
+
+}  // namespace
+
+TEST(ReadySetTest, DrainVisitsMarkedIndicesOnceInOrder) {
+  ReadySet ready(8);
+  ready.Mark(5);
+  ready.Mark(1);
+  ready.Mark(5);
+  EXPECT_EQ(DrainAll(ready), (std::vector<std::size_t>{1, 5}));
+  EXPECT_TRUE(DrainAll(ready).empty());
+}
+
+TEST(ReadySetTest, IndicesSpanSeveralWords) {
+  ReadySet ready(200);
+  for (const std::size_t index : {199, 0, 64, 63, 128}) ready.Mark(index);
+  EXPECT_EQ(DrainAll(ready), (std::vector<std::size_t>{0, 63, 64, 128, 199}));
+}
+
+TEST(ReadySetTest, MarkOnlyWakesAParkedConsumer) {
+  ReadySet ready(4);
+  ready.Mark(0);
+  EXPECT_FALSE(Readable(ready.Fd()));
+  // Something is marked, so the consumer must not park.
+  EXPECT_FALSE(ready.PrepareToPark());
+  DrainAll(ready);
+
+  ASSERT_TRUE(ready.PrepareToPark());
+  ready.Mark(3);
+  EXPECT_TRUE(Readable(ready.Fd()));
+  ready.Unpark();
+  ready.ResetWakeup();
+  EXPECT_FALSE(Readable(ready.Fd()));
+  EXPECT_EQ(DrainAll(ready), (std::vector<std::size_t>{3}));
+}
+
+TEST(ReadySetTest, NoMarkIsLostUnderConcurrentProducers) {
+  constexpr std::size_t kProducers = 4;
+  constexpr int kMarksPerProducer = 20000;
+  ReadySet ready(kProducers);
+  // Each producer only marks again once the consumer has seen its last mark,
+  // so every mark must be observed for the test to finish.
+  std::vector<std::atomic<int>> seen(kProducers);
+
+  std::vector<std::thread> producers;
+  for (std::size_t p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&ready, &seen, p] {
+      for (int i = 0; i < kMarksPerProducer; ++i) {
+        while (seen[p].load(std::memory_order_acquire) != i) {
+          std::this_thread::yield();
+        }
+        ready.Mark(p);
+      }
+    });
+  }
+
+  constexpr int kTotal = static_cast<int>(kProducers) * kMarksPerProducer;
+  int total = 0;
+  while (total < kTotal) {
+    ready.Drain([&seen, &total](const std::size_t index) {
+      seen[index].fetch_add(1, std::memory_order_release);
+      ++total;
+    });
+    if (total < kTotal && ready.PrepareToPark()) {
+      pollfd pfd{.fd = ready.Fd(), .events = POLLIN, .revents = 0};
+      ASSERT_EQ(poll(&pfd, 1, 5000), 1) << "a mark was lost";
+      ready.Unpark();
+      ready.ResetWakeup();
+    }
+  }
+  for (std::thread& producer : producers) producer.join();
+}
+
+TEST(WakerTest, NotifyOnlyWritesTheEventFdWhenParked) {
+  Waker waker;
+  waker.Notify();
+  EXPECT_FALSE(Readable(waker.Fd()));
+
+  ASSERT_TRUE(waker.PrepareToPark([] { return false; }));
+  waker.Notify();
+  EXPECT_TRUE(Readable(waker.Fd()));
+  waker.Unpark();
+  waker.Drain();
+  EXPECT_FALSE(Readable(waker.Fd()));
+  // Only the first Notify of a park wakes.
+  waker.Notify();
+  EXPECT_FALSE(Readable(waker.Fd()));
+}
+
+TEST(WakerTest, DoesNotParkWithWorkPending) {
+  Waker waker;
+  EXPECT_FALSE(waker.PrepareToPark([] { return true; }));
+  waker.Notify();
+  EXPECT_FALSE(Readable(waker.Fd()));
+}
+
+TEST(WakerTest, NoWakeupIsLostInPingPong) {
+  constexpr int kRounds = 20000;
+  Waker waker;
+  std::atomic<int> posted{0};
+
+  std::thread producer([&waker, &posted] {
+    for (int i = 1; i <= kRounds; ++i) {
+      posted.store(i, std::memory_order_relaxed);
+      waker.Notify();
+      // Give the consumer a chance to park between rounds now and then.
+      if (i % 64 == 0) std::this_thread::yield();
+    }
+  });
+
+  int consumed = 0;
+  while (consumed < kRounds) {
+    consumed = posted.load(std::memory_order_relaxed);
+    const auto has_work = [&posted, consumed] {
+      return posted.load(std::memory_order_relaxed) != consumed;
+    };
+    if (consumed < kRounds && waker.PrepareToPark(has_work)) {
+      pollfd pfd{.fd = waker.Fd(), .events = POLLIN, .revents = 0};
+      ASSERT_EQ(poll(&pfd, 1, 5000), 1) << "a wakeup was lost";
+      waker.Unpark();
+      waker.Drain();
+    }
+  }
+  producer.join();
+}
+
+TEST(SingleConsumerProducerQueueTest, HoldsExactlyNElementsInOrder) {
+  SingleConsumerProducerQueue<int, 4> queue;
+  for (int i = 0; i < 4; ++i) EXPECT_TRUE(queue.Emplace(i));
+  EXPECT_FALSE(queue.Push(4));
+  EXPECT_EQ(queue.Size(), 4u);
+  for (int i = 0; i < 4; ++i) EXPECT_EQ(queue.Pop(), i);
+  EXPECT_EQ(queue.Pop(), std::nullopt);
+  // Wraps around the ring.
+  for (int round = 0; round < 10; ++round) {
+    EXPECT_TRUE(queue.Emplace(round));
+    EXPECT_EQ(queue.Pop(), round);
+  }
+}
+
+TEST(SingleConsumerProducerQueueTest, FailedPushLeavesTheElementIntact) {
+  SingleConsumerProducerQueue<std::unique_ptr<int>, 1> queue;
+  EXPECT_TRUE(queue.Push(std::make_unique<int>(1)));
+  auto element = std::make_unique<int>(2);
+  EXPECT_FALSE(queue.Push(std::move(element)));
+  ASSERT_NE(element, nullptr);
+  EXPECT_EQ(*element, 2);
+
+  EXPECT_TRUE(queue.Consume([](std::unique_ptr<int>& e) { EXPECT_EQ(*e, 1); }));
+  EXPECT_TRUE(queue.Push(std::move(element)));
+  EXPECT_EQ(element, nullptr);
+}
+
+TEST(SingleConsumerProducerQueueTest, PushBatchTakesWhatFits) {
+  SingleConsumerProducerQueue<std::string, 4> queue;
+  EXPECT_TRUE(queue.Push("a"));
+  std::vector<std::string> batch{"b", "c", "d", "e"};
+  EXPECT_EQ(queue.PushBatch(batch.begin(), batch.end()), 3u);
+  // The element that did not fit is left as it was.
+  EXPECT_EQ(batch[3], "e");
+
+  std::vector<std::string> popped;
+  EXPECT_EQ(queue.PopBatch([&popped](std::string& s) {
+    popped.push_back(std::move(s));
+  }),
+            4u);
+  EXPECT_EQ(popped, (std::vector<std::string>{"a", "b", "c", "d"}));
+  EXPECT_EQ(queue.PopBatch([](std::string&) {}), 0u);
+}
+
+TEST(SingleConsumerProducerQueueTest, PopBatchHonoursMax) {
+  SingleConsumerProducerQueue<int, 8> queue;
+  for (int i = 0; i < 5; ++i) EXPECT_TRUE(queue.Emplace(i));
+  int sum = 0;
+  EXPECT_EQ(queue.PopBatch([&sum](const int i) { sum += i; }, 2), 2u);
+  EXPECT_EQ(sum, 1);
+  EXPECT_TRUE(queue.Consume([](const int i) { EXPECT_EQ(i, 2); }));
+  EXPECT_EQ(queue.Size(), 2u);
+}
+
+TEST(SingleConsumerProducerQueueTest, DestroysEveryElement) {
+  const auto tracked = std::make_shared<int>(0);
+  {
+    SingleConsumerProducerQueue<std::shared_ptr<int>, 4> queue;
+    for (int i = 0; i < 3; ++i) EXPECT_TRUE(queue.Emplace(tracked));
+    EXPECT_TRUE(queue.Consume([](std::shared_ptr<int>&) {}));
+    EXPECT_EQ(tracked.use_count(), 3);
+  }
+  EXPECT_EQ(tracked.use_count(), 1);
+}
+
+TEST(SingleConsumerProducerQueueTest, TransfersEverythingAcrossThreads) {
+  constexpr int kCount = 100000;
+  SingleConsumerProducerQueue<int, 64> queue;
+  std::thread producer([&queue] {
+    std::vector<int> pending;
+    int next = 0;
+    while (next < kCount || !pending.empty()) {
+      // Alternate single pushes with batches.
+      if (pending.empty() && next % 3 != 0) {
+        if (queue.Emplace(next)) ++next;
+      } else {
+        while (pending.size() < 16 && next < kCount) pending.push_back(next++);
+        const std::size_t pushed =
+            queue.PushBatch(pending.begin(), pending.end());
+        pending.erase(pending.begin(), pending.begin() + pushed);
+      }
+      if (next == kCount && pending.empty()) break;
+      std::this_thread::yield();
+    }
+  });
+
+  int expected = 0;
+  while (expected < kCount) {
+    const std::size_t popped = queue.PopBatch([&expected](const int value) {
+      ASSERT_EQ(value, expected);
+      ++expected;
+    });
+    if (popped == 0) std::this_thread::yield();
+  }
+  producer.join();
+}
+
+namespace {
+
+// Counts its destruction, to see when an EpochDomain frees it.
+struct Retiree {
+  explicit Retiree(int& freed) : freed(freed) {}
+  ~Retiree() { ++freed; }
+
+  int& freed;
+};
+
+}  // namespace
+
+TEST(EpochDomainTest, PinnedReaderHoldsBackOnlyWhatItMayHaveSeen) {
+  int freed = 0;
+  EpochDomain epochs(2);
+  {
+    const EpochDomain::Guard guard = epochs.Pin(1);
+    epochs.Retire(new Retiree(freed));
+    for (int i = 0; i < 4; ++i) epochs.Reclaim();
+    EXPECT_EQ(freed, 0);
+  }
+  // Two epochs on from the retirement, with the reader gone.
+  epochs.Reclaim();
+  epochs.Reclaim();
+  EXPECT_EQ(freed, 1);
+
+  epochs.Retire(new Retiree(freed));
+  {
+    // Pinned after the retirement: cannot have seen it, yet still holds the
+    // epoch back, as the domain cannot tell.
+    const EpochDomain::Guard guard = epochs.Pin(0);
+    for (int i = 0; i < 4; ++i) epochs.Reclaim();
+    EXPECT_EQ(freed, 1);
+  }
+  epochs.Reclaim();
+  epochs.Reclaim();
+  EXPECT_EQ(freed, 2);
+}
+
+TEST(EpochDomainTest, FreesWhatIsLeftOnDestruction) {
+  int freed = 0;
+  {
+    EpochDomain epochs(1);
+    for (int i = 0; i < 3; ++i) epochs.Retire(new Retiree(freed));
+    EXPECT_EQ(freed, 0);
+  }
+  EXPECT_EQ(freed, 3);
+}
+
+namespace {
+
+// A connected, non-blocking socket pair: [0] for the IoThread, [1] for the
+// test to read what it writes from.
+std::array<int, 2> SocketPair() {
+  std::array<int, 2> fds{-1, -1};
+  EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds.data()),
+            0);
+  return fds;
+}
+
+// Reply number `seq` to the client with `id` on `fd`: just the number.
+WriteResponse Reply(const int fd, const std::uint64_t id,
+                    const std::uint64_t seq) {
+  return WriteResponse{.fd = fd,
+                       .client_id = id,
+                       .seq = seq,
+                       .bytes = std::to_string(seq) + "\n"};
+}
+
+// Replies [0, count), as the client reads them.
+std::string Replies(const std::uint64_t count) {
+  std::string replies;
+  for (std::uint64_t seq = 0; seq < count; ++seq) {
+    replies += std::to_string(seq) + "\n";
+  }
+  return replies;
+}
+
+}  // namespace
+
+TEST(IoThreadTest, BackloggedMessagesArriveInOrder) {
+  ReadySet main_ready(1);
+  EpollIoThread io_thread(main_ready, 0, /*listen_fd=*/-1,
+                          OutputBufferLimits{});
+  const std::array<int, 2> a = SocketPair();
+  const std::array<int, 2> b = SocketPair();
+  Connection client_a(a[0]);
+  Connection client_b(b[0]);
+  const std::uint64_t id_a = client_a.id;
+  const std::uint64_t id_b = client_b.id;
+
+  // Nothing drains the inbox before Start: client a's adoption and replies
+  // fill it, and the rest of them wait in the backlog, b's adoption behind.
+  constexpr std::uint64_t kRepliesToA = IoThread::kQueueCapacity + 100;
+  constexpr std::uint64_t kRepliesToB = 50;
+  io_thread.PostAdopt(std::move(client_a));
+  for (std::uint64_t seq = 0; seq < kRepliesToA; ++seq) {
+    io_thread.PostResponse(Reply(a[0], id_a, seq));
+  }
+  io_thread.PostAdopt(std::move(client_b));
+  constexpr std::uint64_t kBacklogged =
+      1 + kRepliesToA + 1 - IoThread::kQueueCapacity;
+  EXPECT_EQ(io_thread.Stats().inbox_overflows, kBacklogged);
+  EXPECT_EQ(io_thread.Stats().inbox_backlog, kBacklogged);
+
+  // Once the thread has emptied its inbox it asks for the backlog. Replies
+  // to b posted now, with room in the inbox, must still queue behind the
+  // backlog, or they would arrive before b's adoption and be dropped.
+  io_thread.Start();
+  ASSERT_TRUE(main_ready.PrepareToPark());
+  pollfd wakeup{.fd = main_ready.Fd(), .events = POLLIN, .revents = 0};
+  ASSERT_EQ(poll(&wakeup, 1, 5000), 1) << "the backlog was never asked for";
+  main_ready.Unpark();
+  main_ready.ResetWakeup();
+  for (std::uint64_t seq = 0; seq < kRepliesToB; ++seq) {
+    io_thread.PostResponse(Reply(b[0], id_b, seq));
+  }
+  EXPECT_EQ(io_thread.Stats().inbox_overflows, kBacklogged + kRepliesToB);
+  EXPECT_EQ(io_thread.Stats().inbox_backlog, kBacklogged + kRepliesToB);
+
+  // Play the main thread, flushing the backlog whenever asked, until both
+  // clients have every reply.
+  const std::string expected_a = Replies(kRepliesToA);
+  const std::string expected_b = Replies(kRepliesToB);
+  std::string received_a;
+  std::string received_b;
+  std::array<char, 4096> chunk{};
+  const auto all_received = [&] {
+    return received_a.size() >= expected_a.size() &&
+           received_b.size() >= expected_b.size();
+  };
+  for (int passes = 0; passes < 5000 && !all_received(); ++passes) {
+    main_ready.Drain([&io_thread](std::size_t) { io_thread.FlushBacklog(); });
+    for (const auto& [fd, received] :
+         {std::pair{a[1], &received_a}, std::pair{b[1], &received_b}}) {
+      const ssize_t n = read(fd, chunk.data(), chunk.size());
+      if (n > 0) received->append(chunk.data(), n);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(received_a, expected_a);
+  EXPECT_EQ(received_b, expected_b);
+  EXPECT_EQ(io_thread.Stats().inbox_backlog, 0u);
+
+  io_thread.Stop();
+  for (const int fd : {a[0], a[1], b[0], b[1]}) close(fd);
+}
@@ -41,17 +41,18 @@ port_open() {
   return 1
 }
 
-# start_server <port> — launches a fresh server listening on <port> with
-# snapshotting disabled, and waits for it to actually service commands.
+# start_server <port> [server_arg...] — launches a fresh server listening on
+# <port> with snapshotting disabled (plus any extra flags given), and waits for
+# it to actually service commands.
 start_server() {
-  local port="$1"
+  local port="$1"; shift
   if [[ -z "${SERVER_BIN:-}" || ! -x "$SERVER_BIN" ]]; then
     echo "error: my_redis_server binary not found; build v2 first " \
          "(cmake -B build/v2/debug -S v2 -DCMAKE_BUILD_TYPE=Debug && " \
          "cmake --build build/v2/debug) or set SERVER_BIN explicitly" >&2
     exit 1
   fi
-  "$SERVER_BIN" -p "$port" -s 0 >"$SERVER_LOG" 2>&1 &
+  "$SERVER_BIN" -p "$port" -s 0 "$@" >"$SERVER_LOG" 2>&1 &
   SERVER_PID=$!
 
   local tries=100
@@ -115,6 +116,18 @@ send_command() {
   printf '%s' "$reply"
 }
 
+# send_pipeline <port> — writes every request read from stdin in one go on a
+# single connection and prints all the replies read back within the timeout.
+send_pipeline() {
+  local port="$1"
+  local reply
+  exec 9<>"/dev/tcp/$HOST/$port"
+  cat >&9
+  reply="$(timeout 1 cat <&9)"
+  exec 9>&- 9<&-
+  printf '%s' "$reply"
+}
+
 # expect_eq <description> <actual> <expected>
 expect_eq() {
   local desc="$1" actual="$2" expected="$3"
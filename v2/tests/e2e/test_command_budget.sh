@@ -0,0 +1,54 @@
+#!/usr/bin/env bash
+# e2e test for --command-budget: a pipeline is executed a few commands at a
+# time, taking turns with other clients', yet every reply still comes back
+# whole and in request order.
+set -uo pipefail
+source "$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)/lib.sh"
+
+PORT=6406
+start_server "$PORT" --command-budget 3 --io-threads 2
+
+count=500
+expect_eq "a pipeline far over the budget is answered in order" \
+  "$(send_pipeline "$PORT" < <(for i in $(seq 1 "$count"); do
+                                 resp_encode SET "key$i" "v$i"
+                                 resp_encode GET "key$i"
+                               done))" \
+  "$(for i in $(seq 1 "$count"); do
+       printf '+OK\r\n$%d\r\n%s\r\n' "$(( ${#i} + 1 ))" "v$i"
+     done)"
+
+# One client overwrites a key over and over in a long pipeline while another
+# reads it: the reader always sees one of the values written (the key holds
+# w0 before the pipeline starts), and the writer's last one once both are
+# done. Which clients run when is covered by BatchScheduler's unit tests.
+expect_eq "the shared key starts at w0" \
+  "$(send_command "$PORT" SET shared w0)" \
+  "$(printf '+OK\r\n')"
+exec 7<>"/dev/tcp/$HOST/$PORT"
+for i in $(seq 1 "$count"); do resp_encode SET shared "w$i"; done >&7
+expect_eq "a reader during the pipeline sees one of its values" \
+  "$(send_command "$PORT" GET shared | tr -d '\r' | sed -n '2s/^w[0-9]*$/ok/p')" \
+  "ok"
+writes="$(timeout 1 cat <&7)"
+exec 7>&- 7<&-
+expect_eq "the long pipeline got every reply" \
+  "$(grep -c '^+OK' <<<"$(tr -d '\r' <<<"$writes")")" \
+  "$count"
+expect_eq "its last write is the one left" \
+  "$(send_command "$PORT" GET shared)" \
+  "$(printf '$4\r\nw%d\r\n' "$count")"
+
+stop_server
+
+start_server "$PORT" --command-budget 3 --executors 2 --io-threads 2
+expect_eq "executors split pipelines the same way" \
+  "$(send_pipeline "$PORT" < <(for i in $(seq 1 "$count"); do
+                                 resp_encode SET "key$i" "v$i"
+                                 resp_encode GET "key$i"
+                               done))" \
+  "$(for i in $(seq 1 "$count"); do
+       printf '+OK\r\n$%d\r\n%s\r\n' "$(( ${#i} + 1 ))" "v$i"
+     done)"
+
+summary
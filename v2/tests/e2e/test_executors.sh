@@ -0,0 +1,49 @@
+#!/usr/bin/env bash
+# e2e test for --executors (server/executor.h): the keyspace is split over
+# several executor threads by hash slot, each with a store of its own, and
+# replies still come back in request order.
+set -uo pipefail
+source "$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)/lib.sh"
+
+PORT=6403
+start_server "$PORT" --executors 4 --io-threads 2
+
+expect_eq "INFO reports the executors" \
+  "$(send_command "$PORT" INFO server | tr -d '\r' |
+     sed -n 's/^executors://p')" \
+  "4"
+
+keys=(alpha bravo charlie delta echo foxtrot golf hotel india juliet)
+
+sets="$(for key in "${keys[@]}"; do resp_encode SET "$key" "v-$key"; done)"
+expect_eq "SETs on keys of every executor are answered in order" \
+  "$(send_pipeline "$PORT" <<<"$sets")" \
+  "$(for key in "${keys[@]}"; do printf '+OK\r\n'; done)"
+
+gets="$(for key in "${keys[@]}"; do resp_encode GET "$key"; done)"
+expect_eq "each key is found again, whichever executor owns it" \
+  "$(send_pipeline "$PORT" <<<"$gets")" \
+  "$(for key in "${keys[@]}"; do
+       printf '$%d\r\n%s\r\n' "$(( ${#key} + 2 ))" "v-$key"
+     done)"
+
+expect_eq "keyless and unknown commands keep their place among the rest" \
+  "$(send_pipeline "$PORT" < <(resp_encode GET alpha; resp_encode PING;
+                               resp_encode DEL bravo; resp_encode NOPE;
+                               resp_encode GET bravo; resp_encode ECHO e;
+                               resp_encode GET charlie))" \
+  "$(printf -- '$7\r\nv-alpha\r\n+PONG\r\n:1\r\n%s\r\n$-1\r\n%b\r\n' \
+       '-Unknown subcommand or command' '$1\r\ne\r\n$9\r\nv-charlie')"
+
+big="$(head -c 100000 /dev/zero | tr '\0' 'x')"
+expect_eq "a large value split off with its request reaches its executor" \
+  "$(send_pipeline "$PORT" < <(resp_encode SET big "$big";
+                               resp_encode SET small v;
+                               resp_encode GET small) | tr -d '\r')" \
+  "$(printf '+OK\n+OK\n$1\nv')"
+
+expect_eq "the large value is stored whole" \
+  "$(send_command "$PORT" GET big)" \
+  "$(printf '$100000\r\n%s\r\n' "$big")"
+
+summary
@@ -0,0 +1,26 @@
+#!/usr/bin/env bash
+# e2e test for InfoRequestHandler (server/handler/info_request_handler.h).
+set -uo pipefail
+source "$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)/lib.sh"
+
+PORT=6401
+start_server "$PORT" --io-threads 2
+
+expect_eq "INFO server replies with just the Server section" \
+  "$(send_command "$PORT" INFO server)" \
+  "$(printf '$37\r\n# Server\r\nio_threads:2\r\nexecutors:1\r\n\r\n')"
+
+expect_eq "section names are case-insensitive" \
+  "$(send_command "$PORT" INFO CLIENTS | sed -n 2p)" \
+  "$(printf '# Clients\r')"
+
+expect_eq "INFO with no args includes every section" \
+  "$(send_command "$PORT" INFO | grep -c '^# ')" \
+  "3"
+
+# Nothing here comes close to filling a 1024-slot queue.
+expect_eq "an idle server reports no queue overflows" \
+  "$(send_command "$PORT" INFO stats | grep -c 'overflows:0')" \
+  "2"
+
+summary
@@ -0,0 +1,45 @@
+#!/usr/bin/env bash
+# e2e test for --io-encode-replies: large values (Store::kShareBytes and up)
+# are referenced by the main thread and copied into replies by the IO thread.
+set -uo pipefail
+source "$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)/lib.sh"
+
+PORT=6402
+start_server "$PORT" --io-encode-replies
+
+big="$(head -c 4000 /dev/zero | tr '\0' 'x')"
+other="$(head -c 600 /dev/zero | tr '\0' 'y')"
+
+expect_eq "SET of a large value replies OK" \
+  "$(send_command "$PORT" SET big "$big")" \
+  "$(printf '+OK\r\n')"
+
+expect_eq "GET returns the whole large value" \
+  "$(send_command "$PORT" GET big)" \
+  "$(printf '$4000\r\n%s\r\n' "$big")"
+
+expect_eq "SET of a small value replies OK" \
+  "$(send_command "$PORT" SET small v)" \
+  "$(printf '+OK\r\n')"
+
+expect_eq "GET of a small value is answered as before" \
+  "$(send_command "$PORT" GET small)" \
+  "$(printf '$1\r\nv\r\n')"
+
+expect_eq "deferred replies keep their place in a pipeline" \
+  "$(send_pipeline "$PORT" < <(resp_encode SET other "$other";
+                               resp_encode GET big; resp_encode GET small;
+                               resp_encode GET other; resp_encode DEL big;
+                               resp_encode GET big))" \
+  "$(printf '+OK\r\n$4000\r\n%s\r\n$1\r\nv\r\n$600\r\n%s\r\n:1\r\n$-1\r\n' \
+       "$big" "$other")"
+
+# The reply to the first GET holds on to the value; replacing the key must
+# not change what that reply carries, nor what a later GET sees.
+expect_eq "a value replaced right after a GET is replied as it was" \
+  "$(send_pipeline "$PORT" < <(resp_encode GET other;
+                               resp_encode SET other "$big";
+                               resp_encode GET other))" \
+  "$(printf '$600\r\n%s\r\n+OK\r\n$4000\r\n%s\r\n' "$other" "$big")"
+
+summary
@@ -0,0 +1,57 @@
+#!/usr/bin/env bash
+# e2e test for --io-execute: IO threads execute the commands on keys
+# themselves, on one lock-striped store, and only INFO reaches the main
+# thread; replies still come back in request order.
+set -uo pipefail
+source "$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)/lib.sh"
+
+PORT=6405
+start_server "$PORT" --io-execute --io-threads 2
+
+io_commands() {
+  send_command "$PORT" INFO stats | tr -d '\r' |
+    sed -n 's/^io_commands_processed://p'
+}
+
+before="$(io_commands)"
+expect_eq "SET replies OK" \
+  "$(send_command "$PORT" SET key value)" \
+  "$(printf '+OK\r\n')"
+expect_eq "GET finds the value" \
+  "$(send_command "$PORT" GET key)" \
+  "$(printf '$5\r\nvalue\r\n')"
+expect_eq "the commands were executed on the IO threads" \
+  "$(( $(io_commands) - before ))" \
+  "2"
+
+keys=(alpha bravo charlie delta echo foxtrot golf hotel india juliet)
+expect_eq "a pipeline over many keys is answered in order" \
+  "$(send_pipeline "$PORT" < <(for key in "${keys[@]}"; do
+                                 resp_encode SET "$key" "v-$key"
+                                 resp_encode GET "$key"
+                               done))" \
+  "$(for key in "${keys[@]}"; do
+       printf '+OK\r\n$%d\r\n%s\r\n' "$(( ${#key} + 2 ))" "v-$key"
+     done)"
+
+expect_eq "expiry commands see each other's effects" \
+  "$(send_pipeline "$PORT" < <(resp_encode EXPIRE alpha 100;
+                               resp_encode TTL alpha;
+                               resp_encode PERSIST alpha;
+                               resp_encode PTTL alpha;
+                               resp_encode DEL alpha; resp_encode GET alpha))" \
+  "$(printf ':1\r\n:100\r\n:1\r\n:-1\r\n:1\r\n$-1\r\n')"
+
+expect_eq "INFO keeps its place among commands executed here" \
+  "$(send_pipeline "$PORT" < <(resp_encode GET bravo; resp_encode INFO server;
+                               resp_encode GET charlie) | tr -d '\r' |
+     grep -x 'v-bravo\|# Server\|v-charlie')" \
+  "$(printf 'v-bravo\n# Server\nv-charlie')"
+
+big="$(head -c 100000 /dev/zero | tr '\0' 'x')"
+expect_eq "a large value written then read in one pipeline" \
+  "$(send_pipeline "$PORT" < <(resp_encode SET big "$big";
+                               resp_encode GET big) | tr -d '\r')" \
+  "$(printf '+OK\n$100000\n%s' "$big")"
+
+summary
@@ -0,0 +1,57 @@
+#!/usr/bin/env bash
+# e2e test for --io-reads: IO threads execute GET, TTL and PTTL themselves,
+# reading the executors' stores while they write them, and a client still
+# reads its own writes, in order.
+set -uo pipefail
+source "$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)/lib.sh"
+
+PORT=6404
+start_server "$PORT" --io-reads --executors 2 --io-threads 2
+
+io_commands() {
+  send_command "$PORT" INFO stats | tr -d '\r' |
+    sed -n 's/^io_commands_processed://p'
+}
+
+expect_eq "SET replies OK" \
+  "$(send_command "$PORT" SET key value)" \
+  "$(printf '+OK\r\n')"
+
+before="$(io_commands)"
+expect_eq "GET finds the value" \
+  "$(send_command "$PORT" GET key)" \
+  "$(printf '$5\r\nvalue\r\n')"
+expect_eq "TTL of a key without one" \
+  "$(send_command "$PORT" TTL key)" \
+  "$(printf ':-1\r\n')"
+expect_eq "PTTL of a missing key" \
+  "$(send_command "$PORT" PTTL missing)" \
+  "$(printf ':-2\r\n')"
+expect_eq "the reads were executed on the IO threads" \
+  "$(( $(io_commands) - before ))" \
+  "3"
+
+expect_eq "reads in a pipeline see the writes before them" \
+  "$(send_pipeline "$PORT" < <(resp_encode SET key one; resp_encode GET key;
+                               resp_encode SET key two; resp_encode GET key;
+                               resp_encode EXPIRE key 100;
+                               resp_encode TTL key;
+                               resp_encode PERSIST key;
+                               resp_encode TTL key;
+                               resp_encode DEL key; resp_encode GET key))" \
+  "$(printf '+OK\r\n$3\r\none\r\n+OK\r\n$3\r\ntwo\r\n:1\r\n:100\r\n%b' \
+       ':1\r\n:-1\r\n:1\r\n$-1\r\n')"
+
+expect_eq "reads keep their place among stateless and unknown commands" \
+  "$(send_pipeline "$PORT" < <(resp_encode GET missing; resp_encode PING;
+                               resp_encode NOPE; resp_encode GET ""))" \
+  "$(printf -- '$-1\r\n+PONG\r\n%s\r\n%s\r\n' \
+       '-Unknown subcommand or command' '-Unknown subcommand or command')"
+
+big="$(head -c 100000 /dev/zero | tr '\0' 'x')"
+expect_eq "a large value written then read in one pipeline" \
+  "$(send_pipeline "$PORT" < <(resp_encode SET big "$big";
+                               resp_encode GET big) | tr -d '\r')" \
+  "$(printf '+OK\n$100000\n%s' "$big")"
+
+summary
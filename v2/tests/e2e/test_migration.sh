@@ -0,0 +1,96 @@
+#!/usr/bin/env bash
+# e2e test for client migration (`--rebalance-interval`): two clients placed
+# on the same IO thread keep pipelining while the other thread sits idle, so
+# Rebalance moves one of them across mid-pipeline. Both must still get every
+# reply, in request order, whichever thread executes the commands.
+set -uo pipefail
+source "$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)/lib.sh"
+
+PORT=6408
+WORK_DIR="$(mktemp -d)"
+trap 'rm -rf "$WORK_DIR"; stop_server' EXIT
+
+rounds=40
+per_round=250
+
+# Requests and expected replies for client <name>, one requests file per
+# round; values carry the request number, so any reordering shows.
+prepare() {
+  local name="$1" round i n
+  for round in $(seq 1 "$rounds"); do
+    for i in $(seq 1 "$per_round"); do
+      n=$(( (round - 1) * per_round + i ))
+      resp_encode SET "$name$n" "v$n"
+      resp_encode GET "$name$n"
+    done > "$WORK_DIR/$name.$round"
+  done
+  for n in $(seq 1 $(( rounds * per_round ))); do
+    printf '+OK\r\n$%d\r\n%s\r\n' "$(( ${#n} + 1 ))" "v$n"
+  done > "$WORK_DIR/$name.expected"
+}
+
+# feed <name> <fd> — sends client <name>'s rounds a little apart, so that its
+# load spans many rebalance intervals.
+feed() {
+  local name="$1" fd="$2" round
+  for round in $(seq 1 "$rounds"); do
+    cat "$WORK_DIR/$name.$round" >&"$fd"
+    sleep 0.02
+  done
+}
+
+prepare a
+prepare c
+
+# check_migration <label> [server_arg...] — runs the scenario against a fresh
+# server started with the given flags.
+check_migration() {
+  local label="$1"; shift
+  start_server "$PORT" --io-threads 2 --rebalance-interval 50 "$@"
+
+  # Placed one after another on an idle server: a on thread 0, b on thread 1,
+  # c back on thread 0. b stays idle.
+  exec 5<>"/dev/tcp/$HOST/$PORT"
+  sleep 0.1
+  exec 6<>"/dev/tcp/$HOST/$PORT"
+  sleep 0.1
+  exec 7<>"/dev/tcp/$HOST/$PORT"
+  sleep 0.1
+
+  local reader_a reader_c feeder_a feeder_c
+  timeout 20 head -c "$(wc -c < "$WORK_DIR/a.expected")" <&5 \
+    > "$WORK_DIR/a.out" &
+  reader_a=$!
+  timeout 20 head -c "$(wc -c < "$WORK_DIR/c.expected")" <&7 \
+    > "$WORK_DIR/c.out" &
+  reader_c=$!
+  feed a 5 &
+  feeder_a=$!
+  feed c 7 &
+  feeder_c=$!
+  wait "$feeder_a" "$feeder_c" "$reader_a" "$reader_c"
+
+  expect_eq "$label: the first client got every reply, in order" \
+    "$(cmp -s "$WORK_DIR/a.out" "$WORK_DIR/a.expected" && echo same)" \
+    "same"
+  expect_eq "$label: the second client got every reply, in order" \
+    "$(cmp -s "$WORK_DIR/c.out" "$WORK_DIR/c.expected" && echo same)" \
+    "same"
+  expect_eq "$label: a client was migrated meanwhile" \
+    "$(send_command "$PORT" INFO stats | tr -d '\r' |
+         sed -n 's/^client_migrations:[1-9][0-9]*$/yes/p')" \
+    "yes"
+  expect_eq "$label: the idle client is still served" \
+    "$(resp_encode PING >&6; timeout 1 head -c 7 <&6)" \
+    "$(printf '+PONG\r\n')"
+  exec 5>&- 5<&- 6>&- 6<&- 7>&- 7<&-
+  stop_server
+}
+
+check_migration "main thread executes"
+# The main thread sees few or none of the commands here: the IO threads count
+# them for Rebalance.
+check_migration "IO threads execute" --io-execute
+check_migration "IO threads read" --io-reads
+
+summary
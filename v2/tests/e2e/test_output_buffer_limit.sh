@@ -0,0 +1,74 @@
+#!/usr/bin/env bash
+# e2e test for `--output-buffer-hard-limit` and `--output-buffer-soft-limit`:
+# a client that pipelines far more reply bytes than it reads is disconnected,
+# at once over the hard limit, or once it has stayed over the soft limit too
+# long, while clients reading their replies are served in full.
+set -uo pipefail
+source "$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)/lib.sh"
+
+PORT=6400
+start_server "$PORT" --output-buffer-hard-limit 1000000
+
+big="$(head -c 100000 /dev/zero | tr '\0' 'x')"
+expect_eq "SET of a 100KB value replies OK" \
+  "$(send_command "$PORT" SET big "$big")" \
+  "$(printf '+OK\r\n')"
+
+expect_eq "GET of a reply under the limit returns the whole value" \
+  "$(send_command "$PORT" GET big)" \
+  "$(printf '$100000\r\n%s\r\n' "$big")"
+
+# 500 GETs ask for ~50MB of replies, far more than the socket buffers hold, so
+# the rest backs up in the server past the limit while nothing is read.
+exec 8<>"/dev/tcp/$HOST/$PORT"
+for _ in $(seq 500); do resp_encode GET big; done >&8
+sleep 1
+# Reaching EOF or a reset (rather than timing out) means the server closed
+# the client.
+timeout 5 cat <&8 >/dev/null 2>&1
+status=$?
+expect_eq "a client over the hard limit is disconnected" \
+  "$([[ $status -ne 124 ]] && echo closed || echo open)" "closed"
+exec 8>&- 8<&-
+
+expect_eq "the server still serves other clients" \
+  "$(send_command "$PORT" PING)" \
+  "$(printf '+PONG\r\n')"
+
+stop_server
+
+# closed_by_server <port> — whether the server has closed every client
+# connection it had on <port>: none is ESTABLISHED on its side any more (in
+# /proc/net/tcp, field 2 is the local address, 4 the state, and 01 is
+# ESTABLISHED). The client side cannot tell while it does not read: the
+# server's FIN waits behind the replies the kernel still holds for it.
+closed_by_server() {
+  local port_hex
+  port_hex="$(printf '%04X' "$1")"
+  awk -v port="$port_hex" \
+    'split($2, local, ":") && local[2] == port && $4 == "01" { found = 1 }
+     END { exit found }' /proc/net/tcp
+}
+
+SOFT_PORT=6407
+start_server "$SOFT_PORT" --output-buffer-soft-limit 200000 \
+  --output-buffer-soft-seconds 1
+send_command "$SOFT_PORT" SET big "$big" >/dev/null
+
+# This client never reads at all, so the server never gets to write to it
+# again: only the soft limit's own timer can close it.
+exec 8<>"/dev/tcp/$HOST/$SOFT_PORT"
+for _ in $(seq 500); do resp_encode GET big; done >&8
+for _ in $(seq 40); do
+  closed_by_server "$SOFT_PORT" && break
+  sleep 0.1
+done
+expect_eq "a stalled client over the soft limit is closed once it is due" \
+  "$(closed_by_server "$SOFT_PORT" && echo closed || echo open)" "closed"
+exec 8>&- 8<&-
+
+expect_eq "the server still serves other clients" \
+  "$(send_command "$SOFT_PORT" PING)" \
+  "$(printf '+PONG\r\n')"
+
+summary
@@ -1,5 +1,6 @@
 #!/usr/bin/env bash
-# e2e test for PingRequestHandler (server/handler/ping_request_handler.h).
+# e2e test for PingRequestHandler (server/handler/ping_request_handler.h),
+# which the IO threads run themselves (server/handler/stateless_dispatcher.h).
 set -uo pipefail
 source "$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)/lib.sh"
 
@@ -18,4 +19,24 @@ expect_eq "PING with too many args is unrecognised" \
   "$(send_command "$PORT" PING one two)" \
   "$(printf -- '-Unknown subcommand or command\r\n')"
 
+expect_eq "PING in a pipeline is answered between the commands around it" \
+  "$(send_pipeline "$PORT" < <(resp_encode SET k v; resp_encode PING;
+                               resp_encode GET k; resp_encode ECHO e;
+                               resp_encode PING p; resp_encode DEL k;
+                               resp_encode PING))" \
+  "$(printf '+OK\r\n+PONG\r\n$1\r\nv\r\n$1\r\ne\r\n$1\r\np\r\n:1\r\n+PONG\r\n')"
+
+# io_commands_processed <port> — the INFO field of that name.
+io_commands_processed() {
+  send_command "$1" INFO stats | tr -d '\r' |
+    sed -n 's/^io_commands_processed://p'
+}
+
+before="$(io_commands_processed "$PORT")"
+send_pipeline "$PORT" < <(resp_encode PING; resp_encode ECHO e;
+                          resp_encode GET k) >/dev/null
+expect_eq "commands answered on an IO thread are counted in INFO" \
+  "$(( $(io_commands_processed "$PORT") - before ))" \
+  "2"
+
 summary
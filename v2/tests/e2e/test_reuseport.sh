@@ -0,0 +1,27 @@
+#!/usr/bin/env bash
+# e2e test for SO_REUSEPORT accept sharding (`--reuseport`): every IO thread
+# accepts its own clients, so consecutive connections land on different
+# threads and must still see one store.
+set -uo pipefail
+source "$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)/lib.sh"
+
+PORT=6399
+start_server "$PORT" --reuseport --backlog 1024 --io-threads 4
+
+expect_eq "PING replies PONG" \
+  "$(send_command "$PORT" PING)" \
+  "$(printf '+PONG\r\n')"
+
+for i in 1 2 3 4 5 6 7 8; do
+  expect_eq "SET on connection $i replies OK" \
+    "$(send_command "$PORT" SET "key$i" "value$i")" \
+    "$(printf '+OK\r\n')"
+done
+
+for i in 1 2 3 4 5 6 7 8; do
+  expect_eq "GET on a fresh connection sees key$i" \
+    "$(send_command "$PORT" GET "key$i")" \
+    "$(printf '$6\r\nvalue%d\r\n' "$i")"
+done
+
+summary
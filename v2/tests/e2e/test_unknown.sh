@@ -1,6 +1,8 @@
 #!/usr/bin/env bash
-# e2e test for UnknownRequestHandler (server/handler/unknown_request_handler.h),
-# the fallback that catches anything the other handlers rejected.
+# e2e test for command lookup (server/handler/command_table.h), done on the
+# IO threads: unknown commands and arities are rejected, without upsetting
+# the order of replies in a pipeline, and command names match
+# case-insensitively.
 set -uo pipefail
 source "$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)/lib.sh"
 
@@ -11,8 +13,37 @@ expect_eq "an unrecognised command name is rejected" \
   "$(send_command "$PORT" FROBNICATE foo)" \
   "$(printf -- '-Unknown subcommand or command\r\n')"
 
-expect_eq "command names are case-sensitive" \
-  "$(send_command "$PORT" get foo)" \
+expect_eq "a known name with the wrong arity is rejected" \
+  "$(send_command "$PORT" GET foo bar)" \
+  "$(printf -- '-Unknown subcommand or command\r\n')"
+
+expect_eq "a name longer than any command is rejected" \
+  "$(send_command "$PORT" PEXPIREATX foo 1)" \
+  "$(printf -- '-Unknown subcommand or command\r\n')"
+
+send_command "$PORT" set foo bar >/dev/null
+
+unknown='-Unknown subcommand or command'
+
+expect_eq "a rejected request in a pipeline is answered in its place" \
+  "$(send_pipeline "$PORT" < <(resp_encode GET foo; resp_encode FROBNICATE;
+                               resp_encode SET foo baz; resp_encode GET;
+                               resp_encode NOPE; resp_encode GET foo))" \
+  "$(printf -- '$3\r\nbar\r\n%s\r\n+OK\r\n%s\r\n%s\r\n$3\r\nbaz\r\n' \
+       "$unknown" "$unknown" "$unknown")"
+
+expect_eq "a pipeline of nothing but rejected requests is answered" \
+  "$(send_pipeline "$PORT" < <(resp_encode NOPE; resp_encode NOPE))" \
+  "$(printf -- '%s\r\n%s\r\n' "$unknown" "$unknown")"
+
+send_command "$PORT" set foo bar >/dev/null
+
+expect_eq "command names are case-insensitive" \
+  "$(send_command "$PORT" gEt foo)" \
+  "$(printf '$3\r\nbar\r\n')"
+
+expect_eq "case-insensitive names keep their arity" \
+  "$(send_command "$PORT" ping a b)" \
   "$(printf -- '-Unknown subcommand or command\r\n')"
 
 summary
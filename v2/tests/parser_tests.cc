@@ -1,8 +1,33 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "network/recv_buffer.h"
+#include "resp_value/reply_builder.h"
+#include "resp_value/resp_frame.h"
+#include "resp_value/resp_frame_parser.h"
+#include "resp_value/resp_parser.h"
+#include "resp_value/resp_scan.h"
 #include "resp_value/resp_value.h"
-
+#include "resp_value/resp_value_queue.h"
+
+using myredis::RecvBuffer;
+using myredis::RecvBufferPool;
+using myredis::ReplyBuilder;
+using myredis::RespArg;
+using myredis::RespFrame;
+using myredis::RespFrameParser;
+using myredis::RespFrames;
+using myredis::RespParser;
 using myredis::RespValue;
+using myredis::RespValueQueue;
 
 class RespParsingTest : public ::testing::Test {
  protected:
@@ -327,3 +352,381 @@ TEST(RespSerializeTests, ArrayWithElements) {
   const RespValue value = RespValue::FromVariant(arr);
   EXPECT_EQ(value.Serialize(), "*3\r\n+foo\r\n:123\r\n$3\r\nbar\r\n");
 }
+
+TEST(ReplyBuilderTest, AppendsEachReplyType) {
+  std::string out = "+PONG\r\n";  // replies already in the buffer stay
+  ReplyBuilder reply(out);
+  reply.Ok();
+  reply.Error("ERR no");
+  reply.Integer(0);
+  reply.Integer(1);
+  reply.Integer(std::numeric_limits<long long>::min());
+  reply.ArrayHeader(3);
+  reply.Bulk("foo");
+  reply.Bulk("");
+  reply.NullableBulk(std::nullopt);
+  EXPECT_EQ(out,
+            "+PONG\r\n+OK\r\n-ERR no\r\n:0\r\n:1\r\n"
+            ":-9223372036854775808\r\n*3\r\n$3\r\nfoo\r\n$0\r\n\r\n"
+            "$-1\r\n");
+}
+
+TEST(ReplyBuilderTest, DeferredValuesAreSplicedInPlace) {
+  const auto first = std::make_shared<const std::string>("first");
+  const auto second = std::make_shared<const std::string>("second");
+  std::string out;
+  std::vector<myredis::DeferredBulk> deferred;
+  ReplyBuilder reply(out, &deferred);
+  reply.SharedBulk(first);
+  reply.Ok();
+  reply.SharedBulk(second);
+  reply.SharedBulk(first);
+  reply.Integer(7);
+  EXPECT_EQ(out, "+OK\r\n:7\r\n");  // no copies of the values yet
+  ASSERT_EQ(deferred.size(), 3U);
+
+  std::string encoded = "*0\r\n";
+  myredis::EncodeDeferred(out, deferred, encoded);
+  EXPECT_EQ(encoded,
+            "*0\r\n$5\r\nfirst\r\n+OK\r\n$6\r\nsecond\r\n$5\r\nfirst\r\n"
+            ":7\r\n");
+}
+
+TEST(ReplyBuilderTest, SharedValuesAreCopiedWhenNotDeferring) {
+  std::string out;
+  ReplyBuilder(out).SharedBulk(std::make_shared<const std::string>("v"));
+  EXPECT_EQ(out, "$1\r\nv\r\n");
+}
+
+TEST(ReplyBuilderTest, BulkPayloadMayHoldCrlf) {
+  std::string out;
+  ReplyBuilder(out).Bulk(std::string_view("a\r\n\0b", 5));
+  EXPECT_EQ(out, std::string("$5\r\na\r\n\0b\r\n", 11));
+}
+
+TEST(RespParserTest, ResumesAtEverySplitPoint) {
+  const std::string input =
+      "*3\r\n$3\r\nSET\r\n$-1\r\n*2\r\n:12\r\n+ok\r\n-ERR x\r\n$0\r\n\r\n"
+      "$20\r\n0123456789abcdefghij\r\n";
+  for (std::size_t split = 0; split <= input.size(); ++split) {
+    RespParser parser;
+    std::optional<RespValue> value;
+    std::vector<std::string> parsed;
+    std::string pending;  // the incomplete line handed back, as a caller does
+    for (const std::string_view piece :
+         {std::string_view(input).substr(0, split),
+          std::string_view(input).substr(split)}) {
+      pending.append(piece);
+      std::size_t pos = 0;
+      RespParser::Status status;
+      while ((status = parser.Next(pending, pos, value)) ==
+             RespParser::Status::kValue) {
+        parsed.push_back(value->Serialize());
+      }
+      ASSERT_EQ(status, RespParser::Status::kNeedMore) << split;
+      pending.erase(0, pos);
+    }
+    EXPECT_TRUE(pending.empty()) << split;
+    EXPECT_TRUE(parser.Idle()) << split;
+    EXPECT_EQ(parsed, (std::vector<std::string>{
+                          "*3\r\n$3\r\nSET\r\n$-1\r\n*2\r\n:12\r\n+ok\r\n",
+                          "-ERR x\r\n", "$0\r\n\r\n",
+                          "$20\r\n0123456789abcdefghij\r\n"}))
+        << split;
+  }
+}
+
+TEST(RespParserTest, KeepsPartialValuesInsteadOfReparsing) {
+  RespParser parser;
+  std::optional<RespValue> value;
+  std::size_t pos = 0;
+  // Everything but the incomplete `$5` line is taken, including the part of
+  // the payload already received.
+  const std::string_view first = "*2\r\n$4\r\nECHO\r\n$5\r\nhel";
+  EXPECT_EQ(parser.Next(first, pos, value), RespParser::Status::kNeedMore);
+  EXPECT_EQ(pos, first.size());
+  EXPECT_FALSE(parser.Idle());
+
+  const std::string_view second = "lo\r\n";
+  pos = 0;
+  EXPECT_EQ(parser.Next(second, pos, value), RespParser::Status::kValue);
+  EXPECT_EQ(pos, second.size());
+  EXPECT_EQ(value->Serialize(), "*2\r\n$4\r\nECHO\r\n$5\r\nhello\r\n");
+}
+
+TEST(RespParserTest, LeavesAnIncompleteLine) {
+  RespParser parser;
+  std::optional<RespValue> value;
+  std::size_t pos = 0;
+  EXPECT_EQ(parser.Next("+OK\r\n:12", pos, value), RespParser::Status::kValue);
+  EXPECT_EQ(parser.Next("+OK\r\n:12", pos, value),
+            RespParser::Status::kNeedMore);
+  EXPECT_EQ(pos, 5u);
+}
+
+TEST(RespParserTest, ReportsMalformedFraming) {
+  for (const std::string_view input :
+       {"?bad\r\n", ":12x\r\n", "$-2\r\n", "*-1\r\n", "$abc\r\n",
+        "$3\r\nfooXX", "$600000000\r\n"}) {
+    RespParser parser;
+    std::optional<RespValue> value;
+    std::size_t pos = 0;
+    EXPECT_EQ(parser.Next(input, pos, value), RespParser::Status::kError)
+        << input;
+  }
+}
+
+TEST(RespParserTest, RejectsOverlongLine) {
+  RespParser parser;
+  std::optional<RespValue> value;
+  std::size_t pos = 0;
+  const std::string line = "+" + std::string(RespParser::kMaxLineBytes, 'x');
+  EXPECT_EQ(parser.Next(line, pos, value), RespParser::Status::kError);
+}
+
+TEST(RespValueQueueTest, ParseTakesAllButAnIncompleteLine) {
+  RespValueQueue queue;
+  EXPECT_EQ(queue.Parse("+A\r\n:2\r\n$5\r\nhel"), 15u);
+  EXPECT_EQ(queue.PopValue()->Serialize(), "+A\r\n");
+  EXPECT_EQ(queue.PopValue()->Serialize(), ":2\r\n");
+  EXPECT_FALSE(queue.PopValue().has_value());
+
+  // Only the rest of the value is passed; the parser kept its start.
+  EXPECT_EQ(queue.Parse("lo\r\n:3"), 4u);
+  EXPECT_EQ(queue.PopValue()->Serialize(), "$5\r\nhello\r\n");
+}
+
+TEST(RespValueQueueTest, ParseReportsMalformedFraming) {
+  RespValueQueue queue;
+  EXPECT_FALSE(queue.Parse("?bad\r\n").has_value());
+}
+
+TEST(RespValueQueueTest, PopValueParsesPushedPieces) {
+  RespValueQueue queue;
+  const std::string input = "*2\r\n$4\r\nECHO\r\n$5\r\nhello\r\n:7\r\n";
+  for (const char c : input) queue.PushString(std::string_view(&c, 1));
+  EXPECT_EQ(queue.PopValue()->Serialize(), "*2\r\n$4\r\nECHO\r\n$5\r\nhello\r\n");
+  EXPECT_EQ(queue.PopValue()->Serialize(), ":7\r\n");
+  EXPECT_FALSE(queue.PopValue().has_value());
+
+  queue.PushString("?bad\r\n");
+  EXPECT_THROW(queue.PopValue(), std::invalid_argument);
+}
+
+TEST(RespValueQueueTest, StreamsLargeBulkStringAcrossInputs) {
+  RespValueQueue queue;
+  const std::string value(RespValueQueue::kStreamThreshold + 10, 'v');
+  const std::string request = "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$" +
+                              std::to_string(value.size()) + "\r\n" + value +
+                              "\r\n*1\r\n$4\r\nPING\r\n";
+  const std::size_t payload_start = request.find(value);
+
+  // The header and the payload so far are consumed, not left to be re-parsed.
+  const std::string_view first(request.data(), payload_start + 100);
+  EXPECT_EQ(queue.Parse(first), first.size());
+  EXPECT_FALSE(queue.PopValue().has_value());
+
+  // The caller may write the payload straight into the value.
+  const std::span<char> space = queue.StreamingSpace();
+  ASSERT_EQ(space.size(), value.size() - 100);
+  std::copy_n(value.data() + 100, 1000, space.data());
+  queue.CommitStreamed(1000);
+
+  const std::string_view rest =
+      std::string_view(request).substr(payload_start + 1100);
+  EXPECT_EQ(queue.Parse(rest), rest.size());
+  EXPECT_TRUE(queue.StreamingSpace().empty());
+  const std::optional<RespValue> set = queue.PopValue();
+  ASSERT_TRUE(set.has_value());
+  EXPECT_EQ(set->Serialize(), request.substr(0, request.find("*1\r\n")));
+  EXPECT_EQ(queue.PopValue()->Serialize(), "*1\r\n$4\r\nPING\r\n");
+}
+
+TEST(RespValueQueueTest, StreamedBulkStringWaitsForItsCrlf) {
+  RespValueQueue queue;
+  const std::string value(RespValueQueue::kStreamThreshold, 'v');
+  const std::string head =
+      "*2\r\n$4\r\nECHO\r\n$" + std::to_string(value.size()) + "\r\n";
+  EXPECT_EQ(queue.Parse(head + value + "\r"), head.size() + value.size());
+  EXPECT_FALSE(queue.PopValue().has_value());
+  EXPECT_EQ(queue.Parse("\r\n"), 2u);
+  EXPECT_TRUE(queue.PopValue().has_value());
+}
+
+TEST(RespValueQueueTest, SmallBulkStringIsNotStreamed) {
+  RespValueQueue queue;
+  EXPECT_EQ(queue.Parse("*2\r\n$4\r\nECHO\r\n$100\r\nabc"), 23u);
+  EXPECT_TRUE(queue.StreamingSpace().empty());
+}
+
+namespace {
+
+// Renders the requests in `frames` as "SET k <nil>", or "-" for one that is
+// not a command.
+std::vector<std::string> Show(const RespFrames& frames) {
+  std::vector<std::string> shown;
+  for (const RespFrame& frame : frames.frames) {
+    if (frame.arg_count == 0) {
+      shown.emplace_back("-");
+      continue;
+    }
+    std::string request;
+    for (std::uint32_t i = 0; i < frame.arg_count; ++i) {
+      const RespArg& arg = frames.args[frame.first_arg + i];
+      if (i > 0) request += ' ';
+      request += arg ? std::string(*arg) : "<nil>";
+    }
+    shown.push_back(std::move(request));
+  }
+  return shown;
+}
+
+}  // namespace
+
+TEST(RespFrameParserTest, ResumesAtEverySplitPoint) {
+  const std::string input =
+      "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$-1\r\n+PING\r\n*0\r\n"
+      "*2\r\n$4\r\nECHO\r\n*1\r\n:1\r\n*1\r\n$-1\r\n*2\r\n$4\r\nECHO\r\n"
+      "$20\r\n0123456789abcdefghij\r\n";
+  for (std::size_t split = 0; split <= input.size(); ++split) {
+    RecvBufferPool pool;
+    RecvBuffer buffer;
+    RespFrameParser parser;
+    RespFrames frames;
+    for (const std::string_view piece :
+         {std::string_view(input).substr(0, split),
+          std::string_view(input).substr(split)}) {
+      buffer.Append(piece, pool);
+      ASSERT_TRUE(parser.Parse(buffer, pool, frames)) << split;
+    }
+    EXPECT_TRUE(buffer.Empty()) << split;
+    EXPECT_EQ(Show(frames),
+              (std::vector<std::string>{"SET k <nil>", "-", "-", "-", "-",
+                                        "ECHO 0123456789abcdefghij"}))
+        << split;
+  }
+}
+
+TEST(RespFrameParserTest, ArgumentsViewThePinnedReceiveBlock) {
+  RecvBufferPool pool;
+  RecvBuffer buffer;
+  RespFrameParser parser;
+  RespFrames frames;
+  const std::string value(2100, 'v');
+  const std::string set =
+      "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$2100\r\n" + value + "\r\n";
+  // A complete request that takes over half the block, then an incomplete
+  // one that fills the rest.
+  const std::size_t capacity = buffer.WritableSpace(pool).size();
+  const std::string head = "*2\r\n$4\r\nECHO\r\n$3000\r\n";
+  const std::size_t partial = capacity - set.size() - head.size();
+  buffer.Append(set + head + std::string(partial, 'x'), pool);
+  ASSERT_TRUE(parser.Parse(buffer, pool, frames));
+  ASSERT_EQ(Show(frames), std::vector<std::string>{"SET k " + value});
+
+  ASSERT_EQ(frames.blocks.size(), 1u);
+  const char* const block = frames.blocks[0].data.get();
+  for (const RespArg& arg : frames.args) {
+    EXPECT_GE(arg->data(), block);
+    EXPECT_LT(arg->data(), block + capacity);
+  }
+
+  // The block is full and mostly parsed, but the request points into it: the
+  // unparsed tail moves to another block instead of sliding down over it.
+  buffer.Append(std::string(3000 - partial, 'x') + "\r\n", pool);
+  EXPECT_EQ(Show(frames), std::vector<std::string>{"SET k " + value});
+  ASSERT_TRUE(parser.Parse(buffer, pool, frames));
+  EXPECT_EQ(frames.Size(), 2u);
+  EXPECT_EQ(frames.args[3], "ECHO");
+  EXPECT_EQ(frames.blocks.size(), 2u);
+}
+
+TEST(RespFrameParserTest, CopiesRequestWithLargeBulkString) {
+  RecvBufferPool pool;
+  RecvBuffer buffer;
+  RespFrameParser parser;
+  RespFrames frames;
+  const std::string value(RespFrameParser::kStreamThreshold + 10, 'v');
+  const std::string request = "*3\r\n$3\r\nSET\r\n$1\r\nk\r\n$" +
+                              std::to_string(value.size()) + "\r\n" + value +
+                              "\r\n*1\r\n$4\r\nPING\r\n";
+  const std::size_t payload_start = request.find(value);
+
+  // The request so far is taken out of the buffer.
+  buffer.Append(std::string_view(request).substr(0, payload_start + 100),
+                pool);
+  ASSERT_TRUE(parser.Parse(buffer, pool, frames));
+  EXPECT_TRUE(buffer.Empty());
+  EXPECT_TRUE(frames.Empty());
+
+  // The payload can be received straight into the value...
+  const std::span<char> space = parser.StreamingSpace();
+  ASSERT_EQ(space.size(), value.size() - 100);
+  std::copy_n(value.data() + 100, 1000, space.data());
+  parser.CommitStreamed(1000);
+  // ... or taken from memory the caller cannot keep.
+  const std::string_view rest =
+      std::string_view(request).substr(payload_start + 1100);
+  const std::optional<std::size_t> taken = parser.ParseStreamed(rest, frames);
+  ASSERT_TRUE(taken.has_value());
+  EXPECT_EQ(*taken, value.size() - 1100 + 2);
+  EXPECT_EQ(parser.ParseStreamed(rest.substr(*taken), frames), 0u);
+
+  buffer.Append(rest.substr(*taken), pool);
+  ASSERT_TRUE(parser.Parse(buffer, pool, frames));
+  EXPECT_EQ(Show(frames),
+            (std::vector<std::string>{"SET k " + value, "PING"}));
+  ASSERT_EQ(frames.owned.size(), 3u);
+  EXPECT_EQ(frames.args[2]->data(), frames.owned[2].data());
+}
+
+TEST(RespFrameParserTest, ReportsMalformedFraming) {
+  for (const std::string_view input :
+       {"?bad\r\n", "*1\r\n:12x\r\n", "*1\r\n$-2\r\n", "*-1\r\n",
+        "*1\r\n$abc\r\n", "*1\r\n$3\r\nfooXX", "*2\r\n$600000000\r\n"}) {
+    RecvBufferPool pool;
+    RecvBuffer buffer;
+    RespFrameParser parser;
+    RespFrames frames;
+    buffer.Append(input, pool);
+    EXPECT_FALSE(parser.Parse(buffer, pool, frames)) << input;
+  }
+}
+
+TEST(RespScanTest, EveryCrlfScannerMatchesFind) {
+  // Lines of every length around the block sizes, with lone '\r' and '\n'
+  // bytes and a CRLF straddling each block boundary.
+  std::string input;
+  for (std::size_t len = 0; len < 80; ++len) {
+    input += std::string(len, 'a') + (len % 3 == 0 ? "\r" : "\n") +
+             std::string(len % 7, 'b') + "\r\n";
+  }
+  input += "\r";
+  for (const myredis::CrlfScanner& scanner :
+       myredis::SupportedCrlfScanners()) {
+    for (std::size_t from = 0; from <= input.size() + 1; ++from) {
+      ASSERT_EQ(scanner.find(input, from),
+                std::string_view(input).find("\r\n", from))
+          << scanner.name << " from " << from;
+    }
+  }
+  EXPECT_EQ(myredis::FindCrlf("ab\r\n", 0), 2u);
+}
+
+TEST(RespScanTest, ParseDecimal) {
+  long long value = 0;
+  EXPECT_TRUE(myredis::ParseDecimal("0", value));
+  EXPECT_EQ(value, 0);
+  EXPECT_TRUE(myredis::ParseDecimal("-42", value));
+  EXPECT_EQ(value, -42);
+  EXPECT_TRUE(myredis::ParseDecimal("9223372036854775807", value));
+  EXPECT_EQ(value, std::numeric_limits<long long>::max());
+  EXPECT_TRUE(myredis::ParseDecimal("-9223372036854775808", value));
+  EXPECT_EQ(value, std::numeric_limits<long long>::min());
+
+  for (const std::string_view bad :
+       {"", "-", "+1", " 1", "1 ", "12a", "9223372036854775808",
+        "-9223372036854775809", "99999999999999999999", "--1"}) {
+    EXPECT_FALSE(myredis::ParseDecimal(bad, value)) << bad;
+  }
+}
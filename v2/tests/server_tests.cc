@@ -0,0 +1,194 @@
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "server/batch_scheduler.h"
+#include "server/messages.h"
+
+using myredis::BatchScheduler;
+using myredis::CommandBatch;
+
+namespace {
+
+// A batch of `size` requests from the client on `fd`; the requests are never
+// executed, so they need no arguments.
+CommandBatch Batch(const int fd, const std::uint64_t seq,
+                   const std::size_t size) {
+  CommandBatch batch{.fd = fd, .seq = seq};
+  batch.requests.frames.resize(size);
+  return batch;
+}
+
+// What a scheduler did, in order: "run <fd>.<seq> [begin,end)" for each slice
+// and "done <fd>.<seq> from <thread>" for each batch answered.
+class Trace {
+ public:
+  void RunRound(BatchScheduler& scheduler) {
+    scheduler.RunRound(
+        [this](CommandBatch& batch, const std::size_t begin,
+               const std::size_t end) { Ran(batch, begin, end); },
+        [this](CommandBatch& batch, const std::size_t thread) {
+          Answered(batch, thread);
+        });
+  }
+  void Finish(BatchScheduler& scheduler, const int fd) {
+    scheduler.Finish(
+        fd,
+        [this](CommandBatch& batch, const std::size_t begin,
+               const std::size_t end) { Ran(batch, begin, end); },
+        [this](CommandBatch& batch, const std::size_t thread) {
+          Answered(batch, thread);
+        });
+  }
+  const std::vector<std::string>& Events() const { return events_; }
+
+ private:
+  void Ran(const CommandBatch& batch, const std::size_t begin,
+           const std::size_t end) {
+    events_.push_back("run " + Name(batch) + " [" + std::to_string(begin) +
+                      "," + std::to_string(end) + ")");
+  }
+  void Answered(const CommandBatch& batch, const std::size_t thread) {
+    events_.push_back("done " + Name(batch) + " from " +
+                      std::to_string(thread));
+  }
+  static std::string Name(const CommandBatch& batch) {
+    return std::to_string(batch.fd) + "." + std::to_string(batch.seq);
+  }
+
+  std::vector<std::string> events_;
+};
+
+}  // namespace
+
+TEST(BatchSchedulerTest, ClientsTakeTurnsAcrossIoThreads) {
+  BatchScheduler scheduler(/*budget=*/2, /*threads=*/2);
+  scheduler.Add(Batch(10, 0, 5), 0);
+  scheduler.Add(Batch(11, 0, 3), 1);
+  scheduler.Add(Batch(12, 0, 1), 0);
+  EXPECT_EQ(scheduler.Queued(0), 2u);
+  EXPECT_EQ(scheduler.Queued(1), 1u);
+
+  Trace trace;
+  trace.RunRound(scheduler);
+  trace.RunRound(scheduler);
+  trace.RunRound(scheduler);
+  EXPECT_EQ(trace.Events(), (std::vector<std::string>{
+                                "run 10.0 [0,2)",
+                                "run 11.0 [0,2)",
+                                "run 12.0 [0,1)",
+                                "done 12.0 from 0",
+                                "run 10.0 [2,4)",
+                                "run 11.0 [2,3)",
+                                "done 11.0 from 1",
+                                "run 10.0 [4,5)",
+                                "done 10.0 from 0",
+                            }));
+  EXPECT_TRUE(scheduler.Empty());
+  EXPECT_EQ(scheduler.Queued(0), 0u);
+  EXPECT_EQ(scheduler.Queued(1), 0u);
+}
+
+TEST(BatchSchedulerTest, ClientQueuedMidRoundWaitsForTheNext) {
+  BatchScheduler scheduler(/*budget=*/1, /*threads=*/1);
+  scheduler.Add(Batch(10, 0, 2), 0);
+  // Arrives while client 10 has its turn, so joins the round behind it.
+  scheduler.RunRound(
+      [&scheduler](CommandBatch&, std::size_t, std::size_t) {
+        scheduler.Add(Batch(11, 0, 1), 0);
+      },
+      [](CommandBatch&, std::size_t) {});
+
+  Trace trace;
+  trace.RunRound(scheduler);
+  EXPECT_EQ(trace.Events(), (std::vector<std::string>{
+                                "run 11.0 [0,1)",
+                                "done 11.0 from 0",
+                                "run 10.0 [1,2)",
+                                "done 10.0 from 0",
+                            }));
+}
+
+TEST(BatchSchedulerTest, ZeroBudgetRunsEverythingQueued) {
+  BatchScheduler scheduler(/*budget=*/0, /*threads=*/1);
+  scheduler.Add(Batch(10, 0, 1000), 0);
+  scheduler.Add(Batch(10, 1, 1000), 0);
+  scheduler.Add(Batch(11, 0, 3), 0);
+
+  Trace trace;
+  trace.RunRound(scheduler);
+  EXPECT_EQ(trace.Events(), (std::vector<std::string>{
+                                "run 10.0 [0,1000)",
+                                "done 10.0 from 0",
+                                "run 10.1 [0,1000)",
+                                "done 10.1 from 0",
+                                "run 11.0 [0,3)",
+                                "done 11.0 from 0",
+                            }));
+  EXPECT_TRUE(scheduler.Empty());
+}
+
+TEST(BatchSchedulerTest, ClientBatchesRunInOrderAcrossTurns) {
+  BatchScheduler scheduler(/*budget=*/3, /*threads=*/2);
+  // One client's batches, spread over both IO threads (as after a migration).
+  scheduler.Add(Batch(10, 0, 2), 0);
+  scheduler.Add(Batch(10, 1, 2), 0);
+  scheduler.Add(Batch(10, 2, 2), 1);
+
+  Trace trace;
+  trace.RunRound(scheduler);
+  trace.RunRound(scheduler);
+  EXPECT_EQ(trace.Events(), (std::vector<std::string>{
+                                "run 10.0 [0,2)",
+                                "done 10.0 from 0",
+                                "run 10.1 [0,1)",
+                                "run 10.1 [1,2)",
+                                "done 10.1 from 0",
+                                "run 10.2 [0,2)",
+                                "done 10.2 from 1",
+                            }));
+  EXPECT_TRUE(scheduler.Empty());
+}
+
+TEST(BatchSchedulerTest, FinishDrainsOneClient) {
+  BatchScheduler scheduler(/*budget=*/1, /*threads=*/1);
+  scheduler.Add(Batch(10, 0, 3), 0);
+  scheduler.Add(Batch(10, 1, 2), 0);
+  scheduler.Add(Batch(11, 0, 2), 0);
+
+  Trace trace;
+  trace.RunRound(scheduler);
+  trace.Finish(scheduler, 10);
+  EXPECT_EQ(trace.Events(), (std::vector<std::string>{
+                                "run 10.0 [0,1)",
+                                "run 11.0 [0,1)",
+                                "run 10.0 [1,3)",
+                                "done 10.0 from 0",
+                                "run 10.1 [0,2)",
+                                "done 10.1 from 0",
+                            }));
+  EXPECT_EQ(scheduler.Queued(0), 1u);
+
+  // The finished client keeps its place, with nothing to run; the fd can be
+  // reused by a new client.
+  trace.RunRound(scheduler);
+  scheduler.Add(Batch(10, 0, 1), 0);
+  trace.RunRound(scheduler);
+  EXPECT_EQ(std::vector<std::string>(trace.Events().begin() + 6,
+                                     trace.Events().end()),
+            (std::vector<std::string>{
+                "run 11.0 [1,2)",
+                "done 11.0 from 0",
+                "run 10.0 [0,1)",
+                "done 10.0 from 0",
+            }));
+  EXPECT_TRUE(scheduler.Empty());
+  EXPECT_EQ(scheduler.Queued(0), 0u);
+
+  // Finishing a client with nothing queued does nothing.
+  trace.Finish(scheduler, 12);
+  EXPECT_EQ(trace.Events().size(), 10u);
+}
@@ -6,19 +6,25 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "store/map/hash.h"
 #include "store/map/linear_probing_hashmap.h"
 #include "store/map/linked_list_hashmap.h"
 #include "store/map/map.h"
+#include "store/map/rcu_hashmap.h"
 #include "store/map/standard_map.h"
+#include "store/map/striped_hashmap.h"
 
 using myredis::kDefaultLoadFactor;
 using myredis::LinearProbingHashmap;
 using myredis::LinkedListHashmap;
 using myredis::Map;
+using myredis::RcuHashmap;
 using myredis::StandardMap;
+using myredis::StripedHashmap;
 using myredis::StringHash;
 
 struct LinearProbingHashmapStringIntFactory {
@@ -42,6 +48,21 @@ struct StandardMapFactory {
   }
 };
 
+struct StripedHashmapStringIntFactory {
+  static std::unique_ptr<Map<std::string, int>> create() {
+    // Few stripes, so that each one grows in the tests
+    return std::make_unique<StripedHashmap<std::string, int>>(
+        kDefaultLoadFactor, StringHash, 4);
+  }
+};
+
+struct RcuHashmapStringIntFactory {
+  static std::unique_ptr<Map<std::string, int>> create() {
+    return std::make_unique<RcuHashmap<std::string, int>>(kDefaultLoadFactor,
+                                                          StringHash, 1);
+  }
+};
+
 // 1. Template the test fixture on a type `T`
 template <typename MapFactory>
 class MapTest : public ::testing::Test {
@@ -54,7 +75,9 @@ class MapTest : public ::testing::Test {
 // List of types to be tested
 using Implementations =
     ::testing::Types<LinearProbingHashmapStringIntFactory, StandardMapFactory,
-                     LinkedListHashmapStringIntFactory>;
+                     LinkedListHashmapStringIntFactory,
+                     RcuHashmapStringIntFactory,
+                     StripedHashmapStringIntFactory>;
 
 TYPED_TEST_SUITE(MapTest, Implementations);
 
@@ -119,6 +142,30 @@ TYPED_TEST(MapTest, OperationsAreIsolated) {
   EXPECT_EQ(value_two->get(), 2);
 }
 
+TYPED_TEST(MapTest, PrehashedOperationsMatchPlainOnes) {
+  const std::string one = "one";
+  const std::string two = "two";
+  this->map->Insert(one, 1, StringHash(one));
+  this->map->Insert(two, 2);
+
+  auto value_one = this->map->LookUp(one);
+  ASSERT_TRUE(value_one.has_value());
+  EXPECT_EQ(value_one->get(), 1);
+  auto value_two = this->map->LookUp(two, StringHash(two));
+  ASSERT_TRUE(value_two.has_value());
+  EXPECT_EQ(value_two->get(), 2);
+
+  this->map->Insert(one, 3, StringHash(one));
+  value_one = this->map->LookUp(one, StringHash(one));
+  ASSERT_TRUE(value_one.has_value());
+  EXPECT_EQ(value_one->get(), 3);
+
+  this->map->Remove(one, StringHash(one));
+  EXPECT_FALSE(this->map->LookUp(one).has_value());
+  this->map->Remove(two);
+  EXPECT_FALSE(this->map->LookUp(two, StringHash(two)).has_value());
+}
+
 // Performance-based tests: do not rely on internals. These tests will fail
 // if inserting or looking up many elements is too slow. Thresholds are
 // intentionally generous but will catch extremely slow implementations.
@@ -201,6 +248,8 @@ TEST(MapBenchmark, CompareImplementations) {
   factories["LinkedListHashmap"] = &LinkedListHashmapStringIntFactory::create;
   factories["LinearProbingHashmap"] =
       &LinearProbingHashmapStringIntFactory::create;
+  factories["RcuHashmap"] = &RcuHashmapStringIntFactory::create;
+  factories["StripedHashmap"] = &StripedHashmapStringIntFactory::create;
 
   std::cout << "\n"
             << "[==========] Running MapBenchmark for N = " << kBenchmarkSize
@@ -284,6 +333,24 @@ struct StandardMapUniquePtrFactory {
   }
 };
 
+struct RcuHashmapUniquePtrFactory {
+  static std::unique_ptr<Map<std::string, std::unique_ptr<std::string>>>
+  create() {
+    return std::make_unique<
+        RcuHashmap<std::string, std::unique_ptr<std::string>>>(
+        kDefaultLoadFactor, StringHash, 1);
+  }
+};
+
+struct StripedHashmapUniquePtrFactory {
+  static std::unique_ptr<Map<std::string, std::unique_ptr<std::string>>>
+  create() {
+    return std::make_unique<
+        StripedHashmap<std::string, std::unique_ptr<std::string>>>(
+        kDefaultLoadFactor, StringHash, 4);
+  }
+};
+
 template <typename MapFactory>
 class MapTestUniquePtr : public ::testing::Test {
  protected:
@@ -295,7 +362,9 @@ class MapTestUniquePtr : public ::testing::Test {
 using ImplementationsUniquePtr =
     ::testing::Types<LinearProbingHashmapStringUniquePtrFactory,
                      StandardMapUniquePtrFactory,
-                     LinkedListHashmapStringUniquePtrFactory>;
+                     LinkedListHashmapStringUniquePtrFactory,
+                     RcuHashmapUniquePtrFactory,
+                     StripedHashmapUniquePtrFactory>;
 
 TYPED_TEST_SUITE(MapTestUniquePtr, ImplementationsUniquePtr);
 
@@ -354,3 +423,89 @@ TYPED_TEST(MapTestUniquePtr, ForEachUniquePtrCollectsAllItems) {
   EXPECT_EQ(gathered["two"], "b");
   EXPECT_EQ(gathered["three"], "c");
 }
+
+// Readers racing the writer through inserts, replacements, removals and
+// growth must only ever see whole values: each one a run of a single letter.
+TEST(RcuHashmapTest, ReadersSeeWholeValuesWhileTheWriterChurns) {
+  constexpr std::size_t kReaders = 3;
+  constexpr int kKeys = 2000;
+  constexpr int kRounds = 20;
+  RcuHashmap<std::string, std::string> map(kDefaultLoadFactor, StringHash,
+                                           kReaders);
+
+  std::atomic<bool> done{false};
+  std::atomic<std::size_t> torn{0};
+  std::vector<std::thread> readers;
+  for (std::size_t reader = 0; reader < kReaders; ++reader) {
+    readers.emplace_back([&, reader] {
+      while (!done.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < kKeys; i += 7) {
+          const std::string key = std::to_string(i);
+          map.Read(reader, key, StringHash(key), [&](const std::string& value) {
+            if (value.size() != 64 ||
+                value.find_first_not_of(value.front()) != std::string::npos) {
+              torn.fetch_add(1, std::memory_order_relaxed);
+            }
+          });
+        }
+      }
+    });
+  }
+
+  for (int round = 0; round < kRounds; ++round) {
+    const auto letter = static_cast<char>('a' + round % 26);
+    for (int i = 0; i < kKeys; ++i) {
+      map.Insert(std::to_string(i), std::string(64, letter));
+    }
+    for (int i = round % 2; i < kKeys; i += 2) map.Remove(std::to_string(i));
+  }
+  done.store(true, std::memory_order_relaxed);
+  for (std::thread& reader : readers) reader.join();
+
+  EXPECT_EQ(torn.load(), 0U);
+  const std::string last = std::to_string(kRounds % 2);
+  EXPECT_FALSE(map.LookUp(std::to_string((kRounds - 1) % 2)).has_value());
+  ASSERT_TRUE(map.LookUp(last).has_value());
+  EXPECT_EQ(map.LookUp(last)->get(),
+            std::string(64, static_cast<char>('a' + (kRounds - 1) % 26)));
+}
+
+// Threads updating shared keys under their stripes' locks, while the stripes
+// grow, lose no update.
+TEST(StripedHashmapTest, UpdatesUnderStripeLocksAreAtomic) {
+  constexpr int kThreads = 4;
+  constexpr int kKeys = 3000;
+  constexpr int kRounds = 5;
+  StripedHashmap<std::string, int> map(kDefaultLoadFactor, StringHash, 8);
+
+  std::vector<std::thread> threads;
+  for (int thread = 0; thread < kThreads; ++thread) {
+    threads.emplace_back([&map, thread] {
+      for (int round = 0; round < kRounds; ++round) {
+        for (int i = 0; i < kKeys; ++i) {
+          // Every thread starts at another key.
+          std::string key =
+              std::to_string((i + thread * kKeys / kThreads) % kKeys);
+          const size_t hash = StringHash(key);
+          const auto lock = map.Lock(hash);
+          if (auto found = map.LookUp(key, hash)) {
+            ++found->get();
+          } else {
+            map.Insert(std::move(key), 1, hash);
+          }
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+
+  int keys = 0;
+  int total = 0;
+  const auto locks = map.LockAll();
+  map.ForEach([&](const std::string&, const int& count) {
+    ++keys;
+    total += count;
+  });
+  EXPECT_EQ(keys, kKeys);
+  EXPECT_EQ(total, kThreads * kRounds * kKeys);
+}